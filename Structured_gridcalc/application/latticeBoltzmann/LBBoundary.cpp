@@ -0,0 +1,293 @@
+
+/******************************************************************************/
+/**
+ * \file LBBoundary.cpp
+ *
+ * \brief Non-inline definitions for classes in LBBoundary.H
+ *
+ *//*+*************************************************************************/
+
+#include "LBBoundary.H"
+#include "LBParameters.H"
+#include "BaseFabMacros.H"
+
+namespace
+{
+
+/*--------------------------------------------------------------------*/
+//  Shift a cell into the domain in the periodic directions
+/*--------------------------------------------------------------------*/
+
+IntVect
+periodicImage(IntVect        a_iv,
+              const Box&     a_domain,
+              const unsigned a_periodic)
+{
+  const IntVect domainSize = a_domain.dimensions();
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      if (a_periodic & (1 << dir))
+        {
+          if (a_iv[dir] < a_domain.loVect(dir))
+            {
+              a_iv[dir] += domainSize[dir];
+            }
+          else if (a_iv[dir] > a_domain.hiVect(dir))
+            {
+              a_iv[dir] -= domainSize[dir];
+            }
+        }
+    }
+  return a_iv;
+}
+
+/*--------------------------------------------------------------------*/
+//  Equilibrium distribution (same expression as LBPhysics::collision)
+/*--------------------------------------------------------------------*/
+
+Real
+equilibrium(const int a_ei, const Real a_rho, const Real* a_u)
+{
+  constexpr Real cs2 = LBParameters::g_cs2;
+  const int *const e = LBParameters::latticeVelocityP(a_ei);
+  const Real ei_dot_u = a_u[0]*e[0] + a_u[1]*e[1] + a_u[2]*e[2];
+  return LBParameters::g_weight[a_ei]*a_rho*(1 + ei_dot_u/cs2 +
+    ei_dot_u*ei_dot_u/(2*cs2*cs2) -
+    (a_u[0]*a_u[0] + a_u[1]*a_u[1] + a_u[2]*a_u[2])/(2*cs2));
+}
+
+}  // anonymous namespace
+
+
+/*******************************************************************************
+ *
+ * Class LBBoundary: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Default constructor
+/*--------------------------------------------------------------------*/
+
+LBBoundary::LBBoundary()
+  :
+  m_dbl(),
+  m_periodic(0u),
+  m_boxList()
+{
+}
+
+/*--------------------------------------------------------------------*/
+//  Constructor
+/** \param[in]  a_data  Distributions (only the layout is used)
+ *  \param[in]  a_periodic
+ *                      Periodic directions (e.g., PeriodicX | PeriodicY)
+ *  \param[in]  a_wall  Type of each cell
+ *  \param[in]  a_wallVelocity
+ *                      Velocity of Wall::movingWall (3 components,
+ *                      nullptr for 0)
+ *  \param[in]  a_inflowVelocity
+ *                      Velocity of Wall::inflow (3 components, nullptr
+ *                      for 0)
+ *//*-----------------------------------------------------------------*/
+
+LBBoundary::LBBoundary(const LevelData<SolFab>&        a_data,
+                       const unsigned                   a_periodic,
+                       const WallFunction&              a_wall,
+                       const Real*                      a_wallVelocity,
+                       const Real*                      a_inflowVelocity)
+{
+  define(a_data, a_periodic, a_wall, a_wallVelocity, a_inflowVelocity);
+}
+
+/*--------------------------------------------------------------------*/
+//  Weak construction
+/** Builds the lists for the local boxes.  Each fluid cell and its
+ *  neighbours are classified once here instead of on every step.
+ *  \param[in]  a_data  Distributions (only the layout is used)
+ *  \param[in]  a_periodic
+ *                      Periodic directions (e.g., PeriodicX | PeriodicY)
+ *  \param[in]  a_wall  Type of each cell
+ *  \param[in]  a_wallVelocity
+ *                      Velocity of Wall::movingWall (3 components,
+ *                      nullptr for 0)
+ *  \param[in]  a_inflowVelocity
+ *                      Velocity of Wall::inflow (3 components, nullptr
+ *                      for 0)
+ *//*-----------------------------------------------------------------*/
+
+void
+LBBoundary::define(const LevelData<SolFab>&        a_data,
+                   const unsigned                   a_periodic,
+                   const WallFunction&              a_wall,
+                   const Real*                      a_wallVelocity,
+                   const Real*                      a_inflowVelocity)
+{
+  constexpr int dir = g_SpaceDim - 1;
+  constexpr Real rho0 = 1.;
+  constexpr Real cs2 = LBParameters::g_cs2;
+  CH_assert(a_data.ncomp() == LBParameters::g_numVelDir);
+  CH_assert(a_data.nghost() >= 1);
+  m_dbl = a_data.disjointBoxLayout();
+  m_periodic = a_periodic;
+#ifdef USE_GPU
+  m_deviceList.reset();
+#endif
+  const Box& domain = m_dbl.problemDomain();
+  Real uWall[3] = { 0., 0., 0. };
+  Real uIn[3] = { 0., 0., 0. };
+  for (int iu = 0; iu != 3; ++iu)
+    {
+      if (a_wallVelocity) uWall[iu] = a_wallVelocity[iu];
+      if (a_inflowVelocity) uIn[iu] = a_inflowVelocity[iu];
+    }
+
+  m_boxList.assign(m_dbl.localSize(), BoxList());
+  for (DataIterator dit(m_dbl); dit.ok(); ++dit)
+    {
+      const Box& box = m_dbl[dit];
+      const SolFab& fab = a_data[dit];
+      BoxList& list = m_boxList[(*dit).localIndex()];
+      // Offset of an element from the start of the data (any layout)
+      const auto offset =
+        [&fab]
+        (const IntVect& a_iv, const int a_icomp)
+        {
+          return (int)(&fab(a_iv, a_icomp) - fab.dataPtr());
+        };
+      list.m_planeBegin.assign(box.dimensions()[dir] + 1, 0);
+      // The outermost direction is the slowest so entries are ordered by
+      // plane
+      MD_BOXLOOP(box, i)
+        {
+          const IntVect iv(D_DECL(i0, i1, i2));
+          if (a_wall(iv) == Wall::fluid)
+            {
+              for (int k = 1; k != LBParameters::g_numVelDir; ++k)
+                {
+                  const IntVect ivNbr =
+                    LBParameters::neighbourLatticeSite(iv, k);
+                  const IntVect ivImage =
+                    periodicImage(ivNbr, domain, m_periodic);
+                  const Wall type = a_wall(ivImage);
+                  if (type == Wall::fluid)
+                    {
+                      CH_assert(domain.contains(ivImage));
+                      continue;
+                    }
+                  const int kbar = LBParameters::oppositeVelDir(k);
+                  const int *const e = LBParameters::latticeVelocityP(k);
+                  list.m_dst.push_back(offset(ivNbr, kbar));
+                  switch (type)
+                    {
+                    case Wall::movingWall:
+                      list.m_src.push_back(offset(iv, k));
+                      list.m_scale.push_back(1.);
+                      list.m_add.push_back(
+                        -2*LBParameters::g_weight[k]*rho0*
+                        (e[0]*uWall[0] + e[1]*uWall[1] + e[2]*uWall[2])/cs2);
+                      break;
+                    case Wall::inflow:
+                      // The source is only read to keep the loop uniform
+                      list.m_src.push_back(offset(iv, k));
+                      list.m_scale.push_back(0.);
+                      list.m_add.push_back(equilibrium(kbar, rho0, uIn));
+                      break;
+                    case Wall::outflow:
+                      list.m_src.push_back(offset(iv, kbar));
+                      list.m_scale.push_back(1.);
+                      list.m_add.push_back(0.);
+                      break;
+                    default:  // noSlip
+                      list.m_src.push_back(offset(iv, k));
+                      list.m_scale.push_back(1.);
+                      list.m_add.push_back(0.);
+                      break;
+                    }
+                }
+            }
+          list.m_planeBegin[iv[dir] - box.loVect(dir) + 1] = list.m_src.size();
+        }
+    }
+}
+
+#ifdef USE_GPU
+/*--------------------------------------------------------------------*/
+//  Copy the lists to the device
+/** The lists of all local boxes are concatenated with the local index
+ *  of the box of each entry so they are applied in a single kernel.
+ *  Call again after define.
+ *//*-----------------------------------------------------------------*/
+
+void
+LBBoundary::defineDevice()
+{
+  std::vector<int> box;
+  std::vector<int> src;
+  std::vector<int> dst;
+  std::vector<Real> scale;
+  std::vector<Real> add;
+  for (int idx = 0, idxEnd = m_boxList.size(); idx != idxEnd; ++idx)
+    {
+      const BoxList& list = m_boxList[idx];
+      box.insert(box.end(), list.m_src.size(), idx);
+      src.insert(src.end(), list.m_src.begin(), list.m_src.end());
+      dst.insert(dst.end(), list.m_dst.begin(), list.m_dst.end());
+      scale.insert(scale.end(), list.m_scale.begin(), list.m_scale.end());
+      add.insert(add.end(), list.m_add.begin(), list.m_add.end());
+    }
+
+  // Copy an array to the device (null if empty)
+  const auto toDevice =
+    []
+    (auto*& a_device, const auto& a_host)
+    {
+      a_device = nullptr;
+      if (!a_host.empty())
+        {
+          const size_t numBytes = a_host.size()*sizeof(a_host[0]);
+          CU_SAFE_CALL(cudaMalloc(&a_device, numBytes));
+          CU_SAFE_CALL(cudaMemcpy(a_device, a_host.data(), numBytes,
+                                  cudaMemcpyHostToDevice));
+        }
+    };
+  m_deviceList.reset(
+    new LBPatch_Cuda::WallList,
+    []
+    (LBPatch_Cuda::WallList *const a_list)
+    {
+      CU_SAFE_CALL(cudaFree(a_list->m_box));
+      CU_SAFE_CALL(cudaFree(a_list->m_src));
+      CU_SAFE_CALL(cudaFree(a_list->m_dst));
+      CU_SAFE_CALL(cudaFree(a_list->m_scale));
+      CU_SAFE_CALL(cudaFree(a_list->m_add));
+      delete a_list;
+    });
+  m_deviceList->m_numEntry = box.size();
+  toDevice(m_deviceList->m_box, box);
+  toDevice(m_deviceList->m_src, src);
+  toDevice(m_deviceList->m_dst, dst);
+  toDevice(m_deviceList->m_scale, scale);
+  toDevice(m_deviceList->m_add, add);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+//  No-slip walls on the faces of the domain
+/** With periodic directions, the walls are only on the faces normal to
+ *  the other directions.
+ *  \param[in]  a_domain
+ *                      Problem domain
+ *  \return             Wall function with all cells outside the domain
+ *                      being Wall::noSlip
+ *//*-----------------------------------------------------------------*/
+
+LBBoundary::WallFunction
+LBBoundary::noSlipDomain(const Box& a_domain)
+{
+  return [a_domain]
+    (const IntVect& a_iv)
+    {
+      return a_domain.contains(a_iv) ? Wall::fluid : Wall::noSlip;
+    };
+}
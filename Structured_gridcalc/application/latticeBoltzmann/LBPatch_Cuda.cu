@@ -0,0 +1,168 @@
+
+/******************************************************************************/
+/**
+ * \file LBPatch_Cuda.cu
+ *
+ * \brief Isolated Cuda drivers for the lattice-Boltzmann kernels on all
+ *        local boxes of a level
+ *
+ *//*+*************************************************************************/
+
+#include "CudaFab.H"
+#include "BaseFabMacros.H"
+#include "LBParameters.H"
+#include "LBPatch_Cuda.H"
+
+/*
+ * The kernels are the loop bodies of LBBoundary::apply and
+ * LBPatch::collideStream written for a single cell and launched over all
+ * local boxes with BoxLoop_Cuda.
+ */
+
+//--Constant memory
+
+__constant__ int c_latticeVelocity[LBParameters::g_numVelDir][3];
+__constant__ Real c_weight[LBParameters::g_numVelDir];
+
+
+/*******************************************************************************
+ *
+ * Drivers
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Copy the lattice constants to the device
+/** Required once before the other drivers
+ *//*-----------------------------------------------------------------*/
+
+void
+LBPatch_Cuda::construct()
+{
+  CU_SAFE_CALL(cudaMemcpyToSymbol(c_latticeVelocity,
+                                  LBParameters::latticeVelocityP(0),
+                                  sizeof(c_latticeVelocity)));
+  CU_SAFE_CALL(cudaMemcpyToSymbol(c_weight,
+                                  LBParameters::g_weight,
+                                  sizeof(c_weight)));
+}
+
+/*--------------------------------------------------------------------*/
+//  Driver to apply the wall conditions to all local boxes
+/** The entries of all boxes are done in one kernel.  A destination is
+ *  never a source and appears in a single entry so the entries are
+ *  independent.
+ *  \param[in]  a_curr  Distributions (data on the device)
+ *  \param[out] a_curr  Distributions pulled from walls are set
+ *  \param[in]  a_wall  Entries of the local boxes
+ *  \param[in]  a_stream
+ *                      Stream on which to queue the kernel
+ *//*-----------------------------------------------------------------*/
+
+void
+LBPatch_Cuda::driverBoundary(
+  const BoxLoop_Cuda::FabTable<RealStorage>& a_curr,
+  const WallList&                            a_wall,
+  cudaStream_t                               a_stream)
+{
+  if (a_wall.m_numEntry == 0) return;
+  CudaFab<RealStorage> *const fabs = BoxLoop_Cuda::deviceFabs(a_curr);
+  const int *const box = a_wall.m_box;
+  const int *const src = a_wall.m_src;
+  const int *const dst = a_wall.m_dst;
+  const Real *const scale = a_wall.m_scale;
+  const Real *const add = a_wall.m_add;
+  // The entries are the cells of a box in the first direction
+  BoxLoop_Cuda::launch(
+    Box(IntVect(D_DECL(0, 0, 0)),
+        IntVect(D_DECL(a_wall.m_numEntry - 1, 0, 0))),
+    [=] __device__ (MD_DECLIX(const int, i))
+    {
+      CudaFab<RealStorage>& fab = fabs[box[i0]];
+      // Offsets are from the start of the data
+      RealStorage *const data = &fab(fab.box().loVect(), 0);
+      data[dst[i0]] = scale[i0]*data[src[i0]] + add[i0];
+    },
+    a_stream);
+}
+
+/*--------------------------------------------------------------------*/
+//  Driver for the fused stream, macroscopic, and collision on all
+//  local boxes
+/** Each thread pulls the distributions streaming into its cell,
+ *  computes the moments, and collides, as in LBPatch::collideStream.
+ *  The distributions are only read once so they are not cached in
+ *  shared memory.
+ *  \param[in]  a_curr  Post-collision distributions with ghost cells
+ *                      filled (data on the device)
+ *  \param[out] a_prev  New post-collision distributions in the valid
+ *                      cells
+ *  \param[out] a_macro Macroscopic variables in the valid cells
+ *  \param[in]  a_stream
+ *                      Stream on which to queue the kernel
+ *//*-----------------------------------------------------------------*/
+
+void
+LBPatch_Cuda::driverCollideStream(
+  const BoxLoop_Cuda::FabTable<RealStorage>& a_curr,
+  const BoxLoop_Cuda::FabTable<RealStorage>& a_prev,
+  const BoxLoop_Cuda::FabTable<Real>&        a_macro,
+  cudaStream_t                               a_stream)
+{
+  CH_assert(a_curr.numBox() == a_prev.numBox() &&
+            a_curr.numBox() == a_macro.numBox());
+  const CudaFab<RealStorage> *const fabsCurr =
+    BoxLoop_Cuda::deviceFabs(a_curr);
+  CudaFab<RealStorage> *const fabsPrev = BoxLoop_Cuda::deviceFabs(a_prev);
+  CudaFab<Real> *const fabsMacro = BoxLoop_Cuda::deviceFabs(a_macro);
+  BoxLoop_Cuda::launchBatch(
+    a_prev,
+    [=] __device__ (const int a_idxBox, MD_DECLIX(const int, i))
+    {
+      constexpr int numVel = LBParameters::g_numVelDir;
+      constexpr Real cs2 = LBParameters::g_cs2;
+      constexpr Real tau = LBParameters::g_tau;
+      const IntVect iv(MD_EXPANDIX(i));
+      const CudaFab<RealStorage>& fabSrc = fabsCurr[a_idxBox];
+      CudaFab<RealStorage>& fabDst = fabsPrev[a_idxBox];
+      CudaFab<Real>& fabMacro = fabsMacro[a_idxBox];
+
+      // Pull and accumulate moments (same order of summation as
+      // LBPatch::collideStream)
+      Real f[numVel];
+      Real rho = 0.;
+      Real u0 = 0.;
+      Real u1 = 0.;
+      Real u2 = 0.;
+      for (int k = 0; k != numVel; ++k)
+        {
+          const int *const e = c_latticeVelocity[k];
+          f[k] = fabSrc(iv - IntVect(e[0], e[1], e[2]), k);
+          rho += f[k];
+          u0 += f[k]*e[0];
+          u1 += f[k]*e[1];
+          u2 += f[k]*e[2];
+        }
+      u0 = u0/rho;
+      u1 = u1/rho;
+      u2 = u2/rho;
+      fabMacro(iv, 0) = rho;
+      fabMacro(iv, 1) = u0;
+      fabMacro(iv, 2) = u1;
+      fabMacro(iv, 3) = u2;
+
+      // Collide (same expressions as LBPhysics::collision)
+      for (int k = 0; k != numVel; ++k)
+        {
+          const int *const e = c_latticeVelocity[k];
+          const Real w = c_weight[k];
+          const Real force = 3*w*e[0]*LBParameters::g_bodyForce;
+          const Real ei_dot_u = u0*e[0] + u1*e[1] + u2*e[2];
+          const Real fi_eq = w*rho*(1 + ei_dot_u/cs2 +
+            ei_dot_u*ei_dot_u/(2*cs2*cs2) -
+            (u0*u0 + u1*u1 + u2*u2)/(2*cs2));
+          fabDst(iv, k) = f[k] + (fi_eq - f[k])/tau + force;
+        }
+    },
+    a_stream);
+}
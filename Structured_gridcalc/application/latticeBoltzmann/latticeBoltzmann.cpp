@@ -1,6 +1,15 @@
 #include "LBLevel.H"
+#include "InSitu.H"
+#include "AutoTune.H"
+#include "BoxTasks.H"
 #include "Stopwatch.H"
 #include <chrono>
+#include <cstring>
+#include <sstream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 /******************************************************************************/
 /**
@@ -20,7 +29,9 @@ int main(int argc, const char* argv[])
  	//std::ostringstream ost;
 	const bool verbose = 0;
 
-	DisjointBoxLayout::initMPI(argc, argv);
+	//With MPI_THREAD_MULTIPLE, a progress thread completes exchanges
+	DisjointBoxLayout::initMPI(argc, argv,
+	                           DisjointBoxLayout::ThreadSupport::multiple);
   	int numProc = DisjointBoxLayout::numProc();
   	int procID = DisjointBoxLayout::procID();
 	const bool masterProc = (procID == 0);
@@ -31,23 +42,140 @@ int main(int argc, const char* argv[])
     	}
 #endif
 
+	// Aligned, recycled storage that is first touched by the threads using it
+	BaseFab<Real>::setDefaultAllocBy(BaseFab<Real>::AllocBy::pool);
+	BaseFab<RealStorage>::setDefaultAllocBy(BaseFab<RealStorage>::AllocBy::pool);
+
+	//Box size, tiling and threads are from the autotune cache for this
+	//machine and problem if present.  With -tune, they are selected from
+	//short trials and saved to the cache.
+	const bool tune = (argc > 1 && std::strcmp(argv[1], "-tune") == 0);
+	std::ostringstream problem;
+	problem << "latticeBoltzmann " << domain.dimensions();
+	AutoTune tuner("autotune.cache", problem.str());
+	AutoTune::Config config = AutoTune::current(16*IntVect::Unit);
+	if(tune)
+	{
+		std::vector<int> numThreads;
+		int maxThread = 1;
+#ifdef _OPENMP
+		maxThread = omp_get_max_threads();
+#endif
+		for(int n = 1; n < maxThread; n *= 2) numThreads.push_back(n);
+		numThreads.push_back(maxThread);
+		//Time a few steps after the first, which touches the memory
+		config = tuner.tune(
+			AutoTune::candidates({ 8*IntVect::Unit, 16*IntVect::Unit,
+			                       32*IntVect::Unit },
+			                     { 0, 4096, BoxTasks::maxTileCells() },
+			                     { BoxTasks::tileShape() },
+			                     numThreads),
+			[&](const AutoTune::Config& a_config) -> double
+			{
+				const int numStep = 5;
+				DisjointBoxLayout dblTrial(domain, a_config.m_boxSize);
+				LBLevel lblvlTrial(dblTrial);
+				lblvlTrial.advance();
+				Stopwatch<std::chrono::steady_clock> trialTime;
+				trialTime.start();
+				for(int k = 0; k != numStep; ++k) lblvlTrial.advance();
+				trialTime.stop();
+				return trialTime.time()/numStep;
+			});
+		if(DisjointBoxLayout::procID() == 0)
+		{
+			for(int i = 0; i != tuner.numTrial(); ++i)
+			{
+				std::cout << "Trial " << i << ": " << tuner.trialTime(i)
+				          << " ms/step" << std::endl;
+			}
+		}
+	}
+	else if(tuner.lookup(config) == 0)
+	{
+		AutoTune::apply(config);
+	}
+	if(DisjointBoxLayout::procID() == 0)
+	{
+		std::cout << "Box size " << config.m_boxSize << ", task cells "
+		          << config.m_maxTileCells << ", threads "
+		          << config.m_numThread << std::endl;
+	}
+
 	Stopwatch<std::chrono::steady_clock> stopwatch;
 	stopwatch.start();
-  	DisjointBoxLayout dbl(domain, 16*IntVect::Unit);
+  	DisjointBoxLayout dbl(domain, config.m_boxSize);
 	LBLevel lblvl(dbl); //constructor with dbl
 
+	//In-situ analysis: small products are written often and full plot files
+	//rarely (all files are written to plot/)
+	const auto& macro = lblvl.macroData();
+	InSitu insitu;
+	insitu.add("plot", 2000, [&](const int a_iter)
+	{
+		std::cout << "Writing during iteration "<< a_iter << std::endl;
+		lblvl.writePlotFile(a_iter);
+	});
+	//Density and velocity averaged over 4^3 cells
+	insitu.add("coarse", 200, [&](const int a_iter)
+	{
+		std::vector<Real> prod;
+		InSitu::sample(macro, domain, 4, 0, 4, prod);
+		InSitu::writeSample(InSitu::fileName("plot/coarse", a_iter, 4),
+		                    domain, 4, 4, prod);
+	});
+	//x-velocity on the mid-plane normal to y
+	IntVect loSlice = domain.loVect();
+	IntVect hiSlice = domain.hiVect();
+	loSlice[1] = hiSlice[1] = (domain.loVect()[1] + domain.hiVect()[1])/2;
+	const Box slice(loSlice, hiSlice);
+	insitu.add("slice", 100, [&](const int a_iter)
+	{
+		std::vector<Real> prod;
+		InSitu::sample(macro, slice, 1, 1, 1, prod);
+		InSitu::writeSample(InSitu::fileName("plot/slice", a_iter, 4),
+		                    slice, 1, 1, prod);
+	});
+	//Histogram of the x-velocity over its current range
+	insitu.add("histogram", 200, [&](const int a_iter)
+	{
+		const Real lo = macro.reduce(Reduction::Op::min, 1, 1);
+		const Real hi = macro.reduce(Reduction::Op::max, 1, 1);
+		if(!(hi > lo)) return;
+		std::vector<Real> count;
+		InSitu::histogram(macro, 1, lo, hi, 32, count);
+		InSitu::writeHistogram(InSitu::fileName("plot/histogram", a_iter, 4),
+		                       lo, hi, count);
+	});
+	//Time series of the x-velocity at the center and near a wall
+	const IntVect ivCenter =
+	  (domain.loVect() + domain.hiVect())/(2*IntVect::Unit);
+	IntVect ivWall = ivCenter;
+	ivWall[g_SpaceDim-1] = domain.loVect()[g_SpaceDim-1];
+	InSitu::TimeSeries probes("plot/probes.dat", { "ux-center", "ux-wall" });
+	insitu.add("probes", 10, [&](const int a_iter)
+	{
+		std::vector<Real> atCenter, atWall;
+		InSitu::sample(macro, Box(ivCenter, ivCenter), 1, 1, 1, atCenter);
+		InSitu::sample(macro, Box(ivWall, ivWall), 1, 1, 1, atWall);
+		probes.record(a_iter, { atCenter[0], atWall[0] });
+	});
+
 	for(int k = 0; k<4001; ++k)
 	{
 		//iterate
-		if(k%200==0)
+#ifdef USE_GPU
+		if(insitu.due(k))
 		{
-			std::cout << "Writing during iteration "<< k << std::endl;
-			lblvl.writePlotFile(k);
+			lblvl.copyToHost();
 		}
+#endif
+		insitu.run(k);
 		
 		//std::cout << lblvl.computeTotalMass() << std::endl;
 		lblvl.advance();
 	}
+	lblvl.waitPlotFile();
 	
 	stopwatch.stop();
 	std::cout <<stopwatch.time() << std::endl;
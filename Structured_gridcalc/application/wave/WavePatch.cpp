@@ -11,10 +11,13 @@
 #include <iomanip>
 #include <iostream>
 #include <cmath>
-
-#include "cgnslib.h"
+#include <algorithm>
+#include <utility>
 
 #include "BaseFabMacros.H"
+#include "BoxTasks.H"
+#include "Copier.H"
+#include "Checkpoint.H"
 #include "WavePatch.H"
 #ifdef USE_GPU
 #include "WavePatch_Cuda.H"
@@ -35,6 +38,9 @@
 const int VecSz_r = 1;
 #endif
 
+// Uses vectors for the stencils if USE_VEX is defined
+#include "WaveOperator.H"
+
 
 /*******************************************************************************
  *
@@ -44,14 +50,20 @@ const int VecSz_r = 1;
 
 /*--------------------------------------------------------------------*/
 //  Constructor
-/*--------------------------------------------------------------------*/
+/** \param[in]  a_blockDepth
+ *                      Maximum number of steps advanced per ghost
+ *                      exchange by advanceBlock.  This is also the
+ *                      number of ghost cells.  Default 1 (no temporal
+ *                      blocking)
+ *//*-----------------------------------------------------------------*/
 
 WavePatch::WavePatch(const Box&        a_domain,
                      const IntVect&    a_maxBoxSize,
                      const char* const a_basePlotName,
                      const Real        a_c,
                      const Real        a_dx,
-                     const Real        a_cfl)
+                     const Real        a_cfl,
+                     const int         a_blockDepth)
   :
   m_boxes(a_domain, a_maxBoxSize),
   m_domain(a_domain),
@@ -63,11 +75,23 @@ WavePatch::WavePatch(const Box&        a_domain,
   m_iteration(0),
   m_idxStep(0),
   m_idxStepUpdate(1),
-  m_idxStepOld(2)
+  m_idxStepOld(2),
+  m_blockDepth(a_blockDepth),
+  m_plotWriter(a_basePlotName, a_domain.loVect(), a_dx)
 {
-  m_u[0].define(m_boxes, 1, 1);
-  m_u[1].define(m_boxes, 1, 1);
-  m_u[2].define(m_boxes, 1, 1);
+  CH_assert(m_blockDepth >= 1);
+#ifdef USE_GPU
+  // The GPU kernels assume a single layer of ghost cells
+  CH_assert(m_blockDepth == 1);
+#endif
+  // Pad rows so the stencils use full-width aligned vectors (ignored with
+  // GPUs)
+  const bool defaultAlignRows = PatchSolData::defaultAlignRows();
+  PatchSolData::setDefaultAlignRows(true);
+  m_u[0].define(m_boxes, 1, m_blockDepth);
+  m_u[1].define(m_boxes, 1, m_blockDepth);
+  m_u[2].define(m_boxes, 1, m_blockDepth);
+  PatchSolData::setDefaultAlignRows(defaultAlignRows);
   DataIterator dit(m_boxes);
   m_bidx = *dit;
 #ifdef USE_GPU
@@ -83,6 +107,19 @@ WavePatch::WavePatch(const Box&        a_domain,
                             m_workBoxInfoBC_device,
                             m_numBlkRHS,
                             m_numBlkBC);
+  // The solution stays on the device.  Kernels are queued on one stream and
+  // snapshots for plotting are copied to pinned host memory on another.
+  CU_SAFE_CALL(cudaStreamCreateWithFlags(&m_streamCompute,
+                                         cudaStreamNonBlocking));
+  CU_SAFE_CALL(cudaStreamCreateWithFlags(&m_streamCopy,
+                                         cudaStreamNonBlocking));
+  CU_SAFE_CALL(cudaEventCreateWithFlags(&m_cuEvent_solved,
+                                        cudaEventDisableTiming));
+  CU_SAFE_CALL(cudaEventCreateWithFlags(&m_cuEvent_snapshotCopied,
+                                        cudaEventDisableTiming));
+  m_snapshot.define(m_boxes, 1, m_blockDepth);
+  m_idxSnapshot = -1;
+  m_snapshotIteration = -1;
 #endif
 }
 
@@ -93,6 +130,12 @@ WavePatch::WavePatch(const Box&        a_domain,
 WavePatch::~WavePatch()
 {
 #ifdef USE_GPU
+  CU_SAFE_CALL(cudaStreamSynchronize(m_streamCopy));
+  CU_SAFE_CALL(cudaStreamSynchronize(m_streamCompute));
+  CU_SAFE_CALL(cudaEventDestroy(m_cuEvent_solved));
+  CU_SAFE_CALL(cudaEventDestroy(m_cuEvent_snapshotCopied));
+  CU_SAFE_CALL(cudaStreamDestroy(m_streamCopy));
+  CU_SAFE_CALL(cudaStreamDestroy(m_streamCompute));
   WavePatch_Cuda::destroy(m_cudaFab_device,
                           m_workBoxesRHS_device,
                           m_workBoxInfoBC_device);
@@ -110,7 +153,7 @@ WavePatch::initialData()
   constexpr Real pi = 3.141592653589793;
 
   MD_ARRAY_RESTRICT(arrun, un());
-  MD_BOXLOOP_OMP(m_domain, i)
+  MD_BOXLOOP_TILE_OMP(m_domain, i)
     {
       D_TERM(const Real x = (i0 + 0.5)*m_dx;,
              const Real y = (i1 + 0.5)*m_dx;,
@@ -130,7 +173,9 @@ WavePatch::initialData()
 
 /*--------------------------------------------------------------------*/
 //  Advance one time step
-/** Compute unp1() and time n+1 from un() and unm1().
+/** Compute unp1() and time n+1 from un() and unm1().  With GPUs, the
+ *  kernels are only queued on the compute stream and the solution
+ *  is not copied back to the host (see snapshot()).
  *//*-----------------------------------------------------------------*/
 
 void
@@ -138,20 +183,10 @@ WavePatch::advance()
 {
   m_timerAdvance.start();
 
-// Setup for VEX
-#ifdef USE_VEX
-  const int pencilSize  = m_domain.dimensions()[0];
-  const int vecPacked   = pencilSize/VecSz_r;
-  const int i0EndPacked = m_domain.loVect(0) + vecPacked*VecSz_r;
-  (void)i0EndPacked;
-#endif
-
 //--Set BC
 
 #ifdef USE_GPU
-  un().copyToDevice();
-  WavePatch_Cuda::driverBC(m_numBlkBC, m_idxStep);
-  un().copyToHost();
+  WavePatch_Cuda::driverBC(m_numBlkBC, m_idxStep, m_streamCompute);
 #else
   for (int dir = 0; dir != g_SpaceDim; ++dir)
     {
@@ -170,92 +205,189 @@ WavePatch::advance()
 
   const Real factor = std::pow(m_dt*m_c/m_dx, 2)/g_SpaceDim;
 #ifdef USE_GPU
-  un().copyToDevice();
-  unm1().copyToDevice();
+  // Do not overwrite a fab before its snapshot has been copied out
+  if (m_idxStepUpdate == m_idxSnapshot)
+    {
+      CU_SAFE_CALL(cudaStreamWaitEvent(m_streamCompute,
+                                       m_cuEvent_snapshotCopied,
+                                       0));
+      m_idxSnapshot = -1;
+    }
   WavePatch_Cuda::driverRHS(m_numBlkRHS,
                             m_idxStep,
                             m_idxStepUpdate,
                             m_idxStepOld,
-                            factor);
-  unp1().copyToHost();
+                            factor,
+                            m_streamCompute);
 #else
+  CH_assert(m_u[m_idxStep].nghost() >= WaveOperator::s_numGhost);
   MD_ARRAY_RESTRICT(arrunp1, unp1());
   MD_ARRAY_RESTRICT(arrun, un());
   MD_ARRAY_RESTRICT(arrunm1, unm1());
+  const bool aligned = (unp1().vectorAligned() && un().vectorAligned() &&
+                        unm1().vectorAligned());
 
-#ifdef USE_VEX
-  const __mvr two_vr = _mm_vr(set1)(2.0);
-  const __mvr factor_vr = _mm_vr(set1)(factor);
-  MD_BOXLOOP_PENCIL_OMP(m_domain, i)
+  MD_BOXLOOP_PENCIL_TILE_OMP(m_domain, i)
     {
-      int i0 = m_domain.loVect(0);
-      for (; i0 <= i0EndPacked; i0 += VecSz_r)
+      stencilPencil(m_domain.loVect(0), m_domain.hiVect(0), aligned,
+                    [=](const auto a_ops, const int i0)
         {
-          const __mvr unp1_vr =
-            two_vr*_mm_vr(loadu)(&arrun[MD_IX(i, 0)]) -
-                   _mm_vr(loadu)(&arrunm1[MD_IX(i, 0)]) + factor_vr*
-            MD_DIRSUM([=](const int            a_dir,
-                          MD_DECLIX(const int, a_o))
-              {
-                MD_CAPTURE_RESTRICT(arrun);
-                return
-                         _mm_vr(loadu)(&arrun[MD_OFFSETIX(i,+,a_o, 0)]) -
-                  two_vr*_mm_vr(loadu)(&arrun[MD_IX(i, 0)]) +
-                         _mm_vr(loadu)(&arrun[MD_OFFSETIX(i,-,a_o, 0)]);
-              });
-          _mm_vr(storeu)(&arrunp1[MD_IX(i, 0)], unp1_vr);
-        }
-      // Catch unpacked cells
-      for (; i0 <= m_domain.hiVect(0); ++i0)
-        {
-          arrunp1[MD_IX(i, 0)] =
-            2*arrun[MD_IX(i, 0)] - arrunm1[MD_IX(i, 0)] + factor*
-            MD_DIRSUM([=](const int a_dir,
-                          MD_DECLIX(const int, a_o))
-              {
-                MD_CAPTURE_RESTRICT(arrun);
-                return
-                    arrun[MD_OFFSETIX(i,+,a_o, 0)] -
-                  2*arrun[MD_IX(i, 0)] +
-                    arrun[MD_OFFSETIX(i,-,a_o, 0)];
-              });
-        }
+          MD_CAPTURE_RESTRICT(arrunp1);
+          a_ops.store(&arrunp1[MD_IX(i, 0)],
+                      WaveOperator::update(
+                        a_ops,
+                        factor,
+                        MD_STENCILLOAD(arrun, i, 0, a_ops),
+                        MD_STENCILLOAD(arrunm1, i, 0, a_ops)));
+        });
+    }
+#endif  /* !GPU */
+
+//--Swap indices (unp1->un, un->unm1)
+
+  advanceStepIndex();
+  ++m_iteration;
+  m_time += m_dt;
+  m_timerAdvance.stop();
+}
+
+/*--------------------------------------------------------------------*/
+//  Advance several time steps with a single ghost exchange
+/** Temporal blocking: the solution carries m_blockDepth ghost cells
+ *  which are filled once by a (periodic) exchange.  Step s of
+ *  a_numStep then updates the box grown by (a_numStep - s) so that
+ *  later steps find valid data in the ghost cells without further
+ *  communication.
+ *
+ *  Each level \f$u^{n+s}\f$ overwrites \f$u^{n+s-2}\f$ (only that
+ *  cell is read from the older level), so only the storage for un()
+ *  and unm1() is used.  The box is swept as a wavefront of planes
+ *  normal to the last direction.  Plane p of step s is updated in
+ *  wave p + 2(s-1): the planes of step s-1 it depends on were updated
+ *  in earlier waves and the planes updated in a single wave are
+ *  independent.  To bound the cache footprint, the wavefront is run
+ *  separately in slabs of s_blockSlabSize cells in the next lower
+ *  direction, skewed by one cell per step so a slab only depends on
+ *  slabs already completed.  The planes of all steps in flight then
+ *  stay in cache between steps and the box is read from memory about
+ *  once per block instead of once per step.
+ *  \param[in]  a_numStep
+ *                      Number of time steps to advance
+ *                      (1 <= a_numStep <= blockDepth())
+ *//*-----------------------------------------------------------------*/
+
+void
+WavePatch::advanceBlock(const int a_numStep)
+{
+  CH_assert(a_numStep >= 1 && a_numStep <= m_blockDepth);
+#ifdef USE_GPU
+  for (int s = 0; s != a_numStep; ++s)
+    {
+      advance();
     }
 #else
+  m_timerAdvance.start();
 
-  // Time terms
-  {
-    MD_BOXLOOP_OMP(m_domain, i)
-      {
-        arrunp1[MD_IX(i, 0)] = 2*arrun[MD_IX(i, 0)] - arrunm1[MD_IX(i, 0)];
-      }
-  }
+//--Fill ghosts of u^n and u^{n-1}
 
-  // Laplacian
-  for (int dir = 0; dir != g_SpaceDim; ++dir)
+  Copier& copier = CopierCache::exchangeDBL<PatchSolData::value_type>(
+    m_boxes, m_blockDepth, 0, 1, PeriodicX | PeriodicY | PeriodicZ);
+  m_u[m_idxStep].exchange(copier);
+  m_u[m_idxStepOld].exchange(copier);
+
+//--Update solution
+
+  const Real factor = std::pow(m_dt*m_c/m_dx, 2)/g_SpaceDim;
+  CH_assert(g_SpaceDim > 1);
+  constexpr int planeDir = g_SpaceDim - 1;
+  constexpr int slabDir = (g_SpaceDim > 1) ? g_SpaceDim - 2 : 0;
+  for (DataIterator dit(m_boxes); dit.ok(); ++dit)
     {
-      const int MD_ID(o, dir);
-      MD_BOXLOOP_OMP(m_domain, i)
+      PatchSolData& fabEven = m_u[m_idxStep][dit];     // u^n, u^{n+2}, ...
+      PatchSolData& fabOdd  = m_u[m_idxStepOld][dit];  // u^{n-1}, u^{n+1}, ...
+      const Box& box = m_boxes[dit];
+      const bool aligned = fabEven.vectorAligned() && fabOdd.vectorAligned();
+      const int waveLo = box.loVect(planeDir) - (a_numStep - 1);
+      const int waveHi = box.hiVect(planeDir) + 2*(a_numStep - 1);
+      const int slabLo = box.loVect(slabDir) - (a_numStep - 1);
+      const int slabHi = box.hiVect(slabDir) + (a_numStep - 1);
+#pragma omp parallel default(shared)
+      for (int slab = slabLo; slab <= slabHi; slab += s_blockSlabSize)
         {
-          arrunp1[MD_IX(i, 0)] += factor*(arrun[MD_OFFSETIX(i,+,o, 0)] -
-                                          2*arrun[MD_IX(i, 0)] +
-                                          arrun[MD_OFFSETIX(i,-,o, 0)]);
-        }         
+          for (int wave = waveLo; wave <= waveHi; ++wave)
+            {
+              for (int s = 1; s <= a_numStep; ++s)
+                {
+                  Box planeBox(box);
+                  planeBox.grow(a_numStep - s);
+                  const int p = wave - 2*(s - 1);
+                  if (p < planeBox.loVect(planeDir) ||
+                      p > planeBox.hiVect(planeDir)) continue;
+                  planeBox.loVect(planeDir) = p;
+                  planeBox.hiVect(planeDir) = p;
+                  // The slab for step s is skewed by (s - 1)
+                  planeBox.loVect(slabDir) =
+                    std::max(planeBox.loVect(slabDir), slab - (s - 1));
+                  planeBox.hiVect(slabDir) =
+                    std::min(planeBox.hiVect(slabDir),
+                             slab + s_blockSlabSize - 1 - (s - 1));
+                  if (planeBox.isEmpty()) continue;
+                  // Update u^{n+s} from u^{n+s-1}
+                  const PatchSolData& fabSrc = (s % 2) ? fabEven : fabOdd;
+                  PatchSolData& fabDst = (s % 2) ? fabOdd : fabEven;
+                  MD_ARRAY_RESTRICT(arrSrc, fabSrc);
+                  MD_ARRAY_RESTRICT(arrDst, fabDst);
+                  const IntVect planeDim = planeBox.dimensions();
+                  const int numRow = planeBox.size()/planeDim[0];
+#pragma omp for schedule(static) nowait
+                  for (int iRow = 0; iRow < numRow; ++iRow)
+                    {
+                      D_TERM((void)0;,
+                             const int i1 =
+                               planeBox.loVect(1) + iRow%planeDim[1];,
+                             const int i2 =
+                               planeBox.loVect(2) + iRow/planeDim[1];)
+                      stencilPencil(planeBox.loVect(0), planeBox.hiVect(0),
+                                    aligned,
+                                    [=](const auto a_ops, const int i0)
+                        {
+                          MD_CAPTURE_RESTRICT(arrDst);
+                          a_ops.store(&arrDst[MD_IX(i, 0)],
+                                      WaveOperator::update(
+                                        a_ops,
+                                        factor,
+                                        MD_STENCILLOAD(arrSrc, i, 0, a_ops),
+                                        MD_STENCILLOAD(arrDst, i, 0, a_ops)));
+                        });
+                    }
+                }
+#pragma omp barrier
+            }
+        }
     }
-#endif  /* !VEX */
-#endif  /* !GPU */
 
-//--Swap indices (unp1->un, un->unm1)
+//--Set indices (u^{n+a_numStep} is in fabOdd if a_numStep is odd)
 
-  advanceStepIndex();
-  ++m_iteration;
-  m_time += m_dt;
+  if (a_numStep % 2 == 1)
+    {
+      std::swap(m_idxStep, m_idxStepOld);
+    }
+  m_iteration += a_numStep;
+  m_time += a_numStep*m_dt;
   m_timerAdvance.stop();
+#endif  /* !GPU */
 }
 
 /*--------------------------------------------------------------------*/
 //  Advance a group of time steps using GPU
-/** 
+/** The kernels are queued on the compute stream and this returns
+ *  without waiting for them.
+ *  \param[in]  a_numIter
+ *                      Number of time steps to advance
+ *  \param[in]  a_cuEvent_iterGroupStart
+ *                      Event recorded before the first kernel
+ *  \param[in]  a_cuEvent_iterGroupEnd
+ *                      Event recorded after the last kernel
  *//*-----------------------------------------------------------------*/
 
 #ifdef USE_GPU
@@ -273,12 +405,76 @@ WavePatch::advanceIterGroup(const int   a_numIter,
                                          m_idxStepUpdate,
                                          m_idxStepOld,
                                          factor,
+                                         m_idxSnapshot,
+                                         m_cuEvent_snapshotCopied,
+                                         m_streamCompute,
                                          a_cuEvent_iterGroupStart,
                                          a_cuEvent_iterGroupEnd);
   m_iteration += a_numIter;
   m_time += a_numIter*m_dt;
   m_timerAdvance.stop();
 }
+
+/*--------------------------------------------------------------------*/
+//  Queue an asynchronous copy of un() on the device to the snapshot
+/** The copy is made on the copy stream once all kernels queued so
+ *  far on the compute stream have completed.  Further steps may be
+ *  queued immediately; the kernel that would next overwrite the
+ *  fab waits for the copy.  The BC kernel of the next step may
+ *  update ghost cells while they are being copied but these are not
+ *  written to plot files.
+ *  \param[in]  a_cuEvent_copyStart
+ *                      If not null, recorded on the copy stream
+ *                      before the copy
+ *  \param[in]  a_cuEvent_copyEnd
+ *                      If not null, recorded on the copy stream
+ *                      after the copy
+ *//*-----------------------------------------------------------------*/
+
+void
+WavePatch::snapshot(cudaEvent_t a_cuEvent_copyStart,
+                    cudaEvent_t a_cuEvent_copyEnd)
+{
+  if (m_idxSnapshot != -1)
+    {
+      // The previous snapshot is no longer tracked once its event is
+      // re-recorded so the compute stream must wait for it now.
+      CU_SAFE_CALL(cudaStreamWaitEvent(m_streamCompute,
+                                       m_cuEvent_snapshotCopied,
+                                       0));
+    }
+  CU_SAFE_CALL(cudaEventRecord(m_cuEvent_solved, m_streamCompute));
+  CU_SAFE_CALL(cudaStreamWaitEvent(m_streamCopy, m_cuEvent_solved, 0));
+  if (a_cuEvent_copyStart != nullptr)
+    {
+      CU_SAFE_CALL(cudaEventRecord(a_cuEvent_copyStart, m_streamCopy));
+    }
+  m_snapshot[m_bidx].copyDeviceToHostAsync(un(), m_streamCopy);
+  if (a_cuEvent_copyEnd != nullptr)
+    {
+      CU_SAFE_CALL(cudaEventRecord(a_cuEvent_copyEnd, m_streamCopy));
+    }
+  CU_SAFE_CALL(cudaEventRecord(m_cuEvent_snapshotCopied, m_streamCopy));
+  m_idxSnapshot = m_idxStep;
+  m_snapshotIteration = m_iteration;
+}
+
+/*--------------------------------------------------------------------*/
+//  Write the plot file from the snapshot
+/** Waits only for the snapshot copy, kernels on the compute stream
+ *  continue while the file is written.
+ *  \return             -1 Error
+ *                       0 Success
+ *                      >0 CGNS error
+ *//*-----------------------------------------------------------------*/
+
+int
+WavePatch::writeSnapshotPlotFile()
+{
+  CH_assert(m_snapshotIteration >= 0);
+  CU_SAFE_CALL(cudaEventSynchronize(m_cuEvent_snapshotCopied));
+  return writePlotFile(m_snapshot, m_snapshotIteration);
+}
 #endif
 
 /*--------------------------------------------------------------------*/
@@ -296,72 +492,116 @@ WavePatch::advanceIterGroup(const int   a_numIter,
 
 int
 WavePatch::writePlotFile(const int a_idxStep, const int a_iteration) const
+{
+  return writePlotFile(m_u[a_idxStep], a_iteration);
+}
+
+/*--------------------------------------------------------------------*/
+//  Write a plot file for a solution
+/** The solution is staged and the file is written in the background
+ *  (see PlotWriter).  Errors from a background write are returned by
+ *  the next call or by waitPlotFile.
+ *  \param[in]  a_u     Solution to write
+ *  \param[in]  a_iteration
+ *                      Index of iteration to write
+ *  \return             -1 Error
+ *                       0 Success
+ *                      >0 CGNS error
+ *//*-----------------------------------------------------------------*/
+
+int
+WavePatch::writePlotFile(const LevelSolData& a_u, const int a_iteration) const
 {
   m_timerWrite.start();
-#ifndef NO_CGNS
-  int cgerr;
-  std::ostringstream fileName;
-  fileName << m_basePlotName << std::setw(6) << std::setfill('0')
-           << a_iteration << ".cgns";
-
-  // Open the CGNS file
-  int indexFile;
-  cgerr = cg_open(fileName.str().c_str(), CG_MODE_WRITE, &indexFile);
-  if (cgerr)
-    {
-      cg_error_print();
-      m_timerWrite.stop();
-      return cgerr;
-    }
+  static const char *const stateNames[] = { "displacement" };
+  const int status = m_plotWriter.write(a_u, a_iteration, stateNames);
+  m_timerWrite.stop();
+  return status;
+}
 
-  // Create the base
-  int indexBase;
-  int iCellDim = g_SpaceDim;
-  int iPhysDim = g_SpaceDim;
-  cgerr = cg_base_write(indexFile, "Base", iCellDim, iPhysDim, &indexBase);
-  if (cgerr)
+/*--------------------------------------------------------------------*/
+//  Wait for plot files still being written
+/** \return             Status of the last plot file written (see
+ *                      writePlotFile)
+ *//*-----------------------------------------------------------------*/
+
+int
+WavePatch::waitPlotFile() const
+{
+  m_timerWrite.start();
+  const int status = m_plotWriter.wait();
+  m_timerWrite.stop();
+  return status;
+}
+
+/*--------------------------------------------------------------------*/
+//  Write a checkpoint file
+/** All time levels are written, including ghost cells, together with
+ *  the iteration, time, and step indices.  With GPUs, un() and unm1()
+ *  are first copied from the device.
+ *  \param[in]  a_fileName
+ *                      Name of the checkpoint file
+ *  \return             0 Success
+ *                     -1 Error
+ *//*-----------------------------------------------------------------*/
+
+int
+WavePatch::writeCheckpoint(const char* const a_fileName)
+{
+#ifdef USE_GPU
+  copyToHostAsync(m_idxStep);
+  copyToHostAsync(m_idxStepOld);
+  CU_SAFE_CALL(cudaStreamSynchronize(m_streamCompute));
+#endif
+  CheckpointWriter writer(m_boxes);
+  for (int idxStep = 0; idxStep != 3; ++idxStep)
     {
-      cg_error_print();
-      m_timerWrite.stop();
-      return cgerr;
+      writer.add(m_u[idxStep]);
     }
+  writer.setAttributes({ m_iteration, m_idxStep, m_idxStepUpdate,
+                         m_idxStepOld },
+                       { m_time });
+  return writer.write(a_fileName);
+}
 
-//--Write the zones and grids
-
-  // Write the grid coordinates
-  int indexZoneOffset;  // The difference between CGNS indexZone and the
-                        // globalBoxIndex
-  cgerr = m_boxes.writeCGNSZoneGrid(indexFile,
-                                    indexBase,
-                                    indexZoneOffset,
-                                    m_domain.loVect(),
-                                    m_dx);
-  if (cgerr)
+/*--------------------------------------------------------------------*/
+//  Restart from a checkpoint file
+/** This replaces initialData().  The file must have been written with
+ *  the same domain and temporal blocking depth.  With GPUs, the
+ *  solution must then be copied to the device.
+ *  \param[in]  a_fileName
+ *                      Name of the checkpoint file
+ *  \return             0 Success
+ *                     -1 Error
+ *//*-----------------------------------------------------------------*/
+
+int
+WavePatch::readCheckpoint(const char* const a_fileName)
+{
+  const CheckpointReader reader(a_fileName);
+  if (!reader.ok()) return -1;
+  if (reader.numData() != 3 || reader.intAttributes().size() != 4 ||
+      reader.realAttributes().size() != 1)
     {
-      std::cout << "EE Failed to write zone and grid for box " << cgerr-1 << '!'
-                << std::endl;
-      m_timerWrite.stop();
+      std::cout << "EE Checkpoint " << a_fileName
+                << " was not written by the wave solver!" << std::endl;
       return -1;
     }
-  
-  // Write the solution data
-  static const char *const stateNames[] = { "displacement" };
-  cgerr = m_u[a_idxStep].writeCGNSSolData(indexFile,
-                                          indexBase,
-                                          indexZoneOffset,
-                                          stateNames);
-  if (cgerr)
+  // Fabs are reused so any device memory stays valid
+  for (int idxStep = 0; idxStep != 3; ++idxStep)
     {
-      std::cout << "EE Failed to write solution for box " << cgerr-1 << '!'
-                << std::endl;
-      m_timerWrite.stop();
-      return -1;
+      if (reader.read(idxStep, m_boxes, m_u[idxStep]) != 0) return -1;
+      if (m_u[idxStep].nghost() != m_blockDepth)
+        {
+          std::cout << "EE Checkpoint " << a_fileName << " was written with "
+            "a different temporal blocking depth!" << std::endl;
+          return -1;
+        }
     }
-
-  // Close the CGNS file
-  cgerr = cg_close(indexFile);
-
-#endif  /* CGNS */
-  m_timerWrite.stop();
+  m_iteration     = reader.intAttributes()[0];
+  m_idxStep       = reader.intAttributes()[1];
+  m_idxStepUpdate = reader.intAttributes()[2];
+  m_idxStepOld    = reader.intAttributes()[3];
+  m_time          = reader.realAttributes()[0];
   return 0;
 }
@@ -8,6 +8,7 @@
  *//*+*************************************************************************/
 
 #include "CudaFab.H"
+#include "WaveOperator.H"
 #include "WavePatch_Cuda.H"
 
 template <typename T>
@@ -270,20 +271,27 @@ __global__ void kernelBC(const int a_idxStep)
  *                      is a face of a block on a boundary.
  *  \param[in]  a_idxStep
  *                      Index of BaseFab at time 'n'
+ *  \param[in]  a_stream
+ *                      Stream on which to queue the kernel
  *//*-----------------------------------------------------------------*/
 
 void
-WavePatch_Cuda::driverBC(const int a_numBlkBC, const int a_idxStep)
+WavePatch_Cuda::driverBC(const int    a_numBlkBC,
+                         const int    a_idxStep,
+                         cudaStream_t a_stream)
 {
-  kernelBC<<<a_numBlkBC, g_numThrBC, 0, 0>>>(a_idxStep);
+  kernelBC<<<a_numBlkBC, g_numThrBC, 0, a_stream>>>(a_idxStep);
 }
 
 /*--------------------------------------------------------------------*/
 /// RHS kernel on GPU
-/** \param[in]  a_timeN Index for fab at time \f$u^n\f$,
+/** Each thread updates a column of cells, normal to the work box,
+ *  through the compute block.  The update is the same WaveOperator
+ *  used on the CPU.
+ *  \param[in]  a_timeN Index for fab at time \f$u^n\f$,
  *  \param[in]  a_timeNp1
  *                      Index for fab at time \f$u^{n+1}\f$
- *  \param[in]  a_timeNp1
+ *  \param[in]  a_timeNm1
  *                      Index for fab at time \f$u^{n-1}\f$
  *  \param[in]  a_factor
  *                      \f$(\frac{\Delta t c}{\Delta x})^2\frac{1}{D}\f$
@@ -296,8 +304,29 @@ kernelRHS(const int a_timeN,
           const int a_timeNm1,
           const Real a_factor)
 {
-  //**FIXME Implement advance by updating u^{n+1}
-
+  const Box& workBox = c_workBoxesRHS[blockIdx.x];
+  const CudaFab<Real>& fabN   = c_fabs[a_timeN];
+  const CudaFab<Real>& fabNm1 = c_fabs[a_timeNm1];
+  CudaFab<Real>& fabNp1       = c_fabs[a_timeNp1];
+  const StencilOpsScalar ops;
+
+  IntVect iv;
+  workBox.linToVec(threadIdx.x, iv);
+  for (int k = 0; k != WavePatch_Cuda::g_blkSize; ++k)
+    {
+      fabNp1(iv, 0) = WaveOperator::update(
+        ops,
+        a_factor,
+        [&](MD_DECLIX(const int, a_o))
+        {
+          return fabN(iv + IntVect(MD_EXPANDIX(a_o)), 0);
+        },
+        [&](MD_DECLIX(const int, a_o))
+        {
+          return fabNm1(iv + IntVect(MD_EXPANDIX(a_o)), 0);
+        });
+      ++iv[WavePatch_Cuda::g_RHSNrmDirSlab];
+    }
 }
 
 /*--------------------------------------------------------------------*/
@@ -312,19 +341,22 @@ kernelRHS(const int a_timeN,
  *                      Index for fab at time \f$u^{n-1}\f$
  *  \param[in]  a_factor
  *                      \f$(\frac{\Delta t c}{\Delta x})^2\frac{1}{D}\f$
+ *  \param[in]  a_stream
+ *                      Stream on which to queue the kernel
  *//*-----------------------------------------------------------------*/
 
 void
-WavePatch_Cuda::driverRHS(const int  a_numBlkRHS,
-                          const int  a_idxStep,
-                          const int  a_idxStepUpdate,
-                          const int  a_idxStepOld,
-                          const Real a_factor)
+WavePatch_Cuda::driverRHS(const int    a_numBlkRHS,
+                          const int    a_idxStep,
+                          const int    a_idxStepUpdate,
+                          const int    a_idxStepOld,
+                          const Real   a_factor,
+                          cudaStream_t a_stream)
 {
-  kernelRHS<<<a_numBlkRHS, g_numThrRHSLS, 0, 0>>>(a_idxStep,
-                                                  a_idxStepUpdate,
-                                                  a_idxStepOld,
-                                                  a_factor);
+  kernelRHS<<<a_numBlkRHS, g_numThrRHSAr, 0, a_stream>>>(a_idxStep,
+                                                         a_idxStepUpdate,
+                                                         a_idxStepOld,
+                                                         a_factor);
 }
 
 /*--------------------------------------------------------------------*/
@@ -343,6 +375,17 @@ WavePatch_Cuda::driverRHS(const int  a_numBlkRHS,
  *                      Index for fab at time \f$u^{n-1}\f$
  *  \param[in]  a_factor
  *                      \f$(\frac{\Delta t c}{\Delta x})^2\frac{1}{D}\f$
+ *  \param[in]  a_idxSnapshot
+ *                      Index of a fab still being copied to a
+ *                      snapshot on another stream (-1 if none)
+ *  \param[out] a_idxSnapshot
+ *                      -1 once a kernel overwriting that fab has been
+ *                      made to wait for the copy
+ *  \param[in]  a_cuEvent_snapshotCopied
+ *                      Event recorded once the snapshot copy is
+ *                      complete
+ *  \param[in]  a_stream
+ *                      Stream on which to queue the kernels
  *  \param[out] a_cuEvent_iterGroupStart
  *                      Timer at start of iteration group
  *  \param[out] a_cuEvent_iterGroupEnd
@@ -357,22 +400,33 @@ WavePatch_Cuda::driverAdvanceIterGroup(const int   a_numIter,
                                        int&        a_idxStepUpdate,
                                        int&        a_idxStepOld,
                                        const Real  a_factor,
+                                       int&        a_idxSnapshot,
+                                       cudaEvent_t a_cuEvent_snapshotCopied,
+                                       cudaStream_t a_stream,
                                        cudaEvent_t a_cuEvent_iterGroupStart,
                                        cudaEvent_t a_cuEvent_iterGroupEnd)
 {
-  cudaEventRecord(a_cuEvent_iterGroupStart, 0);
+  cudaEventRecord(a_cuEvent_iterGroupStart, a_stream);
   for (int iter = 0; iter != a_numIter; ++iter)
     {
-      kernelBC<<<a_numBlkBC, g_numThrBC, 0, 0>>>(a_idxStep);
-      kernelRHS<<<a_numBlkRHS, g_numThrRHSAr, 0, 0>>>(a_idxStep,
-                                                      a_idxStepUpdate,
-                                                      a_idxStepOld,
-                                                      a_factor);
+      kernelBC<<<a_numBlkBC, g_numThrBC, 0, a_stream>>>(a_idxStep);
+      // Do not overwrite a fab before its snapshot has been copied out
+      if (a_idxStepUpdate == a_idxSnapshot)
+        {
+          CU_SAFE_CALL(cudaStreamWaitEvent(a_stream,
+                                           a_cuEvent_snapshotCopied,
+                                           0));
+          a_idxSnapshot = -1;
+        }
+      kernelRHS<<<a_numBlkRHS, g_numThrRHSAr, 0, a_stream>>>(a_idxStep,
+                                                             a_idxStepUpdate,
+                                                             a_idxStepOld,
+                                                             a_factor);
       // Advance step indices
       const int tmp   = a_idxStepOld;
       a_idxStepOld    = a_idxStep;
       a_idxStep       = a_idxStepUpdate;
       a_idxStepUpdate = tmp;
     }
-  cudaEventRecord(a_cuEvent_iterGroupEnd, 0);
+  cudaEventRecord(a_cuEvent_iterGroupEnd, a_stream);
 }
@@ -10,12 +10,15 @@
 #include <iostream>
 #include <iomanip>
 #include <cmath>
+#include <sstream>
 
 #include "LinuxSupport.H"
 #include "IntVect.H"
 #include "Box.H"
 #include "WavePatch.H"
 #include "Stopwatch.H"
+#include "BoxTasks.H"
+#include "AutoTune.H"
 
 #ifdef USE_GPU
 #include "CudaSupport.H"
@@ -30,9 +33,18 @@
 #endif
 
 static const char *const usage =
-  "Usage ./wave [-np x] [h [i]]\n"
+  "Usage ./wave [-np x] [-k k] [-c file] [-r file] [-tune] [h [i]]\n"
   "  x : number of threads for OpenMP.  You can also use\n"
   "      'export OMP_NUM_THREADS=x' to use x threads with OpenMP.\n"
+  "  k : temporal blocking depth -- number of time steps advanced per\n"
+  "      exchange of k ghost cells (1 <= k <= h, default=1).\n"
+  "  -c file : write a checkpoint to file at the end of the run.\n"
+  "  -r file : restart from the checkpoint in file (written with the same\n"
+  "      h and k).  The run continues to iteration i.\n"
+  "  -tune : select the tile shape and number of threads from\n"
+  "      short trials and save them to autotune.cache.  Without -tune,\n"
+  "      they are read from autotune.cache if it has an entry for this\n"
+  "      machine and problem.\n"
   "  h : domain dimensions in y and z (multiple of 32, default=32).\n"
   "  i : number of iterations (i > 0, default=4000*(h/32)).\n"
   "\n  Use 'export OMP_PROC_BIND=TRUE' to lock thread affinity in OpenMP.\n";
@@ -61,6 +73,10 @@ int main(int argc, const char* argv[])
 //--Input parameters for the run
 
   bool badArg = false;
+  int blockDepth_in = 1;
+  const char* checkpointFile = nullptr;
+  const char* restartFile = nullptr;
+  bool tune = false;
   int iargc = 1;
   while (argc > iargc && argv[iargc][0] == '-')
     {
@@ -74,6 +90,31 @@ int main(int argc, const char* argv[])
 #endif
           iargc += 2;
         }
+      else if (std::strcmp(argv[iargc], "-k") == 0 && argc > iargc + 1)
+        {
+          blockDepth_in = std::atoi(argv[iargc+1]);
+          iargc += 2;
+        }
+      else if (std::strcmp(argv[iargc], "-c") == 0 && argc > iargc + 1)
+        {
+          checkpointFile = argv[iargc+1];
+          iargc += 2;
+        }
+      else if (std::strcmp(argv[iargc], "-r") == 0 && argc > iargc + 1)
+        {
+          restartFile = argv[iargc+1];
+          iargc += 2;
+        }
+      else if (std::strcmp(argv[iargc], "-tune") == 0)
+        {
+          tune = true;
+          ++iargc;
+        }
+      else
+        {
+          badArg = true;
+          ++iargc;
+        }
     }
 
   int h_in = 64;  // 32 is baseline
@@ -106,6 +147,7 @@ int main(int argc, const char* argv[])
 
   const int h = h_in;
   const int numIter = numIter_in;
+  const int blockDepth = blockDepth_in;
   const char *const plotDir = "plot";
   const char *const plotFileBase = "plot/plot.";
   // For canonical h = 32
@@ -150,12 +192,99 @@ int main(int argc, const char* argv[])
       std::cout << "Number of iterations must be >= 0!" << std::endl;
       ++paramErr;
     }
+  if (blockDepth < 1 || blockDepth > boxSize)
+    {
+      std::cout << "Temporal blocking depth must be in [1, boxSize]!"
+                << std::endl;
+      ++paramErr;
+    }
+#ifdef USE_GPU
+  if (blockDepth != 1)
+    {
+      std::cout << "Temporal blocking is not supported on the GPU!"
+                << std::endl;
+      ++paramErr;
+    }
+#endif
   if (paramErr)
     {
       std::cout << usage;
       return 1;
     }
 
+//--Select the tile shape and number of threads
+
+  const Box domain(IntVect::Zero, domainSize - IntVect::Unit);
+  {
+    std::ostringstream problem;
+    problem << "wave " << h << " k" << blockDepth;
+    AutoTune tuner("autotune.cache", problem.str());
+    AutoTune::Config config = AutoTune::current(boxSize*IntVect::Unit);
+    if (tune)
+      {
+#ifdef USE_GPU
+        std::cout << "Autotuning is not supported on the GPU!" << std::endl;
+        return 1;
+#else
+        // The solution is a single box so only the tiles within it and the
+        // threads are tuned
+        std::vector<int> numThreads;
+        for (int n = 1; n < omp_get_max_threads(); n *= 2)
+          {
+            numThreads.push_back(n);
+          }
+        numThreads.push_back(omp_get_max_threads());
+        // Time a few steps after the first, which touches the memory
+        config = tuner.tune(
+          AutoTune::candidates({ boxSize*IntVect::Unit },
+                               { BoxTasks::maxTileCells() },
+                               { IntVect(D_DECL(0, 2, 2)),
+                                 IntVect(D_DECL(0, 4, 4)),
+                                 IntVect(D_DECL(0, 8, 8)),
+                                 IntVect::Zero },
+                               numThreads),
+          [&](const AutoTune::Config& a_config) -> double
+          {
+            const int numStep = 4*blockDepth;
+            WavePatch trialSolver(domain,
+                                  a_config.m_boxSize,
+                                  plotFileBase,
+                                  c,
+                                  dx,
+                                  cfl,
+                                  blockDepth);
+            trialSolver.initialData();
+            trialSolver.advance();
+            Stopwatch<> trialTime;
+            trialTime.start();
+            for (int iStep = 0; iStep < numStep; iStep += blockDepth)
+              {
+                if (blockDepth > 1)
+                  {
+                    trialSolver.advanceBlock(blockDepth);
+                  }
+                else
+                  {
+                    trialSolver.advance();
+                  }
+              }
+            trialTime.stop();
+            return trialTime.time()/numStep;
+          });
+        for (int i = 0; i != tuner.numTrial(); ++i)
+          {
+            std::cout << "Trial " << std::setw(3) << i << ": "
+                      << tuner.trialTime(i) << " ms/step" << std::endl;
+          }
+        std::cout << std::endl;
+#endif
+      }
+    else if (tuner.lookup(config) == 0)
+      {
+        AutoTune::apply(config);
+      }
+  }
+
 //--Write information about the run
 
   std::cout << std::left << std::setw(40) << "Box size: " << boxSize
@@ -167,8 +296,14 @@ int main(int argc, const char* argv[])
             << std::endl;
   std::cout << std::left << std::setw(40) << "Plot frequency: "
             << plotFreq << std::endl;
+  std::cout << std::left << std::setw(40) << "Temporal blocking depth: "
+            << blockDepth << std::endl;
+  std::cout << std::left << std::setw(40) << "Tile shape: "
+            << BoxTasks::tileShape() << std::endl;
   std::cout << std::left << std::setw(40) << "Precision: "
             << 8*sizeof(Real) << " bits\n";
+  std::cout << std::left << std::setw(40) << "Storage precision: "
+            << 8*sizeof(WavePatch::PatchSolData::value_type) << " bits\n";
 #ifdef _OPENMP
   std::cout << std::left << std::setw(40) << "Parallel OpenMP threads: "
             << omp_get_max_threads() << std::endl;
@@ -177,17 +312,29 @@ int main(int argc, const char* argv[])
 
 //--Data structures
 
-  const Box domain(IntVect::Zero, domainSize - IntVect::Unit);
   WavePatch patchSolver(domain,
                         boxSize*IntVect::Unit,
                         plotFileBase,
                         c,
                         dx,
-                        cfl);
+                        cfl,
+                        blockDepth);
 
 //--Initialize data
 
-  patchSolver.initialData();
+  if (restartFile)
+    {
+      if (patchSolver.readCheckpoint(restartFile) != 0)
+        {
+          return 1;
+        }
+      std::cout << "Restarted at iteration " << patchSolver.iteration()
+                << " from " << restartFile << std::endl << std::endl;
+    }
+  else
+    {
+      patchSolver.initialData();
+    }
 
 //--Write the first plot file if numIter == 0
 
@@ -207,10 +354,6 @@ int main(int argc, const char* argv[])
 
   int numGroupIter = 0; (void)numGroupIter;
 #ifdef USE_GPU
-  if (plotFreq % 3 == 0)  // Can copy next solution and write current
-    {                     // at same time
-      std::cout << "Unable to overlap copy with plot writing." << std::endl;
-    }
   Stopwatch<> timerIdleCPU;
   // Timings on GPU
   cudaEvent_t cuEvent_iterGroupStart;
@@ -223,30 +366,25 @@ int main(int argc, const char* argv[])
   CU_SAFE_CALL(cudaEventCreate(&cuEvent_copyStart));
   CU_SAFE_CALL(cudaEventCreate(&cuEvent_copyEnd));
   float gpuCopy = 0.f;
-  // Copy to device
+  // Copy to device.  The solution then stays on the device and only
+  // snapshots for plotting are copied back.
   patchSolver.copyToDeviceAsync(patchSolver.currentStepIndex());
   patchSolver.copyToDeviceAsync(patchSolver.oldStepIndex());
-  numGroupIter = numIter/plotFreq;
+  numGroupIter = std::max(0, numIter - patchSolver.iteration())/plotFreq;
   for (int iIterGroup = 0; iIterGroup != numGroupIter; ++iIterGroup)
     {
-      // Save the current step index and iteration
-      const int currentStepIndex = patchSolver.currentStepIndex();
+      // Save the current iteration
       const int currentIteration = patchSolver.iteration();
       const Real currentTime = patchSolver.time();
-      // Launch the kernels
+      // Snapshot the current solution on the copy stream
+      patchSolver.snapshot(cuEvent_copyStart, cuEvent_copyEnd);
+      // Launch the kernels (these proceed while the snapshot is copied and
+      // written)
       patchSolver.advanceIterGroup(plotFreq,
                                    cuEvent_iterGroupStart,
                                    cuEvent_iterGroupEnd);
-      // Copy results back from GPU
-      cudaEventRecord(cuEvent_copyStart, 0);
-      // std::cout << "Copying to " << patchSolver.currentStepIndex()
-      //           << " at iter " << patchSolver.iteration() << std::endl;
-      patchSolver.copyToHostAsync(patchSolver.currentStepIndex());
-      cudaEventRecord(cuEvent_copyEnd, 0);
-      // Write the plot file (from previous block)
-      // std::cout << "Writing from " << currentStepIndex
-      //           << " at iter " << currentIteration << std::endl;
-      patchSolver.writePlotFile(currentStepIndex, currentIteration);
+      // Write the plot file from the snapshot
+      patchSolver.writeSnapshotPlotFile();
       // Write progress (complete once plotfile is written)
       if (iIterGroup != 0)
         {
@@ -258,8 +396,7 @@ int main(int argc, const char* argv[])
         }
       // Synchronize
       timerIdleCPU.start();
-      CU_SAFE_CALL(cudaDeviceSynchronize());
-      // std::cout << "Synchronized" << std::endl;
+      CU_SAFE_CALL(cudaEventSynchronize(cuEvent_iterGroupEnd));
       timerIdleCPU.stop();
       float elapsed;
       CU_SAFE_CALL(
@@ -282,10 +419,8 @@ int main(int argc, const char* argv[])
                             patchSolver.iteration(),
                             patchSolver.time());
       // Write the plot file from last iteration group
-      // std::cout << "Writing from " << patchSolver.currentStepIndex()
-      //           << " at iter " << patchSolver.iteration() << std::endl;
-      patchSolver.writePlotFile(patchSolver.currentStepIndex(),
-                                patchSolver.iteration());
+      patchSolver.snapshot();
+      patchSolver.writeSnapshotPlotFile();
       writeOnFirstSingleIter = false;
     }
 #endif
@@ -293,7 +428,8 @@ int main(int argc, const char* argv[])
 //--Run single iterations
 
   const int numSingleIter = numIter - patchSolver.iteration();
-  for (int iter = patchSolver.iteration(); iter != numIter; ++iter)
+  for (int iter = patchSolver.iteration(); iter < numIter;
+       iter = patchSolver.iteration())
     {
       if (iter % plotFreq == 0 && writeOnFirstSingleIter)
         {
@@ -306,8 +442,13 @@ int main(int argc, const char* argv[])
                     << patchSolver.iteration()
                     << " Old time " << std::scientific
                     << patchSolver.time() << std::endl;
+#ifdef USE_GPU
+          patchSolver.snapshot();
+          patchSolver.writeSnapshotPlotFile();
+#else
           patchSolver.writePlotFile(patchSolver.currentStepIndex(),
                                     patchSolver.iteration());
+#endif
         }
       else
         {
@@ -321,7 +462,17 @@ int main(int argc, const char* argv[])
             }
         }
       writeOnFirstSingleIter = true;
-      patchSolver.advance();
+      // With temporal blocking, advance up to the next plot or the end
+      const int numStep = std::min(std::min(blockDepth, numIter - iter),
+                                   plotFreq - iter % plotFreq);
+      if (numStep > 1)
+        {
+          patchSolver.advanceBlock(numStep);
+        }
+      else
+        {
+          patchSolver.advance();
+        }
     }
 
 //--Write the final plot file
@@ -337,9 +488,29 @@ int main(int argc, const char* argv[])
                 << std::scientific << patchSolver.time() << std::endl;
       if (numSingleIter != 0)
         {
+#ifdef USE_GPU
+          patchSolver.snapshot();
+          patchSolver.writeSnapshotPlotFile();
+#else
           patchSolver.writePlotFile(patchSolver.currentStepIndex(),
                                     patchSolver.iteration());
+#endif
+        }
+    }
+
+//--Finish writing plot files
+
+  patchSolver.waitPlotFile();
+
+//--Write a checkpoint for restarting
+
+  if (checkpointFile)
+    {
+      if (patchSolver.writeCheckpoint(checkpointFile) != 0)
+        {
+          return 1;
         }
+      std::cout << "Wrote checkpoint " << checkpointFile << std::endl;
     }
 
 //--Write some times
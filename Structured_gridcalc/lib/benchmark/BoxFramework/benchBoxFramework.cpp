@@ -0,0 +1,766 @@
+
+/******************************************************************************/
+/**
+ * \file benchBoxFramework.cpp
+ *
+ * \brief Micro-benchmarks of BoxFramework kernels
+ *
+ *//*+*************************************************************************/
+
+/*
+ * Each kernel is timed over a sweep of box sizes and numbers of components.
+ * For each case, the best time of several trials is used to compute the
+ * achieved bandwidth (GB/s) and floating-point rate (GFLOP/s).  Bytes are
+ * the compulsory traffic (each array read or written once per call) so the
+ * bandwidth is a lower bound.  Bandwidth is compared against the STREAM triad
+ * measured at startup and, for kernels that compute, the rate is compared
+ * against the roofline bound, STREAM bandwidth x arithmetic intensity.
+ *
+ * Usage: benchBoxFramework [-q] [-s 16,32,...] [-c 1,4,...] [-t seconds]
+ *                          [-o file.csv]
+ *   -q  quick sweep (small boxes, short trials)
+ *   -s  box sizes (cells in each direction)
+ *   -c  numbers of components
+ *   -t  minimum time for a trial in seconds
+ *   -o  file for machine-readable (CSV) results (default
+ *       benchBoxFramework.csv)
+ *
+ * With MPI, exchange and copier cases are collective and report the maximum
+ * time over all processes.  All other cases are local to each process and
+ * are reported from process 0.
+ */
+
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
+#include "BaseFab.H"
+#include "BoxIterator.H"
+#include "BaseFabMacros.H"
+#include "BoxTasks.H"
+#include "DisjointBoxLayout.H"
+#include "LevelData.H"
+#include "Copier.H"
+#include "Stopwatch.H"
+#include "VEXTypes.H"
+
+//--Configuration
+
+static double s_minTrialTime = 0.05;  ///< Minimum time for a trial (s)
+static int s_numTrial = 5;            ///< Number of trials (best is kept)
+
+
+/*******************************************************************************
+ */
+///  A collection of benchmark results
+/**
+ *   Results are written to std::cout as a table and to a file in CSV
+ *   format.
+ *
+ *//*+*************************************************************************/
+
+class BenchReport
+{
+public:
+
+  /// Result of one case
+  struct Result
+  {
+    std::string m_name;               ///< Name of kernel
+    int m_boxSize;                    ///< Cells in each direction
+    int m_ncomp;                      ///< Number of components
+    double m_time;                    ///< Best time for a call (s)
+    double m_bytes;                   ///< Bytes moved in a call
+    double m_flops;                   ///< Floating-point ops in a call
+  };
+
+  /// Constructor
+  BenchReport(const double a_streamBW)
+    :
+    m_streamBW(a_streamBW)
+    { }
+
+  /// Add a result
+  void add(const std::string& a_name,
+           const int          a_boxSize,
+           const int          a_ncomp,
+           const double       a_time,
+           const double       a_bytes,
+           const double       a_flops);
+
+  /// Write the table header to std::cout
+  void writeHeader() const;
+
+  /// Write all results in CSV format
+  void writeCSV(std::ostream& a_os) const;
+
+private:
+
+  /// Width of the kernel name column (fits the longest name)
+  static constexpr int s_nameWidth = 34;
+
+  double m_streamBW;                  ///< STREAM bandwidth (GB/s)
+  std::vector<Result> m_results;      ///< All results
+};
+
+/*--------------------------------------------------------------------*/
+//  Add a result (and write it to std::cout)
+/** \param[in]  a_name  Name of kernel
+ *  \param[in]  a_boxSize
+ *                      Cells in each direction
+ *  \param[in]  a_ncomp Number of components
+ *  \param[in]  a_time  Best time for a call (s)
+ *  \param[in]  a_bytes Bytes moved in a call
+ *  \param[in]  a_flops Floating-point operations in a call
+ *//*-----------------------------------------------------------------*/
+
+void
+BenchReport::add(const std::string& a_name,
+                 const int          a_boxSize,
+                 const int          a_ncomp,
+                 const double       a_time,
+                 const double       a_bytes,
+                 const double       a_flops)
+{
+  m_results.push_back(
+    Result{ a_name, a_boxSize, a_ncomp, a_time, a_bytes, a_flops });
+  if (DisjointBoxLayout::procID() != 0) return;
+  const double gbs = 1.E-9*a_bytes/a_time;
+  std::cout << std::left << std::setw(s_nameWidth) << a_name << std::right
+            << std::setw(6) << a_boxSize
+            << std::setw(4) << a_ncomp
+            << std::fixed << std::setprecision(4)
+            << std::setw(12) << 1.E3*a_time
+            << std::setprecision(2);
+  if (a_bytes > 0.)
+    {
+      std::cout << std::setw(10) << gbs
+                << std::setw(8) << 100.*gbs/m_streamBW;
+    }
+  if (a_bytes > 0. && a_flops > 0.)
+    {
+      const double ai = a_flops/a_bytes;
+      std::cout << std::setw(10) << 1.E-9*a_flops/a_time
+                << std::setprecision(3)
+                << std::setw(8) << ai
+                << std::setprecision(2)
+                << std::setw(10) << ai*m_streamBW;
+    }
+  std::cout << std::endl;
+  std::cout.unsetf(std::ios_base::floatfield);
+}
+
+/*--------------------------------------------------------------------*/
+//  Write the table header to std::cout
+/*--------------------------------------------------------------------*/
+
+void
+BenchReport::writeHeader() const
+{
+  if (DisjointBoxLayout::procID() != 0) return;
+  std::cout << std::left << std::setw(s_nameWidth) << "kernel" << std::right
+            << std::setw(6) << "n"
+            << std::setw(4) << "nc"
+            << std::setw(12) << "time (ms)"
+            << std::setw(10) << "GB/s"
+            << std::setw(8) << "%STREAM"
+            << std::setw(10) << "GFLOP/s"
+            << std::setw(8) << "AI"
+            << std::setw(10) << "roofline" << std::endl;
+}
+
+/*--------------------------------------------------------------------*/
+//  Write all results in CSV format
+/** \param[in]  a_os    Stream to write to
+ *//*-----------------------------------------------------------------*/
+
+void
+BenchReport::writeCSV(std::ostream& a_os) const
+{
+  a_os << "# STREAM triad bandwidth (GB/s): " << m_streamBW << '\n';
+  a_os << "kernel,box_size,ncomp,time_s,bytes,flops,GBps,GFLOPps,"
+    "fraction_stream,arith_intensity,roofline_GFLOPps\n";
+  a_os << std::setprecision(6);
+  for (const Result& result : m_results)
+    {
+      const double gbs = 1.E-9*result.m_bytes/result.m_time;
+      const double ai =
+        (result.m_bytes > 0.) ? result.m_flops/result.m_bytes : 0.;
+      a_os << result.m_name << ','
+           << result.m_boxSize << ','
+           << result.m_ncomp << ','
+           << result.m_time << ','
+           << result.m_bytes << ','
+           << result.m_flops << ','
+           << gbs << ','
+           << 1.E-9*result.m_flops/result.m_time << ','
+           << gbs/m_streamBW << ','
+           << ai << ','
+           << ai*m_streamBW << '\n';
+    }
+}
+
+
+/*******************************************************************************
+ *
+ * Support routines
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+/// Best time for a call to a kernel
+/** Repetitions in a trial are doubled until the trial takes at least
+ *  s_minTrialTime.  The best of s_numTrial trials is returned.
+ *  \param[in]  a_kernel
+ *                      Kernel to time
+ *  \param[in]  a_collective
+ *                      T - the kernel is collective over all
+ *                          processes.  Processes are synchronized
+ *                          before each trial and the maximum time is
+ *                          used so all processes make the same
+ *                          decisions.
+ *  \return             Time for a call (s)
+ *//*-----------------------------------------------------------------*/
+
+template <typename F>
+static double
+bestTime(F&& a_kernel, const bool a_collective = false)
+{
+  using seconds = std::ratio<1>;
+  Stopwatch<> timer;
+  auto trial =
+    [&](const long a_numRep)
+    {
+#ifdef USE_MPI
+      if (a_collective) MPI_Barrier(MPI_COMM_WORLD);
+#endif
+      timer.reset();
+      timer.start();
+      for (long iRep = 0; iRep != a_numRep; ++iRep)
+        {
+          a_kernel();
+        }
+      timer.stop();
+      double time = timer.time<seconds>();
+#ifdef USE_MPI
+      if (a_collective)
+        {
+          MPI_Allreduce(MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX,
+                        MPI_COMM_WORLD);
+        }
+#endif
+      return time;
+    };
+
+  a_kernel();  // Warm up
+  long numRep = 1;
+  double time = trial(numRep);
+  while (time < s_minTrialTime)
+    {
+      numRep *= 2;
+      time = trial(numRep);
+    }
+  double best = time/numRep;
+  for (int iTrial = 1; iTrial < s_numTrial; ++iTrial)
+    {
+      best = std::min(best, trial(numRep)/numRep);
+    }
+  return best;
+}
+
+/*--------------------------------------------------------------------*/
+/// Measure bandwidth with the STREAM triad
+/** \param[in]  a_size  Number of elements in each array (should be
+ *                      much larger than the last-level cache)
+ *  \return             Bandwidth (GB/s) counting 3 arrays per call
+ *//*-----------------------------------------------------------------*/
+
+static double
+streamTriad(const long a_size)
+{
+  std::unique_ptr<Real[]> a(new Real[a_size]);
+  std::unique_ptr<Real[]> b(new Real[a_size]);
+  std::unique_ptr<Real[]> c(new Real[a_size]);
+  Real *const __restrict__ pa = a.get();
+  const Real *const __restrict__ pb = b.get();
+  const Real *const __restrict__ pc = c.get();
+  // First touch with the same distribution of threads as the kernel
+#pragma omp parallel for
+  for (long i = 0; i < a_size; ++i)
+    {
+      a[i] = 0.;
+      b[i] = 1.;
+      c[i] = 2.;
+    }
+  const Real scalar = 3.;
+  const double time = bestTime(
+    [=]()
+    {
+#pragma omp parallel for
+      for (long i = 0; i < a_size; ++i)
+        {
+          pa[i] = pb[i] + scalar*pc[i];
+        }
+    });
+  return 1.E-9*3*a_size*sizeof(Real)/time;
+}
+
+/*--------------------------------------------------------------------*/
+/// Parse a comma separated list of integers
+/*--------------------------------------------------------------------*/
+
+static std::vector<int>
+parseList(const char* a_str)
+{
+  std::vector<int> list;
+  std::istringstream iss(a_str);
+  std::string item;
+  while (std::getline(iss, item, ','))
+    {
+      list.push_back(std::atoi(item.c_str()));
+    }
+  return list;
+}
+
+
+/*******************************************************************************
+ *
+ * Benchmarks
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+/// BaseFab data motion: setVal, copy, linearOut, and linearIn
+/*--------------------------------------------------------------------*/
+
+static void
+benchBaseFab(BenchReport& a_report, const int a_n, const int a_ncomp)
+{
+  const Box box(IntVect::Zero, (a_n - 1)*IntVect::Unit);
+  const double cellBytes = (double)box.size()*a_ncomp*sizeof(Real);
+  FArrayBox fabA(box, a_ncomp);
+  FArrayBox fabB(box, a_ncomp);
+  fabA.setVal(1.);
+  fabB.setVal(2.);
+  std::unique_ptr<Real[]> buffer(new Real[box.size()*a_ncomp]);
+
+  a_report.add("BaseFab::setVal", a_n, a_ncomp,
+               bestTime([&](){ fabA.setVal(0.5); }),
+               cellBytes, 0.);
+  a_report.add("BaseFab::copy", a_n, a_ncomp,
+               bestTime([&](){ fabA.copy(box, fabB); }),
+               2*cellBytes, 0.);
+  a_report.add("BaseFab::linearOut", a_n, a_ncomp,
+               bestTime([&](){ fabA.linearOut(buffer.get(), box,
+                                              0, a_ncomp); }),
+               2*cellBytes, 0.);
+  a_report.add("BaseFab::linearIn", a_n, a_ncomp,
+               bestTime([&](){ fabA.linearIn(buffer.get(), box,
+                                             0, a_ncomp); }),
+               2*cellBytes, 0.);
+}
+
+/*--------------------------------------------------------------------*/
+/// Loop constructs: y += alpha*x with BoxIterator and each MD_BOXLOOP
+/*--------------------------------------------------------------------*/
+
+static void
+benchLoops(BenchReport& a_report, const int a_n, const int a_ncomp)
+{
+  const Box box(IntVect::Zero, (a_n - 1)*IntVect::Unit);
+  const double numElem = (double)box.size()*a_ncomp;
+  const double bytes = 3*numElem*sizeof(Real);
+  const double flops = 2*numElem;
+  FArrayBox fabX(box, a_ncomp);
+  FArrayBox fabY(box, a_ncomp);
+  fabX.setVal(1.);
+  fabY.setVal(0.);
+  const Real alpha = 1.E-3;
+
+  // Only use BoxIterator for small boxes, it is very slow
+  if (a_n <= 32)
+    {
+      a_report.add("BoxIterator", a_n, a_ncomp,
+                   bestTime(
+                     [&]()
+                     {
+                       for (int ic = 0; ic != a_ncomp; ++ic)
+                         {
+                           for (BoxIterator bit(box); bit.ok(); ++bit)
+                             {
+                               fabY(*bit, ic) += alpha*fabX(*bit, ic);
+                             }
+                         }
+                     }),
+                   bytes, flops);
+    }
+
+  // The arrays are variably-modified types which cannot be captured so
+  // each kernel builds its own
+  a_report.add("MD_BOXLOOP", a_n, a_ncomp,
+               bestTime(
+                 [&]()
+                 {
+                   MD_ARRAY_RESTRICT(arrX, fabX);
+                   MD_ARRAY_RESTRICT(arrY, fabY);
+                   for (int ic = 0; ic != a_ncomp; ++ic)
+                     {
+                       MD_BOXLOOP(box, i)
+                         {
+                           arrY[MD_IX(i, ic)] += alpha*arrX[MD_IX(i, ic)];
+                         }
+                     }
+                 }),
+               bytes, flops);
+  a_report.add("MD_BOXLOOP_PENCIL", a_n, a_ncomp,
+               bestTime(
+                 [&]()
+                 {
+                   MD_ARRAY_RESTRICT(arrX, fabX);
+                   MD_ARRAY_RESTRICT(arrY, fabY);
+                   for (int ic = 0; ic != a_ncomp; ++ic)
+                     {
+                       MD_BOXLOOP_PENCIL(box, i)
+                         {
+                           for (int i0 = box.loVect(0); i0 <= box.hiVect(0);
+                                ++i0)
+                             {
+                               arrY[MD_IX(i, ic)] +=
+                                 alpha*arrX[MD_IX(i, ic)];
+                             }
+                         }
+                     }
+                 }),
+               bytes, flops);
+  a_report.add("MD_BOXLOOP_OMP", a_n, a_ncomp,
+               bestTime(
+                 [&]()
+                 {
+                   MD_ARRAY_RESTRICT(arrX, fabX);
+                   MD_ARRAY_RESTRICT(arrY, fabY);
+                   for (int ic = 0; ic != a_ncomp; ++ic)
+                     {
+                       MD_BOXLOOP_OMP(box, i)
+                         {
+                           arrY[MD_IX(i, ic)] += alpha*arrX[MD_IX(i, ic)];
+                         }
+                     }
+                 }),
+               bytes, flops);
+  a_report.add("MD_BOXLOOP_PENCIL_OMP", a_n, a_ncomp,
+               bestTime(
+                 [&]()
+                 {
+                   MD_ARRAY_RESTRICT(arrX, fabX);
+                   MD_ARRAY_RESTRICT(arrY, fabY);
+                   for (int ic = 0; ic != a_ncomp; ++ic)
+                     {
+                       MD_BOXLOOP_PENCIL_OMP(box, i)
+                         {
+                           for (int i0 = box.loVect(0); i0 <= box.hiVect(0);
+                                ++i0)
+                             {
+                               arrY[MD_IX(i, ic)] +=
+                                 alpha*arrX[MD_IX(i, ic)];
+                             }
+                         }
+                     }
+                 }),
+               bytes, flops);
+  a_report.add("MD_BOXLOOP_TILE_OMP", a_n, a_ncomp,
+               bestTime(
+                 [&]()
+                 {
+                   MD_ARRAY_RESTRICT(arrX, fabX);
+                   MD_ARRAY_RESTRICT(arrY, fabY);
+                   for (int ic = 0; ic != a_ncomp; ++ic)
+                     {
+                       MD_BOXLOOP_TILE_OMP(box, i)
+                         {
+                           arrY[MD_IX(i, ic)] += alpha*arrX[MD_IX(i, ic)];
+                         }
+                     }
+                 }),
+               bytes, flops);
+}
+
+/*--------------------------------------------------------------------*/
+/// Laplacian stencil, scalar and with vector extensions (VEX)
+/** Bytes assume the stencil is reused in cache (read u, write Lu) and
+ *  operations are 4 per direction (3 for the second difference and 1
+ *  for the sum or scaling).
+ *//*-----------------------------------------------------------------*/
+
+static void
+benchStencil(BenchReport& a_report, const int a_n, const int a_ncomp)
+{
+  const Box box(IntVect::Zero, (a_n - 1)*IntVect::Unit);
+  Box grownBox(box);
+  grownBox.grow(1);
+  const double numElem = (double)box.size()*a_ncomp;
+  const double bytes = 2*numElem*sizeof(Real);
+  const double flops = 4*g_SpaceDim*numElem;
+  FArrayBox fabU(grownBox, a_ncomp);
+  FArrayBox fabL(box, a_ncomp);
+  for (int ic = 0; ic != a_ncomp; ++ic)
+    {
+      MD_ARRAY(arrU, fabU);
+      MD_BOXLOOP(grownBox, i)
+        {
+          arrU[MD_IX(i, ic)] = D_TERM(i0, + 2*i1, + 3*i2) + ic;
+        }
+    }
+  fabL.setVal(0.);
+  const Real factor = 0.1;
+
+  a_report.add("Laplacian (MD_BOXLOOP_OMP)", a_n, a_ncomp,
+               bestTime(
+                 [&]()
+                 {
+                   MD_ARRAY_RESTRICT(arrU, fabU);
+                   MD_ARRAY_RESTRICT(arrL, fabL);
+                   for (int ic = 0; ic != a_ncomp; ++ic)
+                     {
+                       MD_BOXLOOP_OMP(box, i)
+                         {
+                           arrL[MD_IX(i, ic)] = factor*
+                             MD_DIRSUM([=](const int            a_dir,
+                                           MD_DECLIX(const int, a_o))
+                               {
+                                 MD_CAPTURE_RESTRICT(arrU);
+                                 return
+                                     arrU[MD_OFFSETIX(i,+,a_o, ic)] -
+                                   2*arrU[MD_IX(i, ic)] +
+                                     arrU[MD_OFFSETIX(i,-,a_o, ic)];
+                               });
+                         }
+                     }
+                 }),
+               bytes, flops);
+  a_report.add("Laplacian (MD_BOXLOOP_TILE_OMP)", a_n, a_ncomp,
+               bestTime(
+                 [&]()
+                 {
+                   MD_ARRAY_RESTRICT(arrU, fabU);
+                   MD_ARRAY_RESTRICT(arrL, fabL);
+                   for (int ic = 0; ic != a_ncomp; ++ic)
+                     {
+                       MD_BOXLOOP_TILE_OMP(box, i)
+                         {
+                           arrL[MD_IX(i, ic)] = factor*
+                             MD_DIRSUM([=](const int            a_dir,
+                                           MD_DECLIX(const int, a_o))
+                               {
+                                 MD_CAPTURE_RESTRICT(arrU);
+                                 return
+                                     arrU[MD_OFFSETIX(i,+,a_o, ic)] -
+                                   2*arrU[MD_IX(i, ic)] +
+                                     arrU[MD_OFFSETIX(i,-,a_o, ic)];
+                               });
+                         }
+                     }
+                 }),
+               bytes, flops);
+
+#ifdef VecSz_r
+  const int i0Lo = box.loVect(0);
+  const int i0Hi = box.hiVect(0);
+  // One past the last cell that starts a full vector
+  const int i0EndPacked = i0Lo + ((i0Hi - i0Lo + 1)/VecSz_r)*VecSz_r;
+  a_report.add("Laplacian (VEX)", a_n, a_ncomp,
+               bestTime(
+                 [&]()
+                 {
+                   MD_ARRAY_RESTRICT(arrU, fabU);
+                   MD_ARRAY_RESTRICT(arrL, fabL);
+                   const __mvr two_vr = _mm_vr(set1)(2.0);
+                   const __mvr factor_vr = _mm_vr(set1)(factor);
+                   for (int ic = 0; ic != a_ncomp; ++ic)
+                     {
+                       MD_BOXLOOP_PENCIL_OMP(box, i)
+                         {
+                           int i0 = i0Lo;
+                           for (; i0 < i0EndPacked; i0 += VecSz_r)
+                             {
+                               const __mvr lap_vr = factor_vr*
+                                 MD_DIRSUM([=](const int            a_dir,
+                                               MD_DECLIX(const int, a_o))
+                                   {
+                                     MD_CAPTURE_RESTRICT(arrU);
+                                     return
+                                       _mm_vr(loadu)(
+                                         &arrU[MD_OFFSETIX(i,+,a_o, ic)]) -
+                                       two_vr*_mm_vr(loadu)(
+                                         &arrU[MD_IX(i, ic)]) +
+                                       _mm_vr(loadu)(
+                                         &arrU[MD_OFFSETIX(i,-,a_o, ic)]);
+                                   });
+                               _mm_vr(storeu)(&arrL[MD_IX(i, ic)], lap_vr);
+                             }
+                           // Catch unpacked cells
+                           for (; i0 <= i0Hi; ++i0)
+                             {
+                               arrL[MD_IX(i, ic)] = factor*
+                                 MD_DIRSUM([=](const int            a_dir,
+                                               MD_DECLIX(const int, a_o))
+                                   {
+                                     MD_CAPTURE_RESTRICT(arrU);
+                                     return
+                                         arrU[MD_OFFSETIX(i,+,a_o, ic)] -
+                                       2*arrU[MD_IX(i, ic)] +
+                                         arrU[MD_OFFSETIX(i,-,a_o, ic)];
+                                   });
+                             }
+                         }
+                     }
+                 }),
+               bytes, flops);
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+/// Copier construction and LevelData exchange
+/** The domain has 2 boxes of size a_n in each direction on each
+ *  process and is periodic so every box has a full set of neighbours.
+ *  Bytes are the ghost cells filled on this process.
+ *//*-----------------------------------------------------------------*/
+
+static void
+benchExchange(BenchReport& a_report, const int a_n, const int a_ncomp)
+{
+  const int numProc = DisjointBoxLayout::numProc();
+  IntVect domainSize(2*a_n*IntVect::Unit);
+  domainSize[g_SpaceDim-1] *= numProc;
+  const Box domain(IntVect::Zero, domainSize - IntVect::Unit);
+  const DisjointBoxLayout dbl(domain, a_n*IntVect::Unit);
+  LevelData<FArrayBox> lvldata(dbl, a_ncomp, 1);
+  lvldata.setVal(1.);
+  const unsigned periodic = (1 << g_SpaceDim) - 1;
+
+  a_report.add("Copier::defineExchangeLD", a_n, a_ncomp,
+               bestTime(
+                 [&]()
+                 {
+                   Copier copier;
+                   copier.defineExchangeLD(lvldata, periodic);
+                 }, true),
+               0., 0.);
+
+  Copier copier;
+  copier.defineExchangeLD(lvldata, periodic);
+  double bytes = 0.;
+  for (int midx = 0; midx != copier.numMotionItem(); ++midx)
+    {
+      // Packing and unpacking of a message is counted as in a copy
+      bytes += 2.*copier[midx].regionRecv().size()*a_ncomp*sizeof(Real);
+    }
+  a_report.add("LevelData::exchange", a_n, a_ncomp,
+               bestTime([&](){ lvldata.exchange(copier); }, true),
+               bytes, 0.);
+}
+
+
+/*******************************************************************************
+ *
+ * Main
+ *
+ ******************************************************************************/
+
+int main(int argc, const char* argv[])
+{
+  DisjointBoxLayout::initMPI(argc, argv);
+  const bool masterProc = (DisjointBoxLayout::procID() == 0);
+
+//--Options
+
+  std::vector<int> boxSizes{ 16, 32, 64, 128 };
+  std::vector<int> ncomps{ 1, 4 };
+  std::string fileName("benchBoxFramework.csv");
+  for (int iarg = 1; iarg < argc; ++iarg)
+    {
+      if (std::strcmp(argv[iarg], "-q") == 0)
+        {
+          boxSizes = { 16, 32 };
+          s_minTrialTime = 0.01;
+          s_numTrial = 3;
+        }
+      else if (std::strcmp(argv[iarg], "-s") == 0 && iarg + 1 < argc)
+        {
+          boxSizes = parseList(argv[++iarg]);
+        }
+      else if (std::strcmp(argv[iarg], "-c") == 0 && iarg + 1 < argc)
+        {
+          ncomps = parseList(argv[++iarg]);
+        }
+      else if (std::strcmp(argv[iarg], "-t") == 0 && iarg + 1 < argc)
+        {
+          s_minTrialTime = std::atof(argv[++iarg]);
+        }
+      else if (std::strcmp(argv[iarg], "-o") == 0 && iarg + 1 < argc)
+        {
+          fileName = argv[++iarg];
+        }
+      else
+        {
+          if (masterProc)
+            {
+              std::cout << "Usage: " << argv[0] << " [-q] [-s 16,32,...] "
+                "[-c 1,4,...] [-t seconds] [-o file.csv]\n";
+            }
+          DisjointBoxLayout::finalizeMPI();
+          return 1;
+        }
+    }
+
+//--Reference bandwidth
+
+  const double streamBW = streamTriad(1L << 24);
+  if (masterProc)
+    {
+      std::cout << "STREAM triad bandwidth (GB/s): " << streamBW << "\n\n";
+    }
+  BenchReport report(streamBW);
+  report.writeHeader();
+
+//--Sweep
+
+  for (const int n : boxSizes)
+    {
+      for (const int ncomp : ncomps)
+        {
+          benchBaseFab(report, n, ncomp);
+          benchLoops(report, n, ncomp);
+          benchStencil(report, n, ncomp);
+          benchExchange(report, n, ncomp);
+        }
+    }
+
+//--Output
+
+  if (masterProc)
+    {
+      std::ofstream fout(fileName);
+      report.writeCSV(fout);
+      if (!fout)
+        {
+          std::cout << "Error writing results to " << fileName << std::endl;
+        }
+      else
+        {
+          std::cout << "\nResults written to " << fileName << std::endl;
+        }
+    }
+  DisjointBoxLayout::finalizeMPI();
+  return 0;
+}
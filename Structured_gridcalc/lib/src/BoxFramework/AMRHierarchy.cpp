@@ -0,0 +1,479 @@
+
+/******************************************************************************/
+/**
+ * \file AMRHierarchy.cpp
+ *
+ * \brief Non-inline definitions for classes in AMRHierarchy.H
+ *
+ *//*+*************************************************************************/
+
+#include <cstdlib>
+#include <iostream>
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
+#include "BaseFabMacros.H"
+#include "AMRHierarchy.H"
+#include "LayoutIterator.H"
+#include "TimerRegistry.H"
+
+
+/*==============================================================================
+ * Local helpers
+ *============================================================================*/
+
+namespace
+{
+
+/// Divide each component, rounding towards negative infinity
+inline IntVect
+floorDiv(const IntVect& a_iv, const IntVect& a_div)
+{
+  IntVect q;
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      q[dir] = (a_iv[dir] >= 0) ?
+        a_iv[dir]/a_div[dir] : -((a_div[dir] - 1 - a_iv[dir])/a_div[dir]);
+    }
+  return q;
+}
+
+/// Wrap a lattice position in periodic directions
+/** \return             F if the position is outside the lattice in a
+ *                      non-periodic direction
+ */
+inline bool
+wrapLattice(IntVect& a_iv, const IntVect& a_numBlock, const unsigned a_periodic)
+{
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      if (a_iv[dir] < 0 || a_iv[dir] >= a_numBlock[dir])
+        {
+          if (!(a_periodic & (1<<dir))) return false;
+          a_iv[dir] = (a_iv[dir] + a_numBlock[dir]) % a_numBlock[dir];
+        }
+    }
+  return true;
+}
+
+}  // anonymous namespace
+
+
+/*******************************************************************************
+ *
+ * Class AMRHierarchy: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Default constructor
+/*--------------------------------------------------------------------*/
+
+AMRHierarchy::AMRHierarchy()
+  :
+  m_maxLevel(0),
+  m_ratio(0),
+  m_ncomp(0),
+  m_nghost(0),
+  m_periodic(0u),
+  m_distribution(DisjointBoxLayout::Distribution::morton)
+{
+}
+
+/*--------------------------------------------------------------------*/
+//  Constructor
+/** \param[in]  a_baseDBL
+ *                      Layout of level 0 which must cover the domain.
+ *                      All levels have blocks of the same size which
+ *                      must be a multiple of a_ratio.
+ *  \param[in]  a_maxLevel
+ *                      Maximum level that may be created
+ *  \param[in]  a_ratio Refinement ratio between levels
+ *  \param[in]  a_ncomp Number of components of the state
+ *  \param[in]  a_nghost
+ *                      Number of ghost cells of the state
+ *  \param[in]  a_periodic
+ *                      Which directions are periodic (default none)
+ *  \param[in]  a_distribution
+ *                      Distribution of the boxes of refined levels
+ *                      (default morton)
+ *//*-----------------------------------------------------------------*/
+
+AMRHierarchy::AMRHierarchy(
+  const DisjointBoxLayout&              a_baseDBL,
+  const int                             a_maxLevel,
+  const int                             a_ratio,
+  const int                             a_ncomp,
+  const int                             a_nghost,
+  const unsigned                        a_periodic,
+  const DisjointBoxLayout::Distribution a_distribution)
+{
+  define(a_baseDBL, a_maxLevel, a_ratio, a_ncomp, a_nghost, a_periodic,
+         a_distribution);
+}
+
+/*--------------------------------------------------------------------*/
+//  Weak construction
+/** Only level 0 is created and its state is set to zero
+ *  \param[in]  a_baseDBL
+ *                      Layout of level 0 which must cover the domain
+ *  \param[in]  a_maxLevel
+ *                      Maximum level that may be created
+ *  \param[in]  a_ratio Refinement ratio between levels
+ *  \param[in]  a_ncomp Number of components of the state
+ *  \param[in]  a_nghost
+ *                      Number of ghost cells of the state
+ *  \param[in]  a_periodic
+ *                      Which directions are periodic (default none)
+ *  \param[in]  a_distribution
+ *                      Distribution of the boxes of refined levels
+ *//*-----------------------------------------------------------------*/
+
+void
+AMRHierarchy::define(const DisjointBoxLayout&              a_baseDBL,
+                     const int                             a_maxLevel,
+                     const int                             a_ratio,
+                     const int                             a_ncomp,
+                     const int                             a_nghost,
+                     const unsigned                        a_periodic,
+                     const DisjointBoxLayout::Distribution a_distribution)
+{
+  CH_assert(a_baseDBL.complete());
+  CH_assert(a_maxLevel >= 0);
+  CH_assert(a_ratio > 1);
+  m_maxLevel = a_maxLevel;
+  m_ratio = a_ratio;
+  m_ncomp = a_ncomp;
+  m_nghost = a_nghost;
+  m_periodic = a_periodic;
+  m_distribution = a_distribution;
+  m_level.clear();
+  m_level.push_back(makeLevel(0, a_baseDBL));
+  m_level[0]->m_new.setVal((Real)0);
+  m_level[0]->m_old.setVal((Real)0);
+}
+
+/*--------------------------------------------------------------------*/
+//  Set the time of all levels
+/*--------------------------------------------------------------------*/
+
+void
+AMRHierarchy::setTime(const Real a_time)
+{
+  for (std::unique_ptr<Level>& level : m_level)
+    {
+      level->m_timeNew = a_time;
+      level->m_timeOld = a_time;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Number of valid cells on a level (over all processes)
+/*--------------------------------------------------------------------*/
+
+long long
+AMRHierarchy::numCell(const int a_level) const
+{
+  const DisjointBoxLayout& dbl = layout(a_level);
+  return (long long)dbl.size()*dbl.boxSize().product();
+}
+
+/*--------------------------------------------------------------------*/
+//  Rebuild the levels finer than a base level from tagged cells
+/** Collective.  For each level from a_baseLevel to maxLevel()-1, the
+ *  ghost cells are filled, the tag function is called, and the next
+ *  finer level is rebuilt from the tags (see fineLayout).  The state
+ *  of the new level is interpolated from the coarser level and then
+ *  copied from the old level where they overlap.  Levels that no
+ *  longer have tagged cells under them are removed.  Call when all
+ *  levels are at the same time.
+ *  \param[in]  a_tag   Function tagging cells for refinement
+ *  \param[in]  a_baseLevel
+ *                      Finest level that is not changed (default 0)
+ *  \param[in]  a_tagBuffer
+ *                      Tags are grown by this many cells (default 1)
+ *//*-----------------------------------------------------------------*/
+
+void
+AMRHierarchy::regrid(const TagFunction& a_tag,
+                     const int          a_baseLevel,
+                     const int          a_tagBuffer)
+{
+  CH_assert(a_baseLevel >= 0 && a_baseLevel < numLevel());
+  TIMED_REGION(timerRegrid, "AMRHierarchy::regrid");
+  for (int lev = a_baseLevel; lev < m_maxLevel && lev < numLevel(); ++lev)
+    {
+      fillGhosts(lev);
+      LevelData<BaseFab<int> > tags(layout(lev), 1, 0);
+      tags.setVal(0);
+      a_tag(lev, state(lev), tags);
+      const DisjointBoxLayout fnDBL = fineLayout(lev, tags, a_tagBuffer);
+      if (fnDBL.size() == 0)
+        {
+          m_level.resize(lev + 1);
+          break;
+        }
+      std::unique_ptr<Level> fine = makeLevel(lev + 1, fnDBL);
+      fine->m_coarseFine->interpolate(fine->m_new, state(lev));
+      if (lev + 1 < numLevel())
+        {
+          const Level& oldFine = *m_level[lev + 1];
+          LayoutCopier copier(oldFine.m_dbl, fnDBL);
+          fine->m_new.copy(oldFine.m_new, copier, 0, 0, m_ncomp);
+          m_level[lev + 1] = std::move(fine);
+        }
+      else
+        {
+          m_level.push_back(std::move(fine));
+        }
+      Level& level = *m_level[lev + 1];
+      for (DataIterator dit(level.m_dbl); dit.ok(); ++dit)
+        {
+          level.m_old[dit].copy(level.m_dbl[dit], level.m_new[dit]);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Advance all levels by one step of level 0
+/** Collective.  Level l takes ratio()^l steps of a_dt/ratio()^l.
+ *  \param[in]  a_advance
+ *                      Function advancing the state of a level
+ *  \param[in]  a_dt    Time step on level 0
+ *//*-----------------------------------------------------------------*/
+
+void
+AMRHierarchy::advance(const AdvanceFunction& a_advance, const Real a_dt)
+{
+  advanceLevel(a_advance, 0, a_dt);
+}
+
+/*--------------------------------------------------------------------*/
+//  Average all levels down onto the coarser levels
+/** Collective.  Starts from the finest level.
+ *//*-----------------------------------------------------------------*/
+
+void
+AMRHierarchy::averageDown()
+{
+  for (int lev = numLevel() - 1; lev > 0; --lev)
+    {
+      m_level[lev]->m_coarseFine->averageDown(m_level[lev-1]->m_new,
+                                              m_level[lev]->m_new);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Find the layout of the level finer than a level from tags
+/** Collective.  A block of the fine lattice is present if it covers a
+ *  fine cell under a tagged cell grown by a_tagBuffer.  Blocks are
+ *  then removed if they would not be properly nested: all coarse cells
+ *  within CoarseFine::nestingBuffer cells of the coarsened block must
+ *  be in a box of a_level or outside the (non-periodic) domain.
+ *  \param[in]  a_level Level that was tagged
+ *  \param[in]  a_tags  Non-zero cells are tagged
+ *  \param[in]  a_tagBuffer
+ *                      Cells by which to grow the tags
+ *  \return             Subset layout of the refined domain (with no
+ *                      boxes if nothing was tagged)
+ *//*-----------------------------------------------------------------*/
+
+DisjointBoxLayout
+AMRHierarchy::fineLayout(const int                       a_level,
+                         const LevelData<BaseFab<int> >& a_tags,
+                         const int                       a_tagBuffer) const
+{
+  TIMED_REGION(timerFineLayout, "AMRHierarchy::fineLayout");
+  const DisjointBoxLayout& crDBL = layout(a_level);
+  CH_assert(a_tags.tag() == crDBL.tag());
+  const Box& crDomain = crDBL.problemDomain();
+  const Box fnDomain = Box(crDomain).refine(m_ratio);
+  const IntVect& blockSize = crDBL.boxSize();
+  const IntVect numBlock = fnDomain.dimensions()/blockSize;
+  CH_assert(numBlock*blockSize == fnDomain.dimensions());
+  const Box lattice(IntVect::Zero, numBlock - IntVect::Unit);
+  const auto linear =
+    [&numBlock]
+    (const IntVect& a_iv)
+    {
+      return D_TERM(a_iv[0],
+                    + numBlock[0]*a_iv[1],
+                    + numBlock[0]*numBlock[1]*a_iv[2]);
+    };
+  std::vector<char> present(numBlock.product(), 0);
+
+//--Mark blocks under the tags of the local boxes
+
+  for (DataIterator dit(crDBL); dit.ok(); ++dit)
+    {
+      const BaseFab<int>& tagFab = a_tags[dit];
+      const Box& box = crDBL[dit];
+      MD_BOXLOOP(box, i)
+        {
+          const IntVect iv(D_DECL(i0, i1, i2));
+          if (tagFab(iv, 0) == 0) continue;
+          Box fnRegion(iv, iv);
+          fnRegion.grow(a_tagBuffer);
+          fnRegion.refine(m_ratio);
+          const Box blocks(
+            floorDiv(fnRegion.loVect() - fnDomain.loVect(), blockSize),
+            floorDiv(fnRegion.hiVect() - fnDomain.loVect(), blockSize));
+          MD_BOXLOOP(blocks, j)
+            {
+              IntVect ivBlock(D_DECL(j0, j1, j2));
+              if (wrapLattice(ivBlock, numBlock, m_periodic))
+                {
+                  present[linear(ivBlock)] = 1;
+                }
+            }
+        }
+    }
+
+//--Combine the marks of all processes
+
+#ifdef USE_MPI
+  const int mpierr = MPI_Allreduce(MPI_IN_PLACE, present.data(),
+                                   present.size(), MPI_SIGNED_CHAR, MPI_MAX,
+                                   MPI_COMM_WORLD);
+  if (mpierr)
+    {
+      std::cout << "Error combining refinement tags on process "
+                << DisjointBoxLayout::procID() << std::endl;
+      abort();
+    }
+#endif
+
+//--Remove blocks that would not be properly nested
+
+  const int nestBuffer = CoarseFine::nestingBuffer(m_ratio, m_nghost);
+  const IntVect& crBlockSize = crDBL.boxSize();
+  std::vector<char> nested(present);
+  MD_BOXLOOP(lattice, i)
+    {
+      const IntVect ivBlock(D_DECL(i0, i1, i2));
+      if (!present[linear(ivBlock)]) continue;
+      const IntVect lo = fnDomain.loVect() + ivBlock*blockSize;
+      Box crRegion(lo, lo + blockSize - IntVect::Unit);
+      crRegion.coarsen(m_ratio);
+      crRegion.grow(nestBuffer);
+      const Box crBlocks(
+        floorDiv(crRegion.loVect() - crDomain.loVect(), crBlockSize),
+        floorDiv(crRegion.hiVect() - crDomain.loVect(), crBlockSize));
+      MD_BOXLOOP(crBlocks, j)
+        {
+          IntVect ivCrBlock(D_DECL(j0, j1, j2));
+          if (wrapLattice(ivCrBlock, crDBL.dimensions(), m_periodic) &&
+              crDBL.latticeBox(ivCrBlock) < 0)
+            {
+              nested[linear(ivBlock)] = 0;
+            }
+        }
+    }
+
+  DisjointBoxLayout fnDBL;
+  fnDBL.defineSubset(fnDomain, blockSize, nested, m_distribution);
+  return fnDBL;
+}
+
+/*--------------------------------------------------------------------*/
+//  Create a level (the state is not initialized)
+/** \param[in]  a_level Index of the level (the next coarser level
+ *                      must exist)
+ *  \param[in]  a_dbl   Layout of the level
+ *  \return             The level, at the time of the coarser level
+ *//*-----------------------------------------------------------------*/
+
+std::unique_ptr<AMRHierarchy::Level>
+AMRHierarchy::makeLevel(const int                a_level,
+                        const DisjointBoxLayout& a_dbl) const
+{
+  std::unique_ptr<Level> level(new Level);
+  level->m_dbl = a_dbl;
+  level->m_new.define(a_dbl, m_ncomp, m_nghost);
+  level->m_old.define(a_dbl, m_ncomp, m_nghost);
+  level->m_timeNew = (a_level > 0) ? m_level[a_level-1]->m_timeNew : (Real)0;
+  level->m_timeOld = level->m_timeNew;
+  level->m_exchange.defineExchangeLD(level->m_new, m_periodic);
+  if (a_level > 0)
+    {
+      level->m_coarseFine.reset(new CoarseFine(m_level[a_level-1]->m_dbl,
+                                               a_dbl,
+                                               m_ratio,
+                                               m_ncomp,
+                                               m_nghost,
+                                               m_periodic));
+    }
+  return level;
+}
+
+/*--------------------------------------------------------------------*/
+//  Advance a level and, recursively, all finer levels
+/** \param[in]  a_advance
+ *                      Function advancing the state of a level
+ *  \param[in]  a_level Level to advance
+ *  \param[in]  a_dt    Time step of the level
+ *//*-----------------------------------------------------------------*/
+
+void
+AMRHierarchy::advanceLevel(const AdvanceFunction& a_advance,
+                           const int              a_level,
+                           const Real             a_dt)
+{
+  Level& level = *m_level[a_level];
+  const bool hasFiner = (a_level + 1 < numLevel());
+
+  // The finer level interpolates its ghost cells in time between the
+  // old and new states
+  if (hasFiner)
+    {
+      for (DataIterator dit(level.m_dbl); dit.ok(); ++dit)
+        {
+          level.m_old[dit].copy(level.m_dbl[dit], level.m_new[dit]);
+        }
+    }
+  level.m_timeOld = level.m_timeNew;
+  fillGhosts(a_level, level.m_timeNew);
+  a_advance(a_level, level.m_new, level.m_timeNew, a_dt);
+  level.m_timeNew += a_dt;
+
+  // Subcycle the finer level to the same time and average down
+  if (hasFiner)
+    {
+      Level& fine = *m_level[a_level + 1];
+      const Real fnDt = a_dt/m_ratio;
+      for (int iStep = 0; iStep != m_ratio; ++iStep)
+        {
+          advanceLevel(a_advance, a_level + 1, fnDt);
+        }
+      fine.m_timeNew = level.m_timeNew;
+      fine.m_coarseFine->averageDown(level.m_new, fine.m_new);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Fill ghost cells of a level at a time
+/** Ghost cells are first interpolated from the coarser level at the
+ *  time and then those inside other boxes of the level are exchanged.
+ *  \param[in]  a_level Level to fill
+ *  \param[in]  a_time  Time of the state of the level
+ *//*-----------------------------------------------------------------*/
+
+void
+AMRHierarchy::fillGhosts(const int a_level, const Real a_time)
+{
+  Level& level = *m_level[a_level];
+  if (a_level > 0)
+    {
+      const Level& coarse = *m_level[a_level-1];
+      const Real crDt = coarse.m_timeNew - coarse.m_timeOld;
+      const Real alpha = (crDt > (Real)0) ?
+        (a_time - coarse.m_timeOld)/crDt : (Real)1;
+      level.m_coarseFine->interpolateGhosts(level.m_new,
+                                            coarse.m_old,
+                                            coarse.m_new,
+                                            alpha);
+    }
+  level.m_new.exchange(level.m_exchange);
+}
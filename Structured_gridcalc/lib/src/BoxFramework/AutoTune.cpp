@@ -0,0 +1,330 @@
+
+/******************************************************************************/
+/**
+ * \file AutoTune.cpp
+ *
+ * \brief Non-inline definitions for classes in AutoTune.H
+ *
+ *//*+*************************************************************************/
+
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "LinuxSupport.H"
+#include "BoxTasks.H"
+#include "DisjointBoxLayout.H"
+#include "AutoTune.H"
+
+
+/*******************************************************************************
+ *
+ * Class AutoTune: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Constructor
+/** The key is formed here so it does not change when a configuration
+ *  with a different number of threads is applied.  Collective over all
+ *  processes (process 0's host name is used).  With a single process,
+ *  MPI need not be initialized.
+ *  \param[in]  a_cacheFile
+ *                      Name of the cache file
+ *  \param[in]  a_problem
+ *                      Description of the problem (e.g., the
+ *                      application and domain size)
+ *//*-----------------------------------------------------------------*/
+
+AutoTune::AutoTune(const std::string& a_cacheFile,
+                   const std::string& a_problem)
+  :
+  m_cacheFile(a_cacheFile)
+{
+  constexpr int hostLen = 256;
+  char hostName[hostLen];
+  if (System::getHostName(hostName, hostLen) != 0)
+    {
+      std::strcpy(hostName, "unknown");
+    }
+#ifdef USE_MPI
+  if (DisjointBoxLayout::numProc() > 1)
+    {
+      MPI_Bcast(hostName, hostLen, MPI_CHAR, 0, MPI_COMM_WORLD);
+    }
+#endif
+  int numThread = 1;
+#ifdef _OPENMP
+  numThread = omp_get_max_threads();
+#endif
+  std::ostringstream key;
+  key << hostName << ":np" << DisjointBoxLayout::numProc() << ":nt"
+      << numThread << ":d" << g_SpaceDim << ':' << a_problem;
+  m_key = key.str();
+  for (char& c : m_key)
+    {
+      if (std::isspace(static_cast<unsigned char>(c))) c = '_';
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Find the configuration for the key in the cache file
+/** Collective over all processes.  Process 0 reads the file and
+ *  broadcasts the result.
+ *  \param[out] a_config
+ *                      Configuration for the key if found (otherwise
+ *                      unchanged)
+ *  \return             0 if found, -1 if the file or the key does not
+ *                      exist
+ *//*-----------------------------------------------------------------*/
+
+int
+AutoTune::lookup(Config& a_config) const
+{
+  // Status followed by the configuration
+  constexpr int numInt = 1 + 2*g_SpaceDim + 2;
+  int buffer[numInt];
+  buffer[0] = -1;
+  if (DisjointBoxLayout::procID() == 0)
+    {
+      std::ifstream file(m_cacheFile.c_str());
+      std::string line;
+      while (std::getline(file, line))
+        {
+          std::istringstream entry(line);
+          std::string key;
+          entry >> key;
+          if (key != m_key) continue;
+          for (int i = 1; i != numInt; ++i)
+            {
+              entry >> buffer[i];
+            }
+          // Use the last valid line for the key
+          if (entry) buffer[0] = 0;
+        }
+    }
+#ifdef USE_MPI
+  if (DisjointBoxLayout::numProc() > 1)
+    {
+      MPI_Bcast(buffer, numInt, MPI_INT, 0, MPI_COMM_WORLD);
+    }
+#endif
+  if (buffer[0] != 0) return -1;
+  const int* p = buffer + 1;
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      a_config.m_boxSize[dir] = *p++;
+    }
+  a_config.m_maxTileCells = *p++;
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      a_config.m_tileShape[dir] = *p++;
+    }
+  a_config.m_numThread = *p;
+  return 0;
+}
+
+/*--------------------------------------------------------------------*/
+//  Run trials of candidates and save the fastest
+/** Collective over all processes.  Each candidate is applied and
+ *  then given to the trial.  The time of a trial is the maximum over
+ *  all processes.  The fastest candidate is saved in the cache file
+ *  and is left applied.
+ *  \param[in]  a_candidates
+ *                      Configurations to try (not empty)
+ *  \param[in]  a_trial Returns the time per step for a configuration
+ *  \return             The fastest configuration
+ *//*-----------------------------------------------------------------*/
+
+AutoTune::Config
+AutoTune::tune(const std::vector<Config>& a_candidates, const Trial& a_trial)
+{
+  CH_assert(!a_candidates.empty());
+  CH_assert(a_trial);
+  m_trialTime.clear();
+  int idxBest = -1;
+  double timeBest = std::numeric_limits<double>::max();
+  for (int idx = 0, idx_end = a_candidates.size(); idx != idx_end; ++idx)
+    {
+      apply(a_candidates[idx]);
+      double time = a_trial(a_candidates[idx]);
+#ifdef USE_MPI
+      if (DisjointBoxLayout::numProc() > 1)
+        {
+          // An invalid candidate on any process is invalid everywhere
+          double minmax[2] = { -time, time };
+          MPI_Allreduce(MPI_IN_PLACE, minmax, 2, MPI_DOUBLE, MPI_MAX,
+                        MPI_COMM_WORLD);
+          time = (-minmax[0] < 0.) ? -1. : minmax[1];
+        }
+#endif
+      m_trialTime.push_back(time);
+      if (time >= 0. && time < timeBest)
+        {
+          idxBest = idx;
+          timeBest = time;
+        }
+    }
+  if (idxBest < 0)
+    {
+      std::cout << "Error in AutoTune::tune: no candidate is valid"
+                << std::endl;
+      abort();
+    }
+  const Config& best = a_candidates[idxBest];
+  apply(best);
+  if (save(best, timeBest) != 0)
+    {
+      if (DisjointBoxLayout::procID() == 0)
+        {
+          std::cout << "Warning: unable to write autotune cache file "
+                    << m_cacheFile << std::endl;
+        }
+    }
+  return best;
+}
+
+/*--------------------------------------------------------------------*/
+//  Save a configuration for the key in the cache file
+/** Only process 0 writes.  Any existing line for the key is replaced
+ *  and the lines for other keys are kept.
+ *  \param[in]  a_config
+ *                      Configuration to save
+ *  \param[in]  a_time  Time per step of the configuration (ms)
+ *  \return             0 on success, -1 if the file could not be
+ *                      written
+ *//*-----------------------------------------------------------------*/
+
+int
+AutoTune::save(const Config& a_config, const double a_time) const
+{
+  if (DisjointBoxLayout::procID() != 0) return 0;
+  std::vector<std::string> lines;
+  {
+    std::ifstream file(m_cacheFile.c_str());
+    std::string line;
+    while (std::getline(file, line))
+      {
+        std::istringstream entry(line);
+        std::string key;
+        entry >> key;
+        if (key.empty() || key == m_key) continue;
+        lines.push_back(line);
+      }
+  }
+  std::ofstream file(m_cacheFile.c_str(), std::ios::trunc);
+  if (!file) return -1;
+  for (const std::string& line : lines)
+    {
+      file << line << '\n';
+    }
+  file << m_key;
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      file << ' ' << a_config.m_boxSize[dir];
+    }
+  file << ' ' << a_config.m_maxTileCells;
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      file << ' ' << a_config.m_tileShape[dir];
+    }
+  file << ' ' << a_config.m_numThread << ' ' << std::setprecision(6)
+       << a_time << '\n';
+  return (file) ? 0 : -1;
+}
+
+/*--------------------------------------------------------------------*/
+//  Apply the tiling and thread count of a configuration
+/** The box size must be used by the application when it defines its
+ *  DisjointBoxLayout.
+ *  \param[in]  a_config
+ *                      Configuration to apply
+ *//*-----------------------------------------------------------------*/
+
+void
+AutoTune::apply(const Config& a_config)
+{
+  BoxTasks::setMaxTileCells(a_config.m_maxTileCells);
+  BoxTasks::setTileShape(a_config.m_tileShape);
+#ifdef _OPENMP
+  if (a_config.m_numThread > 0)
+    {
+      omp_set_num_threads(a_config.m_numThread);
+    }
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+//  All combinations of candidate parameters
+/** Box sizes vary slowest and thread counts fastest.
+ *  \param[in]  a_boxSizes
+ *                      Candidate maximum box sizes
+ *  \param[in]  a_maxTileCells
+ *                      Candidate maximum cells in a task
+ *  \param[in]  a_tileShapes
+ *                      Candidate tile shapes
+ *  \param[in]  a_numThreads
+ *                      Candidate numbers of threads
+ *  \return             Configurations
+ *//*-----------------------------------------------------------------*/
+
+std::vector<AutoTune::Config>
+AutoTune::candidates(const std::vector<IntVect>& a_boxSizes,
+                     const std::vector<int>&     a_maxTileCells,
+                     const std::vector<IntVect>& a_tileShapes,
+                     const std::vector<int>&     a_numThreads)
+{
+  std::vector<Config> configs;
+  configs.reserve(a_boxSizes.size()*a_maxTileCells.size()*
+                  a_tileShapes.size()*a_numThreads.size());
+  for (const IntVect& boxSize : a_boxSizes)
+    {
+      for (const int maxTileCells : a_maxTileCells)
+        {
+          for (const IntVect& tileShape : a_tileShapes)
+            {
+              for (const int numThread : a_numThreads)
+                {
+                  configs.push_back(
+                    Config{ boxSize, maxTileCells, tileShape, numThread });
+                }
+            }
+        }
+    }
+  return configs;
+}
+
+/*--------------------------------------------------------------------*/
+//  Current configuration with a box size
+/** Use as the default when tuning is not run.
+ *  \param[in]  a_boxSize
+ *                      Maximum box size
+ *  \return             Configuration with the current tiling and
+ *                      number of threads
+ *//*-----------------------------------------------------------------*/
+
+AutoTune::Config
+AutoTune::current(const IntVect& a_boxSize)
+{
+  int numThread = 1;
+#ifdef _OPENMP
+  numThread = omp_get_max_threads();
+#endif
+  return Config{ a_boxSize,
+                 BoxTasks::maxTileCells(),
+                 BoxTasks::tileShape(),
+                 numThread };
+}
@@ -8,6 +8,10 @@
  *//*+*************************************************************************/
 
 // #define DEBUGFAB
+#include <algorithm>
+#include <new>
+#include <cstdint>
+
 #ifdef DEBUGFAB
 #include <iostream>
 #include <iomanip>
@@ -15,6 +19,14 @@
 
 #include "BaseFab.H"
 #include "BaseFabMacros.H"
+#include "MemoryPool.H"
+#include "TimerRegistry.H"
+#include "VEXTypes.H"
+
+// Without vector extensions, tiles are single cells
+#ifndef VecSz_r
+#define VecSz_r 1
+#endif
 
 #ifdef DEBUGFAB
   #define FABDBG(x) x
@@ -23,6 +35,30 @@
 #endif
 
 
+/*******************************************************************************
+ *
+ * Class BaseFab: static member initialization
+ *
+ ******************************************************************************/
+
+template <typename T>
+typename BaseFab<T>::AllocBy BaseFab<T>::s_defaultAllocBy =
+  BaseFab<T>::AllocBy::array;
+
+template <typename T>
+typename BaseFab<T>::Layout BaseFab<T>::s_defaultLayout =
+  BaseFab<T>::Layout::planar;
+
+template <typename T>
+bool BaseFab<T>::s_defaultAlignRows = false;
+
+template <typename T>
+const int BaseFab<T>::s_tileSize = VecSz_r;
+
+template <typename T>
+int BaseFab<T>::s_minThreadCopyCells = 32768;
+
+
 /*******************************************************************************
  *
  * Class BaseFab: member definitions
@@ -41,7 +77,10 @@ BaseFab<T>::BaseFab()
   m_ncomp(0),
   m_size(0),
   m_data(nullptr),
-  m_allocBy(AllocBy::none)
+  m_allocBy(AllocBy::none),
+  m_layout(s_defaultLayout),
+  m_alignRows(false),
+  m_rowLead(0)
 {
   FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
          << "): default construction\n");
@@ -62,7 +101,10 @@ BaseFab<T>::BaseFab(const Box& a_box, const int a_ncomp, T *const a_alias)
   m_box = a_box;
   m_ncomp = a_ncomp;
   m_data = a_alias;
-  m_allocBy = (a_alias == nullptr) ? AllocBy::array : AllocBy::alias;
+  m_allocBy = (a_alias == nullptr) ? s_defaultAllocBy : AllocBy::alias;
+  m_layout = s_defaultLayout;
+  m_alignRows = (s_defaultAlignRows && m_layout == Layout::planar &&
+                 a_alias == nullptr);
   setStride();
   allocate();
   FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
@@ -85,7 +127,10 @@ BaseFab<T>::BaseFab(const Box& a_box, const int a_ncomp, const T& a_val, T *cons
   m_box = a_box;
   m_ncomp = a_ncomp;
   m_data = a_alias;
-  m_allocBy = (a_alias == nullptr) ? AllocBy::array : AllocBy::alias;
+  m_allocBy = (a_alias == nullptr) ? s_defaultAllocBy : AllocBy::alias;
+  m_layout = s_defaultLayout;
+  m_alignRows = (s_defaultAlignRows && m_layout == Layout::planar &&
+                 a_alias == nullptr);
   setStride();
   allocate();
   setVal(a_val);
@@ -93,6 +138,36 @@ BaseFab<T>::BaseFab(const Box& a_box, const int a_ncomp, const T& a_val, T *cons
          << "): construction with sizes and default value\n");
 }
 
+/*--------------------------------------------------------------------*/
+//  Constructor with sizes and a layout
+/** \param[in]  a_box   Box defining array dimensions
+ *  \param[in]  a_ncomp Number of components
+ *  \param[in]  a_layout
+ *                      Placement of components in memory
+ *  \param[in]  a_alias nullptr forces allocation.  Otherwise, memory
+ *                      is aliased to this address and must hold at
+ *                      least size() elements.  Default parameter is
+ *                      nullptr
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+BaseFab<T>::BaseFab(const Box&   a_box,
+                    const int    a_ncomp,
+                    const Layout a_layout,
+                    T *const     a_alias)
+{
+  m_box = a_box;
+  m_ncomp = a_ncomp;
+  m_data = a_alias;
+  m_allocBy = (a_alias == nullptr) ? s_defaultAllocBy : AllocBy::alias;
+  m_layout = a_layout;
+  m_alignRows = false;
+  setStride();
+  allocate();
+  FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
+         << "): construction with sizes and layout\n");
+}
+
 /*--------------------------------------------------------------------*/
 //  Move constructor
 /** Moving BaseFabs built as an alias will cause an error
@@ -107,7 +182,10 @@ BaseFab<T>::BaseFab(BaseFab&& a_fab) noexcept
   m_ncomp(a_fab.m_ncomp),
   m_size(a_fab.m_size),
   m_data(a_fab.m_data),
-  m_allocBy(a_fab.m_allocBy)
+  m_allocBy(a_fab.m_allocBy),
+  m_layout(a_fab.m_layout),
+  m_alignRows(a_fab.m_alignRows),
+  m_rowLead(a_fab.m_rowLead)
 #ifdef USE_GPU
   ,m_dataSymbol(a_fab.m_dataSymbol)
 #endif
@@ -140,13 +218,24 @@ BaseFab<T>::operator=(BaseFab&& a_fab) noexcept
     m_box = a_fab.m_box;
     m_stride = a_fab.m_stride;
     m_ncomp= a_fab.m_ncomp;
+    m_size = a_fab.m_size;
     m_data = a_fab.m_data;
     m_allocBy = a_fab.m_allocBy;
+    m_layout = a_fab.m_layout;
+    m_alignRows = a_fab.m_alignRows;
+    m_rowLead = a_fab.m_rowLead;
+#ifdef USE_GPU
+    m_dataSymbol = a_fab.m_dataSymbol;
+#endif
     FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
          << "): move construction\n");
     CH_assert(a_fab.m_allocBy != AllocBy::alias);
     // // Ensure a_fab will not delete
     a_fab.m_data = nullptr;
+#ifdef USE_GPU
+    a_fab.m_dataSymbol.host = nullptr;
+    a_fab.m_dataSymbol.device = nullptr;
+#endif
   }
   return *this;
 }
@@ -170,7 +259,10 @@ BaseFab<T>::define(const Box& a_box, const int a_ncomp, T *const a_alias)
   m_box = a_box;
   m_ncomp = a_ncomp;
   m_data = a_alias;
-  m_allocBy = (a_alias == nullptr) ? AllocBy::array : AllocBy::alias;
+  m_allocBy = (a_alias == nullptr) ? s_defaultAllocBy : AllocBy::alias;
+  m_layout = s_defaultLayout;
+  m_alignRows = (s_defaultAlignRows && m_layout == Layout::planar &&
+                 a_alias == nullptr);
   allocate();
 }
 
@@ -194,11 +286,45 @@ BaseFab<T>::define(const Box& a_box, const int a_ncomp,const T& a_val, T *const
   m_box = a_box;
   m_ncomp = a_ncomp;
   m_data = a_alias;
-  m_allocBy = (a_alias == nullptr) ? AllocBy::array : AllocBy::alias;
+  m_allocBy = (a_alias == nullptr) ? s_defaultAllocBy : AllocBy::alias;
+  m_layout = s_defaultLayout;
+  m_alignRows = (s_defaultAlignRows && m_layout == Layout::planar &&
+                 a_alias == nullptr);
   allocate();
   setVal(a_val);
 }
 
+/*--------------------------------------------------------------------*/
+//  Weak construction with sizes and a layout
+/** \param[in]  a_box   Box defining array dimensions
+ *  \param[in]  a_ncomp Number of components
+ *  \param[in]  a_layout
+ *                      Placement of components in memory
+ *  \param[in]  a_alias nullptr forces allocation.  Otherwise, memory
+ *                      is aliased to this address and must hold at
+ *                      least size() elements.  Default parameter is
+ *                      nullptr
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+void
+BaseFab<T>::define(const Box&   a_box,
+                   const int    a_ncomp,
+                   const Layout a_layout,
+                   T *const     a_alias)
+{
+  FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
+         << "): define\n");
+  deallocate();
+  m_box = a_box;
+  m_ncomp = a_ncomp;
+  m_data = a_alias;
+  m_allocBy = (a_alias == nullptr) ? s_defaultAllocBy : AllocBy::alias;
+  m_layout = a_layout;
+  m_alignRows = false;
+  allocate();
+}
+
 /*--------------------------------------------------------------------*/
 //  Destructor
 /*--------------------------------------------------------------------*/
@@ -238,10 +364,22 @@ void
 BaseFab<T>::setVal(const int a_icomp, const T& a_val)
 {
   CH_assert(a_icomp >= 0 && a_icomp < m_ncomp);
-  T* p = dataPtr(a_icomp);
-  for (int n = m_box.size(); n--;)
+  if (m_layout == Layout::planar)
     {
-      *p++ = a_val;
+      // Includes padding of aligned rows
+      T* p = dataPtr(a_icomp);
+      for (int n = m_size; n--;)
+        {
+          *p++ = a_val;
+        }
+    }
+  else
+    {
+      // Includes padding in rows of tiled layouts
+      for (int idx = 0; idx != m_size; ++idx)
+        {
+          m_data[offset(idx, a_icomp)] = a_val;
+        }
     }
 }
 
@@ -257,17 +395,7 @@ BaseFab<T>::copy(const Box&     a_box,
                  const BaseFab& a_src)
 {
   CH_assert(a_src.ncomp() == m_ncomp);
-  
-  MD_ARRAY_RESTRICT(arrSrc, a_src);
-  MD_ARRAY_RESTRICT(arrDst, *this);
-
-  for (int ic = 0; ic != m_ncomp; ++ic)
-    {
-      MD_BOXLOOP_OMP(a_box, i)
-        {
-          arrDst[MD_IX(i, ic)] = arrSrc[MD_IX(i,ic)];
-        }
-    }
+  copy(a_box, 0, a_src, a_box, 0, m_ncomp);
 }
 
 
@@ -303,26 +431,134 @@ BaseFab<T>::copy(const Box&     a_dstBox,
                  const int      a_numComp,
                  const unsigned a_compFlags)
 {
+  TIMED_REGION(timerCopy, "BaseFab::copy");
+  timerCopy.addBytes((long long)a_dstBox.size()*a_numComp*sizeof(T));
   const IntVect len = a_dstBox.dimensions();
-  CH_assert(this != &a_src);
+#ifndef RELEASE
+  // Copying within the same BaseFab is allowed if the regions are disjoint
+  // (e.g., filling periodic ghost cells from the interior)
+  Box overlap(a_dstBox);
+  overlap &= a_srcBox;
+  CH_assert(this != &a_src || overlap.isEmpty());
+#endif
   CH_assert(len == a_srcBox.dimensions());
   CH_assert(m_box.contains(a_dstBox));
   CH_assert(a_src.box().contains(a_srcBox));
   CH_assert(a_dstComp >= 0 && (a_dstComp + a_numComp) <= m_ncomp);
   CH_assert(a_srcComp >= 0 && (a_srcComp + a_numComp) <= a_src.ncomp());
 
-  MD_ARRAY_RESTRICT(arrSrc, a_src);
-  MD_ARRAY_RESTRICT(arrDst, *this);
-  IntVect offset = a_srcBox.loVect() - a_dstBox.loVect();
-  for (int ic = 0; ic != a_numComp; ++ic)
+  const IntVect shift = a_srcBox.loVect() - a_dstBox.loVect();
+  if (m_layout == Layout::planar && a_src.m_layout == Layout::planar)
+    {
+      // Copy whole pencils in direction 0, which are contiguous in both
+      // BaseFabs, for all components in one loop
+      int comp[a_numComp];
+      int numCopyComp = 0;
+      for (int ic = 0; ic != a_numComp; ++ic)
+        {
+          const int iDstC = ic + a_dstComp;
+          if ((iDstC >= (int)(8*sizeof(unsigned))) ||
+              (a_compFlags & (1u << iDstC)))
+            {
+              comp[numCopyComp++] = ic;
+            }
+        }
+      const int lenPencil = len[0];
+      const int numPencil = a_dstBox.size()/lenPencil;
+      const int numTask = numCopyComp*numPencil;
+#pragma omp parallel for default(shared)                                \
+  if (numCopyComp*a_dstBox.size() >= s_minThreadCopyCells)
+      for (int iTask = 0; iTask < numTask; ++iTask)
+        {
+          const int ic = comp[iTask/numPencil];
+          const int iPencil = iTask % numPencil;
+          IntVect iv(a_dstBox.loVect());
+          D_TERM(,
+                 iv[1] += iPencil % len[1];,
+                 iv[2] += iPencil/len[1];)
+          std::copy_n(
+            a_src.m_data + a_src.offset(a_src.index(iv + shift),
+                                        ic + a_srcComp),
+            lenPencil,
+            m_data + offset(index(iv), ic + a_dstComp));
+        }
+    }
+  else
+    {
+      // Traverse by cell so that components of a cell, which are close
+      // in memory for interleaved and tiled layouts, are copied together
+      MD_BOXLOOP_OMP(a_dstBox, i)
+        {
+          const IntVect iv(D_DECL(i0, i1, i2));
+          const int idxDst = index(iv);
+          const int idxSrc = a_src.index(iv + shift);
+          for (int ic = 0; ic != a_numComp; ++ic)
+            {
+              const int iDstC = ic + a_dstComp;
+              if ((iDstC >= (int)(8*sizeof(unsigned))) ||
+                  (a_compFlags & (1u << iDstC)))
+                {
+                  m_data[offset(idxDst, iDstC)] =
+                    a_src.m_data[a_src.offset(idxSrc, ic + a_srcComp)];
+                }
+            }
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Copy a portion of a BaseFab of another type, converting the values
+/** Used to move fields between storage and computation precision (see
+ *  RealStorage in Parameters.H).  Same region and all components.
+ *  \param[in]  a_box   Region to copy
+ *  \param[in]  a_src   Source BaseFab
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+template <typename S>
+void
+BaseFab<T>::convert(const Box&        a_box,
+                    const BaseFab<S>& a_src)
+{
+  TIMED_REGION(timerConvert, "BaseFab::convert");
+  timerConvert.addBytes((long long)a_box.size()*m_ncomp*sizeof(T));
+  CH_assert(a_src.ncomp() == m_ncomp);
+  CH_assert(m_box.contains(a_box));
+  CH_assert(a_src.box().contains(a_box));
+  if (m_layout == Layout::planar &&
+      a_src.layout() == BaseFab<S>::Layout::planar)
     {
-      const int iDstC = ic + a_dstComp;
-      if ((iDstC >= (int)(8*sizeof(unsigned))) || (a_compFlags & (1 << iDstC)))
+      const int lenPencil = a_box.dimensions()[0];
+      const int numPencil = a_box.size()/lenPencil;
+      const int numTask = m_ncomp*numPencil;
+#pragma omp parallel for default(shared)                                \
+  if (m_ncomp*a_box.size() >= s_minThreadCopyCells)
+      for (int iTask = 0; iTask < numTask; ++iTask)
         {
-          const int iSrcC = ic + a_srcComp;
-          MD_BOXLOOP_OMP(a_dstBox, i)
+          const int ic = iTask/numPencil;
+          const int iPencil = iTask % numPencil;
+          IntVect iv(a_box.loVect());
+          D_TERM(,
+                 iv[1] += iPencil % a_box.dimensions()[1];,
+                 iv[2] += iPencil/a_box.dimensions()[1];)
+          const S *const src = &a_src(iv, ic);
+          T *const dst = m_data + offset(index(iv), ic);
+#pragma omp simd
+          for (int i = 0; i < lenPencil; ++i)
             {
-              arrDst[MD_IX(i, iDstC)] = arrSrc[MD_OFFSETIV(i,+,offset, iSrcC)];
+              dst[i] = static_cast<T>(src[i]);
+            }
+        }
+    }
+  else
+    {
+      MD_BOXLOOP_OMP(a_box, i)
+        {
+          const IntVect iv(D_DECL(i0, i1, i2));
+          const int idxDst = index(iv);
+          for (int ic = 0; ic != m_ncomp; ++ic)
+            {
+              m_data[offset(idxDst, ic)] = static_cast<T>(a_src(iv, ic));
             }
         }
     }
@@ -355,23 +591,67 @@ BaseFab<T>::linearOut(void *const    a_buffer,
                       const int      a_endComp,
                       const unsigned a_compFlags) const
 {
+  TIMED_REGION(timerLinear, "BaseFab::linearOut");
   CH_assert(a_buffer != NULL);
   CH_assert(m_box.contains(a_region));
   CH_assert(a_startComp >= 0);
   CH_assert(a_endComp >= a_startComp && a_endComp <= m_ncomp);
 
-  MD_ARRAY_RESTRICT(arr, *this);
-  T* p = static_cast<T*>(a_buffer);
+  // The buffer is component planar regardless of the layout.  Location
+  // in the buffer is computed from the cell so that the loop can be
+  // threaded.
+  const IntVect bufDim = a_region.dimensions();
+  const IntVect bufStride(D_DECL(1, bufDim[0], bufDim[0]*bufDim[1]));
+  const int bufSize = a_region.size();
+  if (m_layout == Layout::planar)
+    {
+      // Pencils in direction 0 are contiguous in both the buffer and the
+      // BaseFab.  All components are packed in one loop.
+      int comp[a_endComp - a_startComp];
+      int numBufC = 0;
+      for (int ic = a_startComp; ic != a_endComp; ++ic)
+        {
+          if ((ic >= (int)(8*sizeof(unsigned))) || (a_compFlags & (1u << ic)))
+            {
+              comp[numBufC++] = ic;
+            }
+        }
+      const int numPencil = bufSize/bufDim[0];
+      const int numTask = numBufC*numPencil;
+#pragma omp parallel for default(shared)                                \
+  if (numBufC*bufSize >= s_minThreadCopyCells)
+      for (int iTask = 0; iTask < numTask; ++iTask)
+        {
+          const int iBufC = iTask/numPencil;
+          const int iPencil = iTask % numPencil;
+          IntVect iv(a_region.loVect());
+          D_TERM(,
+                 iv[1] += iPencil % bufDim[1];,
+                 iv[2] += iPencil/bufDim[1];)
+          std::copy_n(m_data + offset(index(iv), comp[iBufC]),
+                      bufDim[0],
+                      static_cast<T*>(a_buffer) + iBufC*bufSize +
+                      iPencil*bufDim[0]);
+        }
+      timerLinear.addBytes((long long)numBufC*bufSize*sizeof(T));
+      return;
+    }
+  T *const p = static_cast<T*>(a_buffer) -
+    (a_region.loVect()*bufStride).sum();
+  int iBufC = 0;
   for (int ic = a_startComp; ic != a_endComp; ++ic)
     {
-      if ((ic >= (int)(8*sizeof(unsigned))) || (a_compFlags & (1 << ic)))
+      if ((ic >= (int)(8*sizeof(unsigned))) || (a_compFlags & (1u << ic)))
         {
+          T *const pc = p + (iBufC++)*bufSize;
           MD_BOXLOOP_OMP(a_region, i)
             {
-              *p++ = arr[MD_IX(i, ic)];
+              pc[D_TERM(i0, + i1*bufStride[1], + i2*bufStride[2])] =
+                m_data[offset(index(IntVect(D_DECL(i0, i1, i2))), ic)];
             }
         }
     }
+  timerLinear.addBytes((long long)iBufC*bufSize*sizeof(T));
 }
 
 /*--------------------------------------------------------------------*/
@@ -399,23 +679,66 @@ BaseFab<T>::linearIn(const void* const a_buffer,
                      const int      a_endComp,
                      const unsigned a_compFlags)
 {
+  TIMED_REGION(timerLinear, "BaseFab::linearIn");
   CH_assert(a_buffer != NULL);
   CH_assert(m_box.contains(a_region));
   CH_assert(a_startComp >= 0);
   CH_assert(a_endComp >= a_startComp && a_endComp <= m_ncomp);
 
-  MD_ARRAY_RESTRICT(arr, *this);
-  T* p = (T*)a_buffer;
+  // See linearOut for the format of the buffer
+  const IntVect bufDim = a_region.dimensions();
+  const IntVect bufStride(D_DECL(1, bufDim[0], bufDim[0]*bufDim[1]));
+  const int bufSize = a_region.size();
+  if (m_layout == Layout::planar)
+    {
+      // Pencils in direction 0 are contiguous in both the buffer and the
+      // BaseFab.  All components are unpacked in one loop.
+      int comp[a_endComp - a_startComp];
+      int numBufC = 0;
+      for (int ic = a_startComp; ic != a_endComp; ++ic)
+        {
+          if ((ic >= (int)(8*sizeof(unsigned))) || (a_compFlags & (1u << ic)))
+            {
+              comp[numBufC++] = ic;
+            }
+        }
+      const int numPencil = bufSize/bufDim[0];
+      const int numTask = numBufC*numPencil;
+#pragma omp parallel for default(shared)                                \
+  if (numBufC*bufSize >= s_minThreadCopyCells)
+      for (int iTask = 0; iTask < numTask; ++iTask)
+        {
+          const int iBufC = iTask/numPencil;
+          const int iPencil = iTask % numPencil;
+          IntVect iv(a_region.loVect());
+          D_TERM(,
+                 iv[1] += iPencil % bufDim[1];,
+                 iv[2] += iPencil/bufDim[1];)
+          std::copy_n(static_cast<const T*>(a_buffer) + iBufC*bufSize +
+                      iPencil*bufDim[0],
+                      bufDim[0],
+                      m_data + offset(index(iv), comp[iBufC]));
+        }
+      timerLinear.addBytes((long long)numBufC*bufSize*sizeof(T));
+      return;
+    }
+  const T *const p =
+    static_cast<const T*>(a_buffer) -
+    (a_region.loVect()*bufStride).sum();
+  int iBufC = 0;
   for (int ic = a_startComp; ic != a_endComp; ++ic)
     {
-      if ((ic >= (int)(8*sizeof(unsigned))) || (a_compFlags & (1 << ic)))
+      if ((ic >= (int)(8*sizeof(unsigned))) || (a_compFlags & (1u << ic)))
         {
+          const T *const pc = p + (iBufC++)*bufSize;
           MD_BOXLOOP_OMP(a_region, i)
             {
-              arr[MD_IX(i, ic)] = *p++;
+              m_data[offset(index(IntVect(D_DECL(i0, i1, i2))), ic)] =
+                pc[D_TERM(i0, + i1*bufStride[1], + i2*bufStride[2])];
             }
         }
     }
+  timerLinear.addBytes((long long)iBufC*bufSize*sizeof(T));
 }
 
 
@@ -481,6 +804,31 @@ BaseFab<T>::copyToHostAsync(cudaStream_t a_stream)
                                cudaMemcpyDeviceToHost,
                                a_stream));
 }
+
+/*--------------------------------------------------------------------*/
+//  Asynchronous copy of the device array of another fab to this host
+//  array
+/** Only the host array of this fab is written so it can be used as a
+ *  pinned snapshot of a solution that otherwise stays on the device.
+ *  \param[in]  a_src   Fab with the same box, components, and layout
+ *  \param[in]  a_stream
+ *                      Stream index (defaults to default stream)
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+void
+BaseFab<T>::copyDeviceToHostAsync(const BaseFab& a_src,
+                                  cudaStream_t   a_stream)
+{
+  CH_assert(a_src.box() == m_box);
+  CH_assert(a_src.ncomp() == m_ncomp);
+  CH_assert(a_src.layout() == m_layout);
+  CU_SAFE_CALL(cudaMemcpyAsync(m_dataSymbol.host,
+                               a_src.m_dataSymbol.device,
+                               sizeBytes(),
+                               cudaMemcpyDeviceToHost,
+                               a_stream));
+}
 #endif  /* CUDA */
 
 /*--------------------------------------------------------------------*/
@@ -495,11 +843,23 @@ BaseFab<T>::setStride()
   const IntVect& hi = m_box.hiVect();
   CH_assert(lo <= hi);
   // Set strides
+  // Rows of tiled layouts are padded to a whole number of tiles.  Aligned
+  // rows are also padded before the first cell so that tiles start at cells
+  // with i0 a multiple of s_tileSize.
+  m_rowLead = 0;
+  if (m_alignRows)
+    {
+      m_rowLead = ((lo[0] % s_tileSize) + s_tileSize) % s_tileSize;
+    }
+  const int rowSize = (m_layout == Layout::tiled || m_alignRows) ?
+    ((m_rowLead + hi[0] - lo[0] + s_tileSize)/s_tileSize)*s_tileSize :
+    (hi[0] - lo[0] + 1);
   D_TERM(m_stride[0] = 1;,
-         m_stride[1] = m_stride[0]*(hi[0] - lo[0] + 1);,
+         m_stride[1] = rowSize;,
          m_stride[2] = m_stride[1]*(hi[1] - lo[1] + 1);)
   // Set size
-  m_size = m_stride[g_SpaceDim-1]*(hi[g_SpaceDim-1] - lo[g_SpaceDim-1] + 1);
+  m_size = (g_SpaceDim == 1) ?
+    rowSize : m_stride[g_SpaceDim-1]*(hi[g_SpaceDim-1] - lo[g_SpaceDim-1] + 1);
 } 
 
 /*--------------------------------------------------------------------*/
@@ -511,6 +871,50 @@ void
 BaseFab<T>::allocate()
 {
   setStride();
+#ifdef USE_GPU
+  // Host memory must be pinned
+  if (m_allocBy == AllocBy::pool)
+    {
+      m_allocBy = AllocBy::array;
+    }
+#endif
+  // Aligned rows need memory aligned for vectors
+  if (m_alignRows && m_allocBy == AllocBy::array)
+    {
+      m_allocBy = AllocBy::pool;
+    }
+  if (m_allocBy == AllocBy::pool)
+    {
+      deallocate();
+      m_data = static_cast<T*>(MemoryPool::allocate(sizeBytes()));
+      // Construct and first touch with the same distribution of work among
+      // threads as MD_BOXLOOP_OMP so that pages are placed near the threads
+      // that will use them.  Recycled blocks keep their placement.
+      if (m_layout == Layout::planar)
+        {
+          MD_ARRAY_RESTRICT(arr, *this);
+          for (int ic = 0; ic != m_ncomp; ++ic)
+            {
+              MD_BOXLOOP_OMP(m_box, i)
+                {
+                  new (&arr[MD_IX(i, ic)]) T();
+                }
+            }
+        }
+      else
+        {
+          MD_BOXLOOP_OMP(m_box, i)
+            {
+              const int idx = index(IntVect(D_DECL(i0, i1, i2)));
+              for (int ic = 0; ic != m_ncomp; ++ic)
+                {
+                  new (&m_data[offset(idx, ic)]) T();
+                }
+            }
+        }
+      FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
+             << "): pool\n");
+    }
   if (m_allocBy == AllocBy::array)
     {
       deallocate();
@@ -548,6 +952,177 @@ BaseFab<T>::deallocate()
 #endif
       m_data = nullptr;
     }
+  if (m_allocBy == AllocBy::pool && m_data != nullptr)
+    {
+      FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
+             << "): pool return\n");
+      // All instantiated types are trivially destructible
+      MemoryPool::deallocate(m_data);
+      m_data = nullptr;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Rows and components start on boundaries for aligned vector loads
+/** If true, vectors starting at cells with i0 a multiple of
+ *  tileSize() can be loaded and stored with aligned operations in
+ *  every row and component (see stencilPencil).  This is normally the
+ *  case for aligned rows and is always false without vector
+ *  extensions.
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+bool
+BaseFab<T>::vectorAligned() const
+{
+#ifdef CH_VECLS_ALIGN
+  // The data must start at a cell with i0 a multiple of s_tileSize.
+  // Components are a whole number of rows.  A vector of s_tileSize
+  // cells is smaller than a register if T is smaller than Real (e.g.,
+  // float storage) and only needs alignment to its size.
+  const uintptr_t align = std::min((uintptr_t)CH_VECLS_ALIGN,
+                                   (uintptr_t)(s_tileSize*sizeof(T)));
+  const int lo0 = m_box.loVect()[0] - m_rowLead;
+  return (m_data != nullptr &&
+          m_layout == Layout::planar &&
+          lo0 % s_tileSize == 0 &&
+          reinterpret_cast<uintptr_t>(m_data) % align == 0 &&
+          (rowSize()*sizeof(T)) % align == 0);
+#else
+  return false;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+//  Set the method of allocation used for new BaseFabs (not aliases)
+/** Existing BaseFabs are not affected.  AllocBy::pool is replaced by
+ *  AllocBy::array when using a GPU since host memory must be pinned.
+ *  \param[in]  a_allocBy
+ *                      AllocBy::array or AllocBy::pool
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+void
+BaseFab<T>::setDefaultAllocBy(const AllocBy a_allocBy)
+{
+  CH_assert(a_allocBy == AllocBy::array || a_allocBy == AllocBy::pool);
+  s_defaultAllocBy = a_allocBy;
+}
+
+/*--------------------------------------------------------------------*/
+//  Method of allocation used for new BaseFabs (not aliases)
+/*--------------------------------------------------------------------*/
+
+template <typename T>
+auto
+BaseFab<T>::defaultAllocBy()
+  -> AllocBy
+{
+  return s_defaultAllocBy;
+}
+
+/*--------------------------------------------------------------------*/
+//  Set the layout used for BaseFabs defined without a layout
+/** Existing BaseFabs are not affected.  This also selects the layout
+ *  of BaseFabs in a LevelData.
+ *  \param[in]  a_layout
+ *                      New default layout
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+void
+BaseFab<T>::setDefaultLayout(const Layout a_layout)
+{
+  s_defaultLayout = a_layout;
+}
+
+/*--------------------------------------------------------------------*/
+//  Layout used for BaseFabs defined without a layout
+/*--------------------------------------------------------------------*/
+
+template <typename T>
+auto
+BaseFab<T>::defaultLayout()
+  -> Layout
+{
+  return s_defaultLayout;
+}
+
+/*--------------------------------------------------------------------*/
+//  Number of cells in a tile for Layout::tiled (VecSz_r)
+/*--------------------------------------------------------------------*/
+
+template <typename T>
+int
+BaseFab<T>::tileSize()
+{
+  return s_tileSize;
+}
+
+/*--------------------------------------------------------------------*/
+//  Set if rows of planar BaseFabs defined without a layout are padded
+//  for aligned vector loads and stores
+/** Existing BaseFabs are not affected.  Rows (direction 0) are padded
+ *  before and after so they hold a whole number of tiles starting at
+ *  a cell with i0 a multiple of tileSize().  The memory is taken from
+ *  the MemoryPool so that vectors starting at these cells are aligned
+ *  in every row (see vectorAligned()).  Boxes with a size and origin
+ *  that are multiples of tileSize() then have the same padding, as
+ *  required for checkpoints.  BaseFabs defined with an explicit
+ *  layout or as an alias are never padded so their data stays
+ *  contiguous.  This is ignored when using a GPU since CudaFab does
+ *  not support padded rows.
+ *  \param[in]  a_alignRows
+ *                      T - pad rows of new planar BaseFabs
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+void
+BaseFab<T>::setDefaultAlignRows(const bool a_alignRows)
+{
+#ifndef USE_GPU
+  s_defaultAlignRows = a_alignRows;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+//  Rows of planar BaseFabs defined without a layout are padded
+/*--------------------------------------------------------------------*/
+
+template <typename T>
+bool
+BaseFab<T>::defaultAlignRows()
+{
+  return s_defaultAlignRows;
+}
+
+/*--------------------------------------------------------------------*/
+//  Set the smallest copy that is threaded
+/** copy, linearOut, and linearIn of planar data only open a parallel
+ *  region if the number of cells times the number of components is
+ *  at least this.  Ghost faces, edges, and corners of exchanges are
+ *  usually smaller and are faster copied by the calling thread.
+ *  \param[in]  a_minCells
+ *                      Minimum cells times components (0 always
+ *                      threads)
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+void
+BaseFab<T>::setMinThreadCopyCells(const int a_minCells)
+{
+  s_minThreadCopyCells = a_minCells;
+}
+
+/*--------------------------------------------------------------------*/
+//  Smallest copy (cells times components) that is threaded
+/*--------------------------------------------------------------------*/
+
+template <typename T>
+int
+BaseFab<T>::minThreadCopyCells()
+{
+  return s_minThreadCopyCells;
 }
 
 
@@ -561,4 +1136,8 @@ template class BaseFab<bool>;
 template class BaseFab<char>;
 template class BaseFab<int>;
 template class BaseFab<unsigned>;
-template class BaseFab<Real>;
+template class BaseFab<float>;
+template class BaseFab<double>;
+
+template void BaseFab<float>::convert(const Box&, const BaseFab<double>&);
+template void BaseFab<double>::convert(const Box&, const BaseFab<float>&);
@@ -0,0 +1,212 @@
+
+/******************************************************************************/
+/**
+ * \file BoxBins.cpp
+ *
+ * \brief Non-inline definitions for classes in BoxBins.H
+ *
+ *//*+*************************************************************************/
+
+#include <algorithm>
+#include <utility>
+
+#include "BaseFabMacros.H"
+#include "BoxBins.H"
+
+
+/*******************************************************************************
+ *
+ * Class BoxBins: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Default constructor
+/*--------------------------------------------------------------------*/
+
+BoxBins::BoxBins()
+  :
+  m_origin(IntVect::Zero),
+  m_binSize(IntVect::Unit),
+  m_binBox()
+{
+  m_slotBegin.assign(1, 0);
+}
+
+/*--------------------------------------------------------------------*/
+//  Constructor
+/** \param[in]  a_boxes Disjoint boxes that are not empty
+ *  \param[in]  a_origin
+ *                      Low corner of the bin at (0,0,0), usually the
+ *                      low corner of the problem domain
+ *  \param[in]  a_binSize
+ *                      Size of the bins, usually the size of the
+ *                      largest box
+ *//*-----------------------------------------------------------------*/
+
+BoxBins::BoxBins(const std::vector<Box>& a_boxes,
+                 const IntVect&          a_origin,
+                 const IntVect&          a_binSize)
+{
+  define(a_boxes, a_origin, a_binSize);
+}
+
+/*--------------------------------------------------------------------*/
+//  Weak construction
+/** \param[in]  a_boxes Disjoint boxes that are not empty
+ *  \param[in]  a_origin
+ *                      Low corner of the bin at (0,0,0)
+ *  \param[in]  a_binSize
+ *                      Size of the bins
+ *//*-----------------------------------------------------------------*/
+
+void
+BoxBins::define(const std::vector<Box>& a_boxes,
+                const IntVect&          a_origin,
+                const IntVect&          a_binSize)
+{
+  CH_assert(IntVect::Zero < a_binSize);
+  m_origin = a_origin;
+  m_binSize = a_binSize;
+  m_box = a_boxes;
+  m_binSlot.clear();
+  m_slotBin.clear();
+
+  // Each (bin, box) pair ordered by box index
+  std::vector<std::pair<int, int> > slotBoxPair;
+  slotBoxPair.reserve(m_box.size());
+  const int numBox = m_box.size();
+  for (int idx = 0; idx != numBox; ++idx)
+    {
+      const Box& box = m_box[idx];
+      CH_assert(!box.isEmpty());
+      const Box bins(bin(box.loVect()), bin(box.hiVect()));
+      MD_BOXLOOP(bins, i)
+        {
+          const IntVect ivBin(D_DECL(i0, i1, i2));
+          const auto ins = m_binSlot.emplace(binKey(ivBin), m_slotBin.size());
+          if (ins.second)
+            {
+              m_slotBin.push_back(ivBin);
+            }
+          slotBoxPair.emplace_back(ins.first->second, idx);
+        }
+    }
+
+  // Store the boxes of each slot contiguously
+  std::stable_sort(slotBoxPair.begin(), slotBoxPair.end(),
+                   [](const std::pair<int, int>& a_x,
+                      const std::pair<int, int>& a_y)
+                   {
+                     return a_x.first < a_y.first;
+                   });
+  const int numSlot = m_slotBin.size();
+  m_slotBegin.assign(numSlot + 1, 0);
+  m_slotBox.resize(slotBoxPair.size());
+  for (int i = 0, iEnd = slotBoxPair.size(); i != iEnd; ++i)
+    {
+      ++m_slotBegin[slotBoxPair[i].first + 1];
+      m_slotBox[i] = slotBoxPair[i].second;
+    }
+  for (int iSlot = 0; iSlot != numSlot; ++iSlot)
+    {
+      m_slotBegin[iSlot + 1] += m_slotBegin[iSlot];
+    }
+
+  // Bounding box of the bins
+  m_binBox = Box();
+  if (numSlot > 0)
+    {
+      IntVect lo = m_slotBin[0];
+      IntVect hi = m_slotBin[0];
+      for (const IntVect& ivBin : m_slotBin)
+        {
+          lo.min(ivBin);
+          hi.max(ivBin);
+        }
+      m_binBox.define(lo, hi);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Index of the box containing a cell
+/** \param[in]  a_iv    Cell
+ *  \return             Index of the box or -1 if no box contains the
+ *                      cell
+ *//*-----------------------------------------------------------------*/
+
+int
+BoxBins::find(const IntVect& a_iv) const
+{
+  const IntVect ivBin = bin(a_iv);
+  if (!m_binBox.contains(ivBin)) return -1;
+  const auto iter = m_binSlot.find(binKey(ivBin));
+  if (iter == m_binSlot.end()) return -1;
+  for (int i = m_slotBegin[iter->second], iEnd = m_slotBegin[iter->second + 1];
+       i != iEnd; ++i)
+    {
+      if (m_box[m_slotBox[i]].contains(a_iv)) return m_slotBox[i];
+    }
+  return -1;
+}
+
+/*--------------------------------------------------------------------*/
+//  Indices of the boxes overlapping a region
+/** A box in several bins is reported from the bin containing the low
+ *  corner of its intersection with the region so it is only found
+ *  once.  If the region covers more bins than hold boxes, all bins
+ *  holding boxes are searched instead.
+ *  \param[in]  a_region
+ *                      Region to search
+ *  \param[out] a_idx   Indices of the boxes overlapping the region
+ *                      (ascending)
+ *//*-----------------------------------------------------------------*/
+
+void
+BoxBins::overlaps(const Box& a_region, std::vector<int>& a_idx) const
+{
+  a_idx.clear();
+  if (a_region.isEmpty()) return;
+  Box bins(bin(a_region.loVect()), bin(a_region.hiVect()));
+  bins &= m_binBox;
+  if (bins.isEmpty()) return;
+  const auto searchSlot =
+    [&]
+    (const int a_slot, const IntVect& a_ivBin)
+    {
+      for (int i = m_slotBegin[a_slot], iEnd = m_slotBegin[a_slot + 1];
+           i != iEnd; ++i)
+        {
+          Box overlap(m_box[m_slotBox[i]]);
+          overlap &= a_region;
+          if (!overlap.isEmpty() && bin(overlap.loVect()) == a_ivBin)
+            {
+              a_idx.push_back(m_slotBox[i]);
+            }
+        }
+    };
+  if ((std::size_t)bins.size() <= m_slotBin.size())
+    {
+      MD_BOXLOOP(bins, i)
+        {
+          const IntVect ivBin(D_DECL(i0, i1, i2));
+          const auto iter = m_binSlot.find(binKey(ivBin));
+          if (iter != m_binSlot.end())
+            {
+              searchSlot(iter->second, ivBin);
+            }
+        }
+    }
+  else
+    {
+      for (int iSlot = 0, iSlotEnd = m_slotBin.size(); iSlot != iSlotEnd;
+           ++iSlot)
+        {
+          if (bins.contains(m_slotBin[iSlot]))
+            {
+              searchSlot(iSlot, m_slotBin[iSlot]);
+            }
+        }
+    }
+  std::sort(a_idx.begin(), a_idx.end());
+}
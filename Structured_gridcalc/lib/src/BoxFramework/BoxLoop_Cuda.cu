@@ -0,0 +1,123 @@
+
+/******************************************************************************/
+/**
+ * \file BoxLoop_Cuda.cu
+ *
+ * \brief Non-inline definitions for classes in BoxLoop_Cuda.H
+ *
+ *//*+*************************************************************************/
+
+#include <cstring>
+
+#include "BoxLoop_Cuda.H"
+
+/*
+ * The tables are defined from BaseFabs but BaseFab.H cannot be compiled by
+ * nvcc.  Like LevelData_Cuda, they are reinterpreted as BaseFabData (which
+ * has the same layout) and aliased on the device with CudaFab.
+ */
+
+
+/*******************************************************************************
+ *
+ * Class FabTable: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Weak construction
+/** The CudaFabs are built on the host and copied to the device.
+ *  \param[in]  a_fabs  Fabs of the boxes (data must be on the device,
+ *                      planar layout)
+ *  \param[in]  a_boxes Disjoint boxes (the cells to loop over)
+ *  \param[in]  a_numBox
+ *                      Number of boxes
+ *  \param[in]  a_numGhost
+ *                      Number of ghost cells of the fabs around the
+ *                      boxes
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+void
+BoxLoop_Cuda::FabTable<T>::define(const BaseFab<T> *const *const a_fabs,
+                                  const Box *const               a_boxes,
+                                  const int                      a_numBox,
+                                  const int                      a_numGhost)
+{
+  CH_assert(a_numBox >= 0 && a_numBox <= g_maxBox);
+  clear();
+  m_numBox = a_numBox;
+  m_numGhost = a_numGhost;
+  m_maxBoxSize = 0;
+  m_maxBoxDims = IntVect(D_DECL(0, 0, 0));
+  if (m_numBox == 0) return;
+
+//--Fabs
+
+  const int numBytesFab = m_numBox*sizeof(CudaFab<T>);
+  CudaFab<T>* fabs_host;
+  CU_SAFE_CALL(cudaHostAlloc(&fabs_host,
+                             numBytesFab,
+                             cudaHostAllocWriteCombined));
+  for (int idx = 0; idx != m_numBox; ++idx)
+    {
+      fabs_host[idx].define(
+        reinterpret_cast<const BaseFabData<T>&>(*a_fabs[idx]));
+    }
+  CU_SAFE_CALL(cudaMalloc(&m_fabs, numBytesFab));
+  CU_SAFE_CALL(cudaMemcpy(m_fabs,
+                          fabs_host,
+                          numBytesFab,
+                          cudaMemcpyHostToDevice));
+  CU_SAFE_CALL(cudaFreeHost(fabs_host));
+
+//--Boxes
+
+  const int numBytesBox = m_numBox*sizeof(Box);
+  Box* boxes_host;
+  CU_SAFE_CALL(cudaHostAlloc(&boxes_host,
+                             numBytesBox,
+                             cudaHostAllocWriteCombined));
+  std::memcpy(boxes_host, a_boxes, numBytesBox);
+  for (int idx = 0; idx != m_numBox; ++idx)
+    {
+      const Box& box = a_boxes[idx];
+      if (box.size() > m_maxBoxSize) m_maxBoxSize = box.size();
+      m_maxBoxDims.max(box.dimensions());
+    }
+  CU_SAFE_CALL(cudaMalloc(&m_boxes, numBytesBox));
+  CU_SAFE_CALL(cudaMemcpy(m_boxes,
+                          boxes_host,
+                          numBytesBox,
+                          cudaMemcpyHostToDevice));
+  CU_SAFE_CALL(cudaFreeHost(boxes_host));
+}
+
+/*--------------------------------------------------------------------*/
+//  Free the memory on the device
+/*--------------------------------------------------------------------*/
+
+template <typename T>
+void
+BoxLoop_Cuda::FabTable<T>::clear()
+{
+  if (m_fabs != nullptr)
+    {
+      CU_SAFE_CALL(cudaFree(m_fabs));
+      m_fabs = nullptr;
+    }
+  if (m_boxes != nullptr)
+    {
+      CU_SAFE_CALL(cudaFree(m_boxes));
+      m_boxes = nullptr;
+    }
+  m_numBox = 0;
+}
+
+//--Explicit instantiations (matching those of BaseFab)
+
+template class BoxLoop_Cuda::FabTable<char>;
+template class BoxLoop_Cuda::FabTable<int>;
+template class BoxLoop_Cuda::FabTable<unsigned>;
+template class BoxLoop_Cuda::FabTable<float>;
+template class BoxLoop_Cuda::FabTable<double>;
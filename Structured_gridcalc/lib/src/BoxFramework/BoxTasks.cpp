@@ -0,0 +1,24 @@
+
+/******************************************************************************/
+/**
+ * \file BoxTasks.cpp
+ *
+ * \brief Non-inline definitions for classes in BoxTasks.H
+ *
+ *//*+*************************************************************************/
+
+#include "BoxTasks.H"
+
+
+/*******************************************************************************
+ *
+ * Class BoxTasks: static data member definitions
+ *
+ ******************************************************************************/
+
+// 32^3 cells.  Box sizes commonly used (e.g., 16^3) are not divided.
+int BoxTasks::s_maxTileCells = 32768;
+
+// Whole pencils.  A 16^3 box has 16 tiles and a 128^3 box 1024 tiles of
+// 128x4x4 cells (16 KiB per component in double).
+IntVect BoxTasks::s_tileShape(D_DECL(0, 4, 4));
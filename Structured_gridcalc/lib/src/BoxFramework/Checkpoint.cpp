@@ -0,0 +1,580 @@
+
+/******************************************************************************/
+/**
+ * \file Checkpoint.cpp
+ *
+ * \brief Non-inline definitions for classes in Checkpoint.H
+ *
+ *//*+*************************************************************************/
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
+#include "Checkpoint.H"
+#include "TimerRegistry.H"
+
+
+/*******************************************************************************
+ *
+ * Class CheckpointFormat: static member initialization
+ *
+ ******************************************************************************/
+
+constexpr char CheckpointFormat::s_magic[8];
+constexpr int64_t CheckpointFormat::s_version;
+constexpr int64_t CheckpointFormat::s_alignment;
+
+
+/*******************************************************************************
+ *
+ * Class CheckpointWriter: member definitions
+ *
+ ******************************************************************************/
+
+#ifndef USE_MPI
+/*--------------------------------------------------------------------*/
+/// Write all of a buffer at an offset in a file
+/** \param[in]  a_fd    File descriptor
+ *  \param[in]  a_buffer
+ *                      Data to write
+ *  \param[in]  a_bytes Number of bytes to write
+ *  \param[in]  a_offset
+ *                      Offset in the file
+ *  \return             0 Success
+ *                     -1 Error (see errno)
+ *//*-----------------------------------------------------------------*/
+
+static int
+pwriteAll(const int   a_fd,
+          const void* a_buffer,
+          size_t      a_bytes,
+          off_t       a_offset)
+{
+  const char* buffer = static_cast<const char*>(a_buffer);
+  while (a_bytes > 0)
+    {
+      const ssize_t numWritten = ::pwrite(a_fd, buffer, a_bytes, a_offset);
+      if (numWritten < 0)
+        {
+          if (errno == EINTR) continue;
+          return -1;
+        }
+      buffer += numWritten;
+      a_bytes -= numWritten;
+      a_offset += numWritten;
+    }
+  return 0;
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+//  Constructor
+/** \param[in]  a_dbl   Layout of all data to write
+ *//*-----------------------------------------------------------------*/
+
+CheckpointWriter::CheckpointWriter(const DisjointBoxLayout& a_dbl)
+  :
+  m_disjointBoxLayout(a_dbl)
+{
+}
+
+/*--------------------------------------------------------------------*/
+//  Set attributes describing the state of the solver
+/** \param[in]  a_intAttribute
+ *                      Integer attributes (e.g., the iteration)
+ *  \param[in]  a_realAttribute
+ *                      Real attributes (e.g., the time).  Default
+ *                      none.
+ *//*-----------------------------------------------------------------*/
+
+void
+CheckpointWriter::setAttributes(const std::vector<long long>& a_intAttribute,
+                                const std::vector<double>&    a_realAttribute)
+{
+  m_intAttribute = a_intAttribute;
+  m_realAttribute = a_realAttribute;
+}
+
+/*--------------------------------------------------------------------*/
+//  Add a LevelData given a description and the memory of its fabs
+/** \param[in]  a_elemSize
+ *                      Bytes in one element
+ *  \param[in]  a_ncomp Number of components
+ *  \param[in]  a_nghost
+ *                      Number of ghost cells
+ *  \param[in]  a_layout
+ *                      BaseFab::Layout of components
+ *  \param[in]  a_block Memory of each local box (in local order)
+ *  \param[in]  a_blockBytes
+ *                      Bytes in the memory of each local box.  Boxes in
+ *                      a layout all have the same size so these must
+ *                      be the same.
+ *//*-----------------------------------------------------------------*/
+
+void
+CheckpointWriter::addData(const int64_t                   a_elemSize,
+                          const int                       a_ncomp,
+                          const int                       a_nghost,
+                          const int                       a_layout,
+                          const std::vector<const void*>& a_block,
+                          const std::vector<int64_t>&     a_blockBytes)
+{
+  CH_assert(a_block.size() == a_blockBytes.size());
+  Data data;
+  std::memset(&data.m_header, 0, sizeof(CheckpointFormat::DataHeader));
+  data.m_header.m_elemSize = a_elemSize;
+  data.m_header.m_ncomp    = a_ncomp;
+  data.m_header.m_nghost   = a_nghost;
+  data.m_header.m_layout   = a_layout;
+  for (const int64_t bytes : a_blockBytes)
+    {
+      CH_assert(bytes == a_blockBytes.front());
+      data.m_header.m_blockBytes = bytes;
+    }
+  data.m_block = a_block;
+  m_data.push_back(data);
+}
+
+/*--------------------------------------------------------------------*/
+//  Write the checkpoint file (collective if using MPI)
+/** Any existing file is replaced.  The index is computed identically
+ *  on all processes and written by process 0.
+ *  \param[in]  a_fileName
+ *                      Name of the file
+ *  \return             0 Success
+ *                     -1 Error (on any process if using MPI)
+ *//*-----------------------------------------------------------------*/
+
+int
+CheckpointWriter::write(const std::string& a_fileName) const
+{
+  TIMED_REGION(timerWrite, "CheckpointWriter::write");
+  const DisjointBoxLayout& dbl = m_disjointBoxLayout;
+  const int numData = m_data.size();
+
+//--File header
+
+  CheckpointFormat::FileHeader header;
+  std::memset(&header, 0, sizeof(CheckpointFormat::FileHeader));
+  std::memcpy(header.m_magic, CheckpointFormat::s_magic, 8);
+  header.m_version          = CheckpointFormat::s_version;
+  header.m_spaceDim         = g_SpaceDim;
+  header.m_numBox           = dbl.size();
+  header.m_numProc          = DisjointBoxLayout::numProc();
+  header.m_numIntAttribute  = m_intAttribute.size();
+  header.m_numRealAttribute = m_realAttribute.size();
+  header.m_numData          = numData;
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      header.m_domainLo[dir] = dbl.problemDomain().loVect(dir);
+      header.m_domainHi[dir] = dbl.problemDomain().hiVect(dir);
+      header.m_boxSize[dir]  = (dbl.size() > 0) ?
+        dbl.getLinear(0).box.dimensions()[dir] : 0;
+    }
+
+//--Data headers.  Processes without boxes do not know the size of a block.
+
+  std::vector<int64_t> blockBytes(numData);
+  for (int iData = 0; iData != numData; ++iData)
+    {
+      blockBytes[iData] = m_data[iData].m_header.m_blockBytes;
+    }
+#ifdef USE_MPI
+  if (numData > 0)
+    {
+      MPI_Allreduce(MPI_IN_PLACE, blockBytes.data(), numData, MPI_INT64_T,
+                    MPI_MAX, MPI_COMM_WORLD);
+    }
+#endif
+  std::vector<CheckpointFormat::DataHeader> dataHeader(numData);
+  int64_t offset = CheckpointFormat::align(
+    CheckpointFormat::indexBytes(header));
+  for (int iData = 0; iData != numData; ++iData)
+    {
+      dataHeader[iData] = m_data[iData].m_header;
+      dataHeader[iData].m_blockBytes  = blockBytes[iData];
+      dataHeader[iData].m_blockStride =
+        CheckpointFormat::align(blockBytes[iData]);
+      dataHeader[iData].m_offset      = offset;
+      offset += header.m_numBox*dataHeader[iData].m_blockStride;
+    }
+  const int64_t fileBytes = offset;
+
+//--Pack the index
+
+  std::vector<char> index(CheckpointFormat::indexBytes(header));
+  {
+    char* p = index.data();
+    std::memcpy(p, &header, sizeof(CheckpointFormat::FileHeader));
+    p += sizeof(CheckpointFormat::FileHeader);
+    for (int i = 0; i != dbl.size(); ++i)
+      {
+        const int64_t proc = dbl.getLinear(i).proc;
+        std::memcpy(p, &proc, sizeof(int64_t));
+        p += sizeof(int64_t);
+      }
+    for (const long long attribute : m_intAttribute)
+      {
+        const int64_t value = attribute;
+        std::memcpy(p, &value, sizeof(int64_t));
+        p += sizeof(int64_t);
+      }
+    for (const double attribute : m_realAttribute)
+      {
+        std::memcpy(p, &attribute, sizeof(double));
+        p += sizeof(double);
+      }
+    for (const CheckpointFormat::DataHeader& desc : dataHeader)
+      {
+        std::memcpy(p, &desc, sizeof(CheckpointFormat::DataHeader));
+        p += sizeof(CheckpointFormat::DataHeader);
+      }
+  }
+
+//--Local blocks in order of offset in the file
+
+  std::vector<const void*> blockMem;
+  std::vector<int64_t> blockOffset;
+  std::vector<int64_t> blockLen;
+  for (int iData = 0; iData != numData; ++iData)
+    {
+      int iLocal = 0;
+      for (DataIterator dit(dbl); dit.ok(); ++dit)
+        {
+          blockMem.push_back(m_data[iData].m_block[iLocal++]);
+          blockOffset.push_back(dataHeader[iData].m_offset +
+                                (*dit).globalIndex()*
+                                dataHeader[iData].m_blockStride);
+          blockLen.push_back(dataHeader[iData].m_blockBytes);
+          timerWrite.addBytes(dataHeader[iData].m_blockBytes);
+        }
+    }
+  const int numBlock = blockMem.size();
+  timerWrite.addCount(numBlock);
+
+//--Write
+
+  int status = 0;
+#ifdef USE_MPI
+  MPI_File fh;
+  if (MPI_File_open(MPI_COMM_WORLD,
+                    a_fileName.c_str(),
+                    MPI_MODE_WRONLY | MPI_MODE_CREATE,
+                    MPI_INFO_NULL,
+                    &fh) != MPI_SUCCESS)
+    {
+      std::cout << "EE Failed to open checkpoint " << a_fileName
+                << " for writing!" << std::endl;
+      return -1;
+    }
+  // Also truncates an existing, larger, file
+  if (MPI_File_set_size(fh, fileBytes) != MPI_SUCCESS)
+    {
+      status = -1;
+    }
+  if (DisjointBoxLayout::procID() == 0 &&
+      MPI_File_write_at(fh, 0, index.data(), index.size(), MPI_BYTE,
+                        MPI_STATUS_IGNORE) != MPI_SUCCESS)
+    {
+      status = -1;
+    }
+  // The blocks in the file and in memory are described by indexed types so
+  // that all blocks are written by one collective call
+  std::vector<int> len(numBlock);
+  std::vector<MPI_Aint> fileDispl(numBlock);
+  std::vector<MPI_Aint> memDispl(numBlock);
+  for (int iBlock = 0; iBlock != numBlock; ++iBlock)
+    {
+      CH_assert(blockLen[iBlock] <= std::numeric_limits<int>::max());
+      len[iBlock] = blockLen[iBlock];
+      fileDispl[iBlock] = blockOffset[iBlock];
+      MPI_Get_address(const_cast<void*>(blockMem[iBlock]), &memDispl[iBlock]);
+    }
+  MPI_Datatype fileType;
+  MPI_Datatype memType;
+  MPI_Type_create_hindexed(numBlock, len.data(), fileDispl.data(), MPI_BYTE,
+                           &fileType);
+  MPI_Type_commit(&fileType);
+  MPI_Type_create_hindexed(numBlock, len.data(), memDispl.data(), MPI_BYTE,
+                           &memType);
+  MPI_Type_commit(&memType);
+  MPI_File_set_view(fh, 0, MPI_BYTE, fileType, "native", MPI_INFO_NULL);
+  if (MPI_File_write_all(fh, MPI_BOTTOM, 1, memType, MPI_STATUS_IGNORE) !=
+      MPI_SUCCESS)
+    {
+      status = -1;
+    }
+  MPI_Type_free(&memType);
+  MPI_Type_free(&fileType);
+  if (MPI_File_close(&fh) != MPI_SUCCESS)
+    {
+      status = -1;
+    }
+  MPI_Allreduce(MPI_IN_PLACE, &status, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+#else
+  const int fd = ::open(a_fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                        0644);
+  if (fd < 0)
+    {
+      std::cout << "EE Failed to open checkpoint " << a_fileName
+                << " for writing: " << std::strerror(errno) << '!'
+                << std::endl;
+      return -1;
+    }
+  if (::ftruncate(fd, fileBytes) ||
+      pwriteAll(fd, index.data(), index.size(), 0))
+    {
+      status = -1;
+    }
+  for (int iBlock = 0; iBlock != numBlock && status == 0; ++iBlock)
+    {
+      status = pwriteAll(fd, blockMem[iBlock], blockLen[iBlock],
+                         blockOffset[iBlock]);
+    }
+  if (status)
+    {
+      std::cout << "EE Failed to write checkpoint " << a_fileName << ": "
+                << std::strerror(errno) << '!' << std::endl;
+    }
+  if (::close(fd))
+    {
+      status = -1;
+    }
+#endif
+  return status;
+}
+
+
+/*******************************************************************************
+ *
+ * Class CheckpointReader: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Constructor (maps the file and reads the index)
+/** Use ok() to see if the file was read successfully.  Errors are
+ *  reported to std::cout.
+ *  \param[in]  a_fileName
+ *                      Name of the file
+ *//*-----------------------------------------------------------------*/
+
+CheckpointReader::CheckpointReader(const std::string& a_fileName)
+  :
+  m_fileName(a_fileName),
+  m_map(nullptr),
+  m_mapBytes(0)
+{
+  std::memset(&m_header, 0, sizeof(CheckpointFormat::FileHeader));
+  const auto fail =
+    [this]
+    (const char *const a_msg)
+    {
+      std::cout << "EE Checkpoint " << m_fileName << ": " << a_msg << '!'
+                << std::endl;
+      if (m_map != nullptr)
+        {
+          ::munmap(m_map, m_mapBytes);
+          m_map = nullptr;
+        }
+    };
+
+//--Map the file
+
+  const int fd = ::open(a_fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+    {
+      fail(std::strerror(errno));
+      return;
+    }
+  struct stat fileStat;
+  if (::fstat(fd, &fileStat) ||
+      fileStat.st_size < (off_t)sizeof(CheckpointFormat::FileHeader))
+    {
+      ::close(fd);
+      fail("file is too small");
+      return;
+    }
+  m_mapBytes = fileStat.st_size;
+  // Private mapping so aliased fabs can be modified without changing the
+  // file.  The mapping remains valid after the file is closed.
+  void *const map = ::mmap(nullptr, m_mapBytes, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED)
+    {
+      fail(std::strerror(errno));
+      return;
+    }
+  m_map = static_cast<char*>(map);
+
+//--Read the index
+
+  std::memcpy(&m_header, m_map, sizeof(CheckpointFormat::FileHeader));
+  if (std::memcmp(m_header.m_magic, CheckpointFormat::s_magic, 8) != 0)
+    {
+      fail("not a checkpoint file");
+      return;
+    }
+  if (m_header.m_version != CheckpointFormat::s_version)
+    {
+      fail("unsupported version");
+      return;
+    }
+  if (m_header.m_spaceDim != g_SpaceDim)
+    {
+      fail("different number of space dimensions");
+      return;
+    }
+  if (m_header.m_numBox < 0 || m_header.m_numIntAttribute < 0 ||
+      m_header.m_numRealAttribute < 0 || m_header.m_numData < 0 ||
+      CheckpointFormat::indexBytes(m_header) > (int64_t)m_mapBytes)
+    {
+      fail("index is corrupt");
+      return;
+    }
+  const char* p = m_map + sizeof(CheckpointFormat::FileHeader);
+  m_boxProc.resize(m_header.m_numBox);
+  for (int &proc : m_boxProc)
+    {
+      int64_t value;
+      std::memcpy(&value, p, sizeof(int64_t));
+      p += sizeof(int64_t);
+      proc = value;
+    }
+  m_intAttribute.resize(m_header.m_numIntAttribute);
+  for (long long &attribute : m_intAttribute)
+    {
+      int64_t value;
+      std::memcpy(&value, p, sizeof(int64_t));
+      p += sizeof(int64_t);
+      attribute = value;
+    }
+  m_realAttribute.resize(m_header.m_numRealAttribute);
+  for (double &attribute : m_realAttribute)
+    {
+      std::memcpy(&attribute, p, sizeof(double));
+      p += sizeof(double);
+    }
+  m_data.resize(m_header.m_numData);
+  for (CheckpointFormat::DataHeader& desc : m_data)
+    {
+      std::memcpy(&desc, p, sizeof(CheckpointFormat::DataHeader));
+      p += sizeof(CheckpointFormat::DataHeader);
+      if (desc.m_offset % CheckpointFormat::s_alignment != 0 ||
+          desc.m_blockBytes > desc.m_blockStride ||
+          desc.m_offset + m_header.m_numBox*desc.m_blockStride >
+          (int64_t)m_mapBytes)
+        {
+          fail("data is truncated or corrupt");
+          return;
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Destructor (unmaps the file)
+/** Fabs aliased to the file are no longer valid
+ *//*-----------------------------------------------------------------*/
+
+CheckpointReader::~CheckpointReader()
+{
+  if (m_map != nullptr)
+    {
+      ::munmap(m_map, m_mapBytes);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Define the layout that was checkpointed
+/** If the number of processes is the same as when the file was
+ *  written, boxes are assigned to the same processes.  Otherwise they
+ *  are distributed with the default strategy.
+ *  \param[out] a_dbl   Layout
+ *//*-----------------------------------------------------------------*/
+
+void
+CheckpointReader::defineLayout(DisjointBoxLayout& a_dbl) const
+{
+  CH_assert(ok());
+  const Box domain(IntVect(D_DECL(m_header.m_domainLo[0],
+                                  m_header.m_domainLo[1],
+                                  m_header.m_domainLo[2])),
+                   IntVect(D_DECL(m_header.m_domainHi[0],
+                                  m_header.m_domainHi[1],
+                                  m_header.m_domainHi[2])));
+  const IntVect boxSize(D_DECL(m_header.m_boxSize[0],
+                               m_header.m_boxSize[1],
+                               m_header.m_boxSize[2]));
+  if (m_header.m_numProc == DisjointBoxLayout::numProc())
+    {
+      a_dbl.define(domain, boxSize, m_boxProc);
+    }
+  else
+    {
+      a_dbl.define(domain, boxSize);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Check that data can be read on a layout
+/** \param[in]  a_idxData
+ *                      Index of the LevelData
+ *  \param[in]  a_elemSize
+ *                      Bytes in one element of the destination
+ *  \param[in]  a_dbl   Layout to read on
+ *  \return             0 The data can be read
+ *                     -1 Error
+ *//*-----------------------------------------------------------------*/
+
+int
+CheckpointReader::checkData(const int                a_idxData,
+                            const int64_t            a_elemSize,
+                            const DisjointBoxLayout& a_dbl) const
+{
+  const auto fail =
+    [this]
+    (const char *const a_msg)
+    {
+      std::cout << "EE Checkpoint " << m_fileName << ": " << a_msg << '!'
+                << std::endl;
+      return -1;
+    };
+  if (!ok())
+    {
+      return fail("file was not read");
+    }
+  if (a_idxData < 0 || a_idxData >= numData())
+    {
+      return fail("no such LevelData");
+    }
+  if (m_data[a_idxData].m_elemSize != a_elemSize)
+    {
+      return fail("different type of element");
+    }
+  bool sameLayout = (a_dbl.size() == m_header.m_numBox);
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      sameLayout = sameLayout &&
+        a_dbl.problemDomain().loVect(dir) == m_header.m_domainLo[dir] &&
+        a_dbl.problemDomain().hiVect(dir) == m_header.m_domainHi[dir] &&
+        (a_dbl.size() == 0 ||
+         a_dbl.getLinear(0).box.dimensions()[dir] == m_header.m_boxSize[dir]);
+    }
+  if (!sameLayout)
+    {
+      return fail("layout has different boxes");
+    }
+  return 0;
+}
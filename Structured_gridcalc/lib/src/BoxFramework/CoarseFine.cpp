@@ -0,0 +1,393 @@
+
+/******************************************************************************/
+/**
+ * \file CoarseFine.cpp
+ *
+ * \brief Non-inline definitions for classes in CoarseFine.H
+ *
+ *//*+*************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+
+#include "BaseFabMacros.H"
+#include "CoarseFine.H"
+#include "LayoutIterator.H"
+#include "TimerRegistry.H"
+
+
+/*==============================================================================
+ * Local helpers
+ *============================================================================*/
+
+namespace
+{
+
+/// Coarse index of a fine index (rounding towards negative infinity)
+inline int
+coarsenIndex(const int a_i, const int a_ratio)
+{
+  return (a_i >= 0) ? a_i/a_ratio : -((a_ratio - 1 - a_i)/a_ratio);
+}
+
+/// Monotonized central limited slope
+inline Real
+limitedSlope(const Real a_dl, const Real a_dr)
+{
+  if (a_dl*a_dr <= (Real)0) return (Real)0;
+  const Real mag = std::min(std::min((Real)2*std::fabs(a_dl),
+                                     (Real)2*std::fabs(a_dr)),
+                            (Real)0.5*std::fabs(a_dl + a_dr));
+  return (a_dl > (Real)0) ? mag : -mag;
+}
+
+}  // anonymous namespace
+
+
+/*******************************************************************************
+ *
+ * Class CoarseFine: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Default constructor
+/*--------------------------------------------------------------------*/
+
+CoarseFine::CoarseFine()
+  :
+  m_ratio(0),
+  m_ncomp(0),
+  m_fnGhost(0),
+  m_cfGhost(0)
+{
+}
+
+/*--------------------------------------------------------------------*/
+//  Constructor
+/** \param[in]  a_crDBL Layout of the coarse level
+ *  \param[in]  a_fnDBL Layout of the fine level.  The size of the
+ *                      boxes must be a multiple of a_ratio.
+ *  \param[in]  a_ratio Refinement ratio
+ *  \param[in]  a_ncomp Number of components
+ *  \param[in]  a_fnGhost
+ *                      Ghost cells of the fine data
+ *  \param[in]  a_periodic
+ *                      Which directions are periodic (default none)
+ *//*-----------------------------------------------------------------*/
+
+CoarseFine::CoarseFine(const DisjointBoxLayout& a_crDBL,
+                       const DisjointBoxLayout& a_fnDBL,
+                       const int                a_ratio,
+                       const int                a_ncomp,
+                       const int                a_fnGhost,
+                       const unsigned           a_periodic)
+{
+  define(a_crDBL, a_fnDBL, a_ratio, a_ncomp, a_fnGhost, a_periodic);
+}
+
+/*--------------------------------------------------------------------*/
+//  Weak construction
+/** \param[in]  a_crDBL Layout of the coarse level
+ *  \param[in]  a_fnDBL Layout of the fine level.  The size of the
+ *                      boxes must be a multiple of a_ratio.
+ *  \param[in]  a_ratio Refinement ratio
+ *  \param[in]  a_ncomp Number of components
+ *  \param[in]  a_fnGhost
+ *                      Ghost cells of the fine data
+ *  \param[in]  a_periodic
+ *                      Which directions are periodic (default none)
+ *//*-----------------------------------------------------------------*/
+
+void
+CoarseFine::define(const DisjointBoxLayout& a_crDBL,
+                   const DisjointBoxLayout& a_fnDBL,
+                   const int                a_ratio,
+                   const int                a_ncomp,
+                   const int                a_fnGhost,
+                   const unsigned           a_periodic)
+{
+  TIMED_REGION(timerDefine, "CoarseFine::define");
+  CH_assert(a_ratio > 0);
+  CH_assert(Box(a_crDBL.problemDomain()).refine(a_ratio) ==
+            a_fnDBL.problemDomain());
+  m_ratio = a_ratio;
+  m_ncomp = a_ncomp;
+  m_fnGhost = a_fnGhost;
+  m_cfGhost = nestingBuffer(a_ratio, a_fnGhost);
+  m_crAvail = a_crDBL.problemDomain();
+  m_fnAvail = a_fnDBL.problemDomain();
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      if (a_periodic & (1<<dir))
+        {
+          m_crAvail.grow(m_cfGhost, dir);
+          m_fnAvail.grow(m_fnGhost, dir);
+        }
+    }
+  m_cfDBL.defineCoarsened(a_fnDBL, a_ratio);
+  m_toCoarsened.define(a_crDBL, m_cfDBL, m_cfGhost, a_periodic);
+  m_fromCoarsened.define(m_cfDBL, a_crDBL);
+  m_cfData.define(m_cfDBL, a_ncomp, m_cfGhost);
+  m_cfNew.define(m_cfDBL, a_ncomp, m_cfGhost);
+  // Cells not covered by the coarse level are never used but should hold
+  // valid numbers
+  m_cfData.setVal((Real)0);
+  m_cfNew.setVal((Real)0);
+}
+
+/*--------------------------------------------------------------------*/
+//  Average fine data onto the coarse cells it covers
+/** \param[out] a_crData
+ *                      Coarse data.  Valid cells covered by the fine
+ *                      level are replaced.
+ *  \param[in]  a_fnData
+ *                      Fine data on the layout used to define this
+ *                      object
+ *//*-----------------------------------------------------------------*/
+
+void
+CoarseFine::averageDown(LevelData<BaseFab<Real> >&       a_crData,
+                        const LevelData<BaseFab<Real> >& a_fnData)
+{
+  TIMED_REGION(timerAverage, "CoarseFine::averageDown");
+  CH_assert(a_fnData.size() == m_cfDBL.localSize());
+  CH_assert(a_fnData.ncomp() == m_ncomp && a_crData.ncomp() == m_ncomp);
+  const int numLocalBox = m_cfDBL.localSize();
+#pragma omp parallel for schedule(dynamic)
+  for (int iBox = 0; iBox < numLocalBox; ++iBox)
+    {
+      const BoxIndex bidx = m_cfDBL.dataIndex(iBox);
+      averageBox(m_cfData[bidx], m_cfDBL[bidx], a_fnData[bidx], m_ratio);
+    }
+  a_crData.copy(m_cfData, m_fromCoarsened, 0, 0, m_ncomp);
+}
+
+/*--------------------------------------------------------------------*/
+//  Interpolate the ghost cells of fine data from coarse data
+/** The coarse data is interpolated in time as
+ *  (1 - a_alpha)*a_crOld + a_alpha*a_crNew before interpolating in
+ *  space.  Only the ghost cells of each fine box are modified.
+ *  \param[in]  a_fnData
+ *                      Fine data on the layout used to define this
+ *                      object
+ *  \param[in]  a_crOld Coarse data at the old time
+ *  \param[in]  a_crNew Coarse data at the new time (on the same
+ *                      layout as a_crOld)
+ *  \param[in]  a_alpha Fraction of the coarse time step (not used if
+ *                      0 or 1)
+ *//*-----------------------------------------------------------------*/
+
+void
+CoarseFine::interpolateGhosts(LevelData<BaseFab<Real> >&       a_fnData,
+                              const LevelData<BaseFab<Real> >& a_crOld,
+                              const LevelData<BaseFab<Real> >& a_crNew,
+                              const Real                       a_alpha)
+{
+  TIMED_REGION(timerInterp, "CoarseFine::interpolateGhosts");
+  CH_assert(a_fnData.size() == m_cfDBL.localSize());
+  CH_assert(a_fnData.nghost() >= m_fnGhost);
+  if (m_fnGhost == 0) return;
+
+//--Coarse data at the time of the fine data
+
+  if (a_alpha <= (Real)0)
+    {
+      m_cfData.copy(a_crOld, m_toCoarsened, 0, 0, m_ncomp);
+    }
+  else if (a_alpha >= (Real)1)
+    {
+      m_cfData.copy(a_crNew, m_toCoarsened, 0, 0, m_ncomp);
+    }
+  else
+    {
+      m_cfData.copy(a_crOld, m_toCoarsened, 0, 0, m_ncomp);
+      m_cfNew.copy(a_crNew, m_toCoarsened, 0, 0, m_ncomp);
+      for (DataIterator dit(m_cfDBL); dit.ok(); ++dit)
+        {
+          BaseFab<Real>& cfFab = m_cfData[dit];
+          const BaseFab<Real>& cfNewFab = m_cfNew[dit];
+          Real *const data = cfFab.dataPtr();
+          const Real *const dataNew = cfNewFab.dataPtr();
+          const int size = cfFab.size();
+#pragma omp parallel for simd
+          for (int i = 0; i < size; ++i)
+            {
+              data[i] = ((Real)1 - a_alpha)*data[i] + a_alpha*dataNew[i];
+            }
+        }
+    }
+
+//--Interpolate into the ghost cells on each side of the fine boxes.  The
+//--shell is split into slabs that do not overlap.
+
+  const int numLocalBox = m_cfDBL.localSize();
+#pragma omp parallel for schedule(dynamic)
+  for (int iBox = 0; iBox < numLocalBox; ++iBox)
+    {
+      const BoxIndex bidx = m_cfDBL.dataIndex(iBox);
+      BaseFab<Real>& fnFab = a_fnData[bidx];
+      const Box& fnBox = a_fnData.disjointBoxLayout()[bidx];
+      Box outer(fnBox);
+      outer.grow(m_fnGhost);
+      outer &= m_fnAvail;
+      for (int dir = 0; dir != g_SpaceDim; ++dir)
+        {
+          Box slabLo(outer);
+          slabLo.hiVect(dir) = fnBox.loVect(dir) - 1;
+          if (!slabLo.isEmpty())
+            {
+              interpolateBox(fnFab, slabLo, m_cfData[bidx], m_crAvail,
+                             m_ratio);
+            }
+          Box slabHi(outer);
+          slabHi.loVect(dir) = fnBox.hiVect(dir) + 1;
+          if (!slabHi.isEmpty())
+            {
+              interpolateBox(fnFab, slabHi, m_cfData[bidx], m_crAvail,
+                             m_ratio);
+            }
+          outer.loVect(dir) = fnBox.loVect(dir);
+          outer.hiVect(dir) = fnBox.hiVect(dir);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Interpolate the valid cells of fine data from coarse data
+/** \param[in]  a_fnData
+ *                      Fine data on the layout used to define this
+ *                      object.  Ghost cells are not modified.
+ *  \param[in]  a_crData
+ *                      Coarse data
+ *//*-----------------------------------------------------------------*/
+
+void
+CoarseFine::interpolate(LevelData<BaseFab<Real> >&       a_fnData,
+                        const LevelData<BaseFab<Real> >& a_crData)
+{
+  TIMED_REGION(timerInterp, "CoarseFine::interpolate");
+  CH_assert(a_fnData.size() == m_cfDBL.localSize());
+  m_cfData.copy(a_crData, m_toCoarsened, 0, 0, m_ncomp);
+  const int numLocalBox = m_cfDBL.localSize();
+#pragma omp parallel for schedule(dynamic)
+  for (int iBox = 0; iBox < numLocalBox; ++iBox)
+    {
+      const BoxIndex bidx = m_cfDBL.dataIndex(iBox);
+      interpolateBox(a_fnData[bidx], a_fnData.disjointBoxLayout()[bidx],
+                     m_cfData[bidx], m_crAvail, m_ratio);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Interpolate a region of a fine BaseFab from a coarse BaseFab
+/** Piecewise linear with monotonized central slopes.  Where only one
+ *  neighbour of a coarse cell is available, the one-sided difference
+ *  is used.
+ *  \param[out] a_fnFab Fine data
+ *  \param[in]  a_fnRegion
+ *                      Fine cells to interpolate
+ *  \param[in]  a_crFab Coarse data which must contain the coarse cells
+ *                      under a_fnRegion and their neighbours in
+ *                      a_crAvail
+ *  \param[in]  a_crAvail
+ *                      Coarse cells that may be used for slopes
+ *  \param[in]  a_ratio Refinement ratio
+ *//*-----------------------------------------------------------------*/
+
+void
+CoarseFine::interpolateBox(BaseFab<Real>&       a_fnFab,
+                           const Box&           a_fnRegion,
+                           const BaseFab<Real>& a_crFab,
+                           const Box&           a_crAvail,
+                           const int            a_ratio)
+{
+  const int ncomp = a_fnFab.ncomp();
+  CH_assert(a_crFab.ncomp() == ncomp);
+  const Real invRatio = (Real)1/a_ratio;
+  MD_BOXLOOP(a_fnRegion, i)
+    {
+      const IntVect fnIV(D_DECL(i0, i1, i2));
+      IntVect crIV;
+      // Offset of the fine cell center from the coarse cell center in
+      // units of the coarse cell width
+      Real offset[g_SpaceDim];
+      for (int dir = 0; dir != g_SpaceDim; ++dir)
+        {
+          crIV[dir] = coarsenIndex(fnIV[dir], a_ratio);
+          offset[dir] = ((fnIV[dir] - crIV[dir]*a_ratio) + (Real)0.5)*invRatio
+            - (Real)0.5;
+        }
+      CH_assert(a_crFab.box().contains(crIV));
+      for (int iComp = 0; iComp != ncomp; ++iComp)
+        {
+          const Real u = a_crFab(crIV, iComp);
+          Real val = u;
+          for (int dir = 0; dir != g_SpaceDim; ++dir)
+            {
+              IntVect ivLo(crIV);
+              --ivLo[dir];
+              IntVect ivHi(crIV);
+              ++ivHi[dir];
+              const bool hasLo = a_crAvail.contains(ivLo);
+              const bool hasHi = a_crAvail.contains(ivHi);
+              Real slope = (Real)0;
+              if (hasLo && hasHi)
+                {
+                  slope = limitedSlope(u - a_crFab(ivLo, iComp),
+                                       a_crFab(ivHi, iComp) - u);
+                }
+              else if (hasLo)
+                {
+                  slope = u - a_crFab(ivLo, iComp);
+                }
+              else if (hasHi)
+                {
+                  slope = a_crFab(ivHi, iComp) - u;
+                }
+              val += slope*offset[dir];
+            }
+          a_fnFab(fnIV, iComp) = val;
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Average a coarse region of a coarse BaseFab from a fine BaseFab
+/** \param[out] a_crFab Coarse data
+ *  \param[in]  a_crRegion
+ *                      Coarse cells to average into
+ *  \param[in]  a_fnFab Fine data which must contain the refinement of
+ *                      a_crRegion
+ *  \param[in]  a_ratio Refinement ratio
+ *//*-----------------------------------------------------------------*/
+
+void
+CoarseFine::averageBox(BaseFab<Real>&       a_crFab,
+                       const Box&           a_crRegion,
+                       const BaseFab<Real>& a_fnFab,
+                       const int            a_ratio)
+{
+  const int ncomp = a_crFab.ncomp();
+  CH_assert(a_fnFab.ncomp() == ncomp);
+  CH_assert(a_fnFab.box().contains(Box(a_crRegion).refine(a_ratio)));
+  Real scale = (Real)1;
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      scale /= a_ratio;
+    }
+  MD_BOXLOOP(a_crRegion, i)
+    {
+      const IntVect crIV(D_DECL(i0, i1, i2));
+      const Box fnCells = Box(crIV, crIV).refine(a_ratio);
+      for (int iComp = 0; iComp != ncomp; ++iComp)
+        {
+          Real sum = (Real)0;
+          MD_BOXLOOP(fnCells, j)
+            {
+              sum += a_fnFab(IntVect(D_DECL(j0, j1, j2)), iComp);
+            }
+          a_crFab(crIV, iComp) = scale*sum;
+        }
+    }
+}
@@ -0,0 +1,610 @@
+
+/******************************************************************************/
+/**
+ * \file Copier.cpp
+ *
+ * \brief Non-inline definitions for classes in Copier.H
+ *
+ *//*+*************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <utility>
+#ifdef USE_MPI
+#include <zlib.h>
+#endif
+
+#include "BaseFabMacros.H"
+#include "Copier.H"
+
+
+/*******************************************************************************
+ *
+ * Class Copier: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Aggregate messages so there is one to and from each process
+/** Instead of a message for every remote motion item, all motion items
+ *  with the same remote process share one message in each direction.
+ *  Each motion item packs into and unpacks from its own slice of the
+ *  message buffers for the process so only the number of requests
+ *  changes for the caller: there are then 2 requests per remote
+ *  process and numRequestItem gives the number of motion items they
+ *  carry.  With many boxes per process, this replaces many small
+ *  (latency-bound) messages, e.g., for edges and corners, with a few
+ *  large ones.
+ *
+ *  Must be called before definePersistent (else the requests are
+ *  rebuilt) and defineDevice, and not during an exchange.
+ *  Aggregation is reset if the copier is redefined.  Does nothing
+ *  without MPI.
+ *//*-----------------------------------------------------------------*/
+
+void
+Copier::defineAggregate()
+{
+#ifdef USE_MPI
+  if (m_aggregate) return;
+  CH_assert(!m_device);
+  CH_assert(!m_progressJob);
+  const bool persistent = m_persistent;
+  freePersistent();
+
+  // Remote motion items for each process, ordered by process
+  std::map<int, std::vector<int> > midxForProc;
+  const int nMotionItem = numMotionItem();
+  for (int i = 0; i != nMotionItem; ++i)
+    {
+      const Motion2Way& motion = m_motionItem[i];
+      if (motion.needsMessage())
+        {
+          midxForProc[motion.m_remoteProcID].push_back(i);
+        }
+    }
+
+  m_rankMessage.clear();
+  m_rankMessage.reserve(midxForProc.size());
+  m_midxForReq.clear();
+  m_midxForReq.reserve(m_numReq/2);
+  m_midxForReqBegin.assign(1, 0);
+  std::vector<int> midxOrdered;
+  std::vector<int> recvOffset(nMotionItem);
+  std::vector<int> sendOffset(nMotionItem);
+  for (const auto& procItems : midxForProc)
+    {
+      const std::vector<int>& midxs = procItems.second;
+      midxOrdered = midxs;
+      m_rankMessage.emplace_back();
+      RankMessage& msg = m_rankMessage.back();
+      msg.m_procID = procItems.first;
+
+      // The remote process orders the same motion items by the same tags.
+      // Irregular layouts may have equal tags which stay in the order
+      // both processes found them.
+      std::stable_sort(midxOrdered.begin(), midxOrdered.end(),
+                [this](const int a_i, const int a_j)
+                {
+                  return m_motionItem[a_i].m_tagRecv <
+                    m_motionItem[a_j].m_tagRecv;
+                });
+      msg.m_recvBytes = 0;
+      for (const int i : midxOrdered)
+        {
+          recvOffset[i] = msg.m_recvBytes;
+          msg.m_recvBytes += m_motionItem[i].m_recvBytes;
+        }
+      std::stable_sort(midxOrdered.begin(), midxOrdered.end(),
+                [this](const int a_i, const int a_j)
+                {
+                  return m_motionItem[a_i].m_tagSend <
+                    m_motionItem[a_j].m_tagSend;
+                });
+      msg.m_sendBytes = 0;
+      for (const int i : midxOrdered)
+        {
+          sendOffset[i] = msg.m_sendBytes;
+          msg.m_sendBytes += m_motionItem[i].m_sendBytes;
+        }
+
+      msg.m_recvBuffer.reset(Motion2Way::allocateBuffer(msg.m_recvBytes));
+      msg.m_sendBuffer.reset(Motion2Way::allocateBuffer(msg.m_sendBytes));
+      char *const recvBuffer = static_cast<char*>(msg.m_recvBuffer.get());
+      char *const sendBuffer = static_cast<char*>(msg.m_sendBuffer.get());
+      // Keep the motion items in their original order within the message
+      for (const int i : midxs)
+        {
+          m_motionItem[i].shareBuffers(recvBuffer + recvOffset[i],
+                                       sendBuffer + sendOffset[i]);
+          m_midxForReq.push_back(i);
+        }
+      m_midxForReqBegin.push_back(m_midxForReq.size());
+    }
+  m_numReq = 2*m_rankMessage.size();
+  m_mpiRequest.assign(m_numReq, MPI_REQUEST_NULL);
+  m_aggregate = true;
+  allocateCompressed();
+  if (persistent)
+    {
+      definePersistent();
+    }
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+//  Copy from boxes on processes of the same node through shared memory
+/** Motion items with the remote box on another process of the same
+ *  node (see DisjointBoxLayout::nodeComm) no longer send messages.
+ *  Instead, LevelData::exchangeBegin copies directly from the remote
+ *  box into the ghost cells.  The copier can then only be used for
+ *  LevelData allocated with LevelData::allocateShared.  Messages to
+ *  other nodes are unchanged (and remain aggregated and persistent if
+ *  they were).
+ *
+ *  Must be called before defineDevice and not during an exchange.
+ *  This is reset if the copier is redefined.  Does nothing without
+ *  MPI.
+ *//*-----------------------------------------------------------------*/
+
+void
+Copier::defineNodeShared()
+{
+#ifdef USE_MPI
+  if (m_nodeShared) return;
+  CH_assert(!m_device);
+  CH_assert(!m_progressJob);
+  const bool persistent = m_persistent;
+  freePersistent();
+  for (Motion2Way& motion : m_motionItem)
+    {
+      if (!motion.isLocal() &&
+          DisjointBoxLayout::nodeRank(motion.m_remoteProcID) >= 0)
+        {
+          motion.m_nodeShared = true;
+          motion.m_recvBuffer.reset();
+          motion.m_sendBuffer.reset();
+        }
+    }
+  m_nodeShared = true;
+  if (m_aggregate)
+    {
+      m_aggregate = false;
+      m_rankMessage.clear();
+      defineAggregate();
+    }
+  else
+    {
+      defineRequests();
+    }
+  if (persistent)
+    {
+      definePersistent();
+    }
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+//  Only send the components needed by the neighbor in each direction
+/** By default, every motion item copies all components in
+ *  [startComp, endComp).  Often a box only reads some components from
+ *  the ghost cells on each side (e.g., lattice-Boltzmann streaming
+ *  only pulls the distributions moving from the neighbor into the
+ *  box).  A motion item then sends the components given by a_compFlags
+ *  for its send direction and receives (or copies locally) those for
+ *  its receive direction.  The flagged components are packed
+ *  contiguously, messages are sized for them, and motion items without
+ *  components are removed.  a_compFlags must be the same on all
+ *  processes.
+ *
+ *  Only components below 32 can be deselected, others are always
+ *  copied.  Aggregation, persistence, and node sharing are kept.  Must
+ *  be called before defineDevice and not during an exchange.  The
+ *  flags are reset if the copier is redefined.
+ *  \param[in]  a_compFlags
+ *                      Components to send in a direction to a
+ *                      neighbor (see CompFlagsFunction)
+ *//*-----------------------------------------------------------------*/
+
+void
+Copier::defineCompFlags(const CompFlagsFunction& a_compFlags)
+{
+  CH_assert(!m_device);
+#ifdef USE_MPI
+  CH_assert(!m_progressJob);
+#endif
+  const bool persistent = m_persistent;
+  freePersistent();
+  const int bytesPerComp = m_bytesPerCell/numComp();
+  const auto numFlagged =
+    [this]
+    (const unsigned a_flags)
+    {
+      int num = 0;
+      for (int ic = m_startComp; ic != m_endComp; ++ic)
+        {
+          if ((ic >= (int)(8*sizeof(unsigned))) || (a_flags & (1u << ic)))
+            {
+              ++num;
+            }
+        }
+      return num;
+    };
+  std::vector<Motion2Way> motionItem;
+  motionItem.reserve(m_motionItem.size());
+  for (Motion2Way& motion : m_motionItem)
+    {
+      const unsigned sendFlags = a_compFlags(motion.sendDir());
+      const unsigned recvFlags = a_compFlags(motion.recvDir());
+      const int numSend = numFlagged(sendFlags);
+      const int numRecv = numFlagged(recvFlags);
+      // The remote process has the motion item in the opposite direction
+      // and removes it under the same condition
+      if (numRecv == 0 && (motion.isLocal() || numSend == 0)) continue;
+      motion.m_compSendFlags = sendFlags;
+      motion.m_compRecvFlags = recvFlags;
+      motion.m_sendBytes = bytesPerComp*numSend*motion.m_regionSend.size();
+      motion.m_recvBytes = bytesPerComp*numRecv*motion.m_regionRecv.size();
+      motionItem.push_back(std::move(motion));
+    }
+  m_motionItem = std::move(motionItem);
+#ifdef USE_MPI
+  if (m_aggregate)
+    {
+      // The slices of the messages have changed
+      m_aggregate = false;
+      m_rankMessage.clear();
+      defineAggregate();
+    }
+  else
+    {
+      defineRequests();
+    }
+#endif
+  if (persistent)
+    {
+      definePersistent();
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Compress large aggregated messages
+/** Aggregated messages of at least a_minBytes are compressed (with
+ *  zlib, lossless) before sending and decompressed before unpacking.
+ *  This trades computation for bandwidth so it only pays for large
+ *  messages that compress well, e.g., of uniform or smooth data. A
+ *  message that does not compress is sent uncompressed.  Both
+ *  processes decide from the uncompressed size so they agree.
+ *  Messages are aggregated first if they are not already.  Since the
+ *  size of a compressed message varies, those messages are posted for
+ *  each exchange even if the requests are persistent.
+ *
+ *  Must be called before defineDevice (and is not available with
+ *  USE_CUDAAWAREMPI) and not during an exchange.  Compression is reset
+ *  if the copier is redefined.  Does nothing without MPI.
+ *  \param[in]  a_minBytes
+ *                      Smallest message to compress (> 0)
+ *//*-----------------------------------------------------------------*/
+
+void
+Copier::defineCompression(const int a_minBytes)
+{
+#ifdef USE_MPI
+  CH_assert(a_minBytes > 0);
+  CH_assert(!m_device);
+  CH_assert(!m_progressJob);
+  const bool persistent = m_persistent;
+  freePersistent();
+  m_compressMinBytes = a_minBytes;
+  if (m_aggregate)
+    {
+      allocateCompressed();
+    }
+  else
+    {
+      defineAggregate();
+    }
+  if (persistent)
+    {
+      definePersistent();
+    }
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+//  Add the motion items of an exchange on an irregular layout
+/** The boxes (and periodic images) overlapping each local box grown by
+ *  the ghost cells are found with DisjointBoxLayout::overlaps, so
+ *  defining the copier is linear in the number of local boxes.  The
+ *  direction to a neighbor has a component of 0 where the boxes
+ *  overlap in that direction.  A box may then have several neighbors
+ *  in the same direction, giving motion items with equal tags.  These
+ *  are ordered by the global index of the remote box so both processes
+ *  post their messages in the same order (MPI does not let messages
+ *  with the same tag overtake each other).
+ *  \param[in]  a_disjointBoxLayout
+ *                      An irregular layout
+ *  \param[in]  a_numGhost
+ *                      Number of ghosts to copy
+ *  \param[in]  a_periodic
+ *                      Which directions are periodic
+ *  \param[in]  a_trim  Trimmed sections are not included as neighbors
+ *//*-----------------------------------------------------------------*/
+
+void
+Copier::defineIrregularMotion(const DisjointBoxLayout& a_disjointBoxLayout,
+                              const int                a_numGhost,
+                              const unsigned           a_periodic,
+                              const unsigned           a_trim)
+{
+  const Box& domain = a_disjointBoxLayout.problemDomain();
+  const IntVect domainSize = domain.dimensions();
+  const unsigned trim = a_trim | TrimCenter;
+  std::vector<int> idxOverlap;
+  std::vector<std::pair<int, IntVect> > nbrs;
+  for (DataIterator dit(a_disjointBoxLayout); dit.ok(); ++dit)
+    {
+      const Box& localBox = a_disjointBoxLayout[dit];
+      Box localGrown(localBox);
+      localGrown.grow(a_numGhost);
+
+      // Shifts to the periodic images reached by the ghost cells
+      IntVect shiftLo(IntVect::Zero);
+      IntVect shiftHi(IntVect::Zero);
+      for (int dir = 0; dir != g_SpaceDim; ++dir)
+        {
+          if (a_periodic & (1<<dir))
+            {
+              if (localGrown.loVect(dir) < domain.loVect(dir)) shiftLo[dir] = -1;
+              if (localGrown.hiVect(dir) > domain.hiVect(dir)) shiftHi[dir] = 1;
+            }
+        }
+      const Box shiftBox(shiftLo, shiftHi);
+
+      // Find the neighbors (the remote box shifted to its image)
+      nbrs.clear();
+      MD_BOXLOOP(shiftBox, i)
+        {
+          const IntVect shift = IntVect(D_DECL(i0, i1, i2))*domainSize;
+          Box region(localGrown);
+          region.shift(-shift);
+          a_disjointBoxLayout.overlaps(region, idxOverlap);
+          for (const int idx : idxOverlap)
+            {
+              if (idx != (*dit).globalIndex() || shift != IntVect::Zero)
+                {
+                  nbrs.emplace_back(idx, shift);
+                }
+            }
+        }
+      std::stable_sort(nbrs.begin(), nbrs.end(),
+                       [](const std::pair<int, IntVect>& a_x,
+                          const std::pair<int, IntVect>& a_y)
+                       {
+                         return a_x.first < a_y.first;
+                       });
+
+      for (const std::pair<int, IntVect>& nbr : nbrs)
+        {
+          const IntVect& shift = nbr.second;
+          Box remoteBox = a_disjointBoxLayout.getLinear(nbr.first).box;
+          remoteBox.shift(shift);
+          IntVect sendDir(IntVect::Zero);
+          for (int dir = 0; dir != g_SpaceDim; ++dir)
+            {
+              if (remoteBox.loVect(dir) > localBox.hiVect(dir))
+                {
+                  sendDir[dir] = 1;
+                }
+              else if (remoteBox.hiVect(dir) < localBox.loVect(dir))
+                {
+                  sendDir[dir] = -1;
+                }
+            }
+          if ((1 << sendDir.norm1()) & trim) continue;
+          Box regionRecv(localGrown);
+          regionRecv &= remoteBox;
+#ifdef USE_MPI
+          remoteBox.grow(a_numGhost);
+          Box regionSend(localBox);
+          regionSend &= remoteBox;
+#else
+          Box regionSend;
+#endif
+          Box regionSendRemote(regionRecv);
+          regionSendRemote.shift(-shift);
+          m_motionItem.emplace_back(
+            m_bytesPerCell,
+            a_disjointBoxLayout,
+            *dit,
+            BoxIndex(nbr.first, a_disjointBoxLayout.localIndex(nbr.first)),
+            regionRecv,
+            regionSend,
+            regionSendRemote,
+            sendDir);
+        }
+    }
+}
+
+#ifdef USE_MPI
+/*--------------------------------------------------------------------*/
+//  Assign a pair of requests to each motion item that needs messages
+/*--------------------------------------------------------------------*/
+
+void
+Copier::defineRequests()
+{
+  CH_assert(!m_persistent);
+  m_midxForReq.clear();
+  m_midxForReqBegin.assign(1, 0);
+  const int nMotionItem = numMotionItem();
+  for (int i = 0; i != nMotionItem; ++i)
+    {
+      if (m_motionItem[i].needsMessage())
+        {
+          m_midxForReq.push_back(i);
+          m_midxForReqBegin.push_back(m_midxForReq.size());
+        }
+    }
+  m_numReq = 2*m_midxForReq.size();
+  m_mpiRequest.assign(m_numReq, MPI_REQUEST_NULL);
+}
+
+/*--------------------------------------------------------------------*/
+//  Allocate the buffers of compressed messages
+/** A buffer is allocated for each aggregated message of at least
+ *  m_compressMinBytes and is large enough for the header and the
+ *  compressed data in the worst case.
+ *//*-----------------------------------------------------------------*/
+
+void
+Copier::allocateCompressed()
+{
+  for (RankMessage& msg : m_rankMessage)
+    {
+      msg.m_recvCompressed.reset();
+      msg.m_sendCompressed.reset();
+      if (m_compressMinBytes == 0) continue;
+      if (msg.m_recvBytes >= m_compressMinBytes)
+        {
+          msg.m_recvCompressed.reset(Motion2Way::allocateBuffer(
+            s_compressHeader + compressBound(msg.m_recvBytes)));
+        }
+      if (msg.m_sendBytes >= m_compressMinBytes)
+        {
+          msg.m_sendCompressed.reset(Motion2Way::allocateBuffer(
+            s_compressHeader + compressBound(msg.m_sendBytes)));
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Post messages for a pair of requests, compressing large ones
+/** A compressed message is the size of the compressed data (or 0 if
+ *  the data did not compress and is stored as is) followed by the
+ *  data.  Messages that are not compressed are posted (or started if
+ *  persistent) as usual.
+ *  \param[in]  a_idxReq
+ *                      Index of the send request (the receive request
+ *                      follows)
+ *//*-----------------------------------------------------------------*/
+
+void
+Copier::postCompressed(const int a_idxReq)
+{
+  CH_assert(m_aggregate);
+  RankMessage& msg = m_rankMessage[a_idxReq/2];
+  MPI_Request *const sendRequest = m_mpiRequest.data() + a_idxReq;
+  MPI_Request *const recvRequest = sendRequest + 1;
+
+  // Receive first since compressing the send takes time
+  if (msg.m_recvCompressed)
+    {
+      MPI_Irecv(msg.m_recvCompressed.get(),
+                s_compressHeader + (int)compressBound(msg.m_recvBytes),
+                MPI_BYTE, msg.m_procID, s_aggregateTag, MPI_COMM_WORLD,
+                recvRequest);
+    }
+  else if (m_persistent)
+    {
+      MPI_Start(recvRequest);
+    }
+  else
+    {
+      MPI_Irecv(msg.recvBufferMPI(), msg.m_recvBytes, MPI_BYTE, msg.m_procID,
+                s_aggregateTag, MPI_COMM_WORLD, recvRequest);
+    }
+
+  if (msg.m_sendCompressed)
+    {
+      TIMED_REGION(timerCompress, "Copier::compress");
+      char *const packed = static_cast<char*>(msg.m_sendCompressed.get());
+      uLongf packedBytes = compressBound(msg.m_sendBytes);
+      int header = 0;
+      if (compress2(reinterpret_cast<Bytef*>(packed + s_compressHeader),
+                    &packedBytes,
+                    static_cast<const Bytef*>(msg.m_sendBuffer.get()),
+                    msg.m_sendBytes,
+                    Z_BEST_SPEED) == Z_OK &&
+          packedBytes < (uLongf)msg.m_sendBytes)
+        {
+          header = packedBytes;
+        }
+      else
+        {
+          std::memcpy(packed + s_compressHeader, msg.m_sendBuffer.get(),
+                      msg.m_sendBytes);
+          packedBytes = msg.m_sendBytes;
+        }
+      std::memcpy(packed, &header, s_compressHeader);
+      timerCompress.addBytes(msg.m_sendBytes);
+      timerCompress.addCount();
+      MPI_Isend(packed, s_compressHeader + (int)packedBytes, MPI_BYTE,
+                msg.m_procID, s_aggregateTag, MPI_COMM_WORLD, sendRequest);
+    }
+  else if (m_persistent)
+    {
+      MPI_Start(sendRequest);
+    }
+  else
+    {
+      MPI_Isend(msg.sendBufferMPI(), msg.m_sendBytes, MPI_BYTE, msg.m_procID,
+                s_aggregateTag, MPI_COMM_WORLD, sendRequest);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Decompress a received message so it can be unpacked
+/** Call when the receive request has completed and before unpacking
+ *  the motion items it carries.  Does nothing if the message is not
+ *  compressed.
+ *  \param[in]  a_idxReq
+ *                      Index of the receive request
+ *//*-----------------------------------------------------------------*/
+
+void
+Copier::expandMessage(const int a_idxReq)
+{
+  if (m_compressMinBytes == 0) return;
+  CH_assert(a_idxReq & 1);
+  const RankMessage& msg = m_rankMessage[a_idxReq/2];
+  if (!msg.m_recvCompressed) return;
+  TIMED_REGION(timerExpand, "Copier::expand");
+  const char *const packed =
+    static_cast<const char*>(msg.m_recvCompressed.get());
+  int header;
+  std::memcpy(&header, packed, s_compressHeader);
+  if (header == 0)
+    {
+      std::memcpy(msg.m_recvBuffer.get(), packed + s_compressHeader,
+                  msg.m_recvBytes);
+    }
+  else
+    {
+      uLongf bytes = msg.m_recvBytes;
+      if (uncompress(static_cast<Bytef*>(msg.m_recvBuffer.get()),
+                     &bytes,
+                     reinterpret_cast<const Bytef*>(packed + s_compressHeader),
+                     header) != Z_OK ||
+          bytes != (uLongf)msg.m_recvBytes)
+        {
+          std::cout << "Error decompressing message from process "
+                    << msg.m_procID << " on process "
+                    << DisjointBoxLayout::procID() << std::endl;
+          abort();
+        }
+    }
+  timerExpand.addBytes(msg.m_recvBytes);
+  timerExpand.addCount();
+}
+#endif
+
+
+/*******************************************************************************
+ *
+ * Class CopierCache: static member initialization
+ *
+ ******************************************************************************/
+
+std::map<CopierCache::Key, CopierCache::Entry> CopierCache::s_cache;
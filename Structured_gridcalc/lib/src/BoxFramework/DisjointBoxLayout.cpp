@@ -8,6 +8,10 @@
  *//*+*************************************************************************/
 
 #include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+#include <string>
 
 #ifdef USE_MPI
 #include <mpi.h>
@@ -25,6 +29,10 @@
 #include "DisjointBoxLayout.H"
 #include "LayoutIterator.H"
 #include "BaseFab.H"
+#include "Copier.H"
+#include "ExchangeProgress.H"
+#include "Reduction.H"
+#include "TimerRegistry.H"
 
 
 /*******************************************************************************
@@ -35,6 +43,171 @@
 
 int DisjointBoxLayout::s_numProc = 1;
 int DisjointBoxLayout::s_procID = 0;
+DisjointBoxLayout::ThreadSupport DisjointBoxLayout::s_threadSupport =
+  DisjointBoxLayout::ThreadSupport::multiple;
+int DisjointBoxLayout::s_minThreadBoxes = 4096;
+#ifdef USE_MPI
+MPI_Comm DisjointBoxLayout::s_nodeComm = MPI_COMM_NULL;
+std::vector<int> DisjointBoxLayout::s_nodeRank;
+#endif
+std::vector<DisjointBoxLayout::DefinedLayout>
+DisjointBoxLayout::s_definedLayouts;
+std::mutex DisjointBoxLayout::s_definedLayoutsMutex;
+
+
+/*==============================================================================
+ * Local helpers
+ *============================================================================*/
+
+namespace
+{
+
+/*--------------------------------------------------------------------*/
+//  Position along a Morton or Hilbert curve
+/** \param[in]  a_iv    Non-negative coordinates
+ *  \param[in]  a_numBit
+ *                      Bits required for any coordinate
+ *  \param[in]  a_distribution
+ *                      Morton or Hilbert
+ *  \return             Key ordering positions along the curve
+ *//*-----------------------------------------------------------------*/
+
+std::uint64_t
+curveKey(const IntVect&                        a_iv,
+         const int                             a_numBit,
+         const DisjointBoxLayout::Distribution a_distribution)
+{
+  std::uint64_t x[g_SpaceDim] = { D_DECL(std::uint64_t(a_iv[0]),
+                                         std::uint64_t(a_iv[1]),
+                                         std::uint64_t(a_iv[2])) };
+  if (a_distribution == DisjointBoxLayout::Distribution::hilbert &&
+      a_numBit > 0)
+    {
+      // Transform coordinates to the transpose of the Hilbert index
+      // (J. Skilling, AIP Conf. Proc. 707, 2004).  This loop inverts the
+      // reflections and exchanges of the transpose-to-axes mapping,
+      // from the highest bit down
+      for (std::uint64_t q = (std::uint64_t)1 << (a_numBit - 1); q > 1;
+           q >>= 1)
+        {
+          const std::uint64_t p = q - 1;
+          for (int dir = 0; dir != g_SpaceDim; ++dir)
+            {
+              if (x[dir] & q)
+                {
+                  x[0] ^= p;
+                }
+              else
+                {
+                  const std::uint64_t t = (x[0] ^ x[dir]) & p;
+                  x[0] ^= t;
+                  x[dir] ^= t;
+                }
+            }
+        }
+      // Gray encode
+      for (int dir = 1; dir != g_SpaceDim; ++dir)
+        {
+          x[dir] ^= x[dir-1];
+        }
+      std::uint64_t t = 0;
+      for (std::uint64_t q = (std::uint64_t)1 << (a_numBit - 1); q > 1;
+           q >>= 1)
+        {
+          if (x[g_SpaceDim-1] & q) t ^= q - 1;
+        }
+      for (int dir = 0; dir != g_SpaceDim; ++dir)
+        {
+          x[dir] ^= t;
+        }
+    }
+  // Interleave the bits (for Hilbert, the bits of the transpose)
+  std::uint64_t k = 0;
+  for (int b = a_numBit - 1; b >= 0; --b)
+    {
+      for (int dir = 0; dir != g_SpaceDim; ++dir)
+        {
+          k = (k << 1) | ((x[dir] >> b) & 1);
+        }
+    }
+  return k;
+}
+
+/*--------------------------------------------------------------------*/
+//  Cost of a box (1 if no costs are given)
+/*--------------------------------------------------------------------*/
+
+inline Real
+boxCost(const std::vector<Real>& a_cost, const int a_idx)
+{
+  return (a_cost.empty()) ? (Real)1 : a_cost[a_idx];
+}
+
+/*--------------------------------------------------------------------*/
+//  Knapsack: largest cost first to the least loaded process
+/*--------------------------------------------------------------------*/
+
+void
+distributeKnapsack(std::vector<int>&        a_boxProc,
+                   const int                a_numProc,
+                   const std::vector<Real>& a_cost)
+{
+  const int size = a_boxProc.size();
+  std::vector<int> order(size);
+  for (int i = 0; i != size; ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(),
+                   [&a_cost]
+                   (const int a_i, const int a_j)
+                   {
+                     return boxCost(a_cost, a_i) > boxCost(a_cost, a_j);
+                   });
+  std::vector<Real> load(a_numProc, (Real)0);
+  for (const int idx : order)
+    {
+      const int proc = std::min_element(load.begin(), load.end()) -
+        load.begin();
+      a_boxProc[idx] = proc;
+      load[proc] += boxCost(a_cost, idx);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Cut the curve into pieces of equal cost.  A box belongs to the
+//  process containing the midpoint of its cost.
+/** \param[out] a_boxProc
+ *                      Process for each box
+ *  \param[in]  a_numProc
+ *                      Number of processes
+ *  \param[in]  a_key   Boxes (second) sorted along the curve
+ *  \param[in]  a_cost  Cost of each box (may be empty)
+ *//*-----------------------------------------------------------------*/
+
+void
+cutCurve(std::vector<int>&                                  a_boxProc,
+         const int                                          a_numProc,
+         const std::vector<std::pair<std::uint64_t, int> >& a_key,
+         const std::vector<Real>&                           a_cost)
+{
+  const int size = a_key.size();
+  Real totalCost = 0.;
+  for (int i = 0; i != size; ++i)
+    {
+      totalCost += boxCost(a_cost, i);
+    }
+  Real cumCost = 0.;
+  for (int i = 0; i != size; ++i)
+    {
+      const int idxBox = a_key[i].second;
+      const Real c = boxCost(a_cost, idxBox);
+      const int proc = (totalCost > 0.) ?
+        (int)(a_numProc*(cumCost + 0.5*c)/totalCost) :
+        (int)(((long long)i*a_numProc)/size);
+      a_boxProc[idxBox] = std::min(a_numProc - 1, std::max(0, proc));
+      cumCost += c;
+    }
+}
+
+}  // anonymous namespace
 
 
 /*******************************************************************************
@@ -51,9 +224,14 @@ DisjointBoxLayout::DisjointBoxLayout()
   :
   m_stride(IntVect::Zero),
   m_numBox(IntVect::Zero),
+  m_boxSize(IntVect::Zero),
   m_size(0),
+  m_irregular(false),
+  m_boxBins(),
   m_boxes(),
+  m_localBoxes(std::make_shared<std::vector<int> >()),
   m_localIdxBeg(0),
+  m_localIdxEnd(0),
   m_numLocalBox(0)
 {
 }
@@ -63,6 +241,11 @@ DisjointBoxLayout::DisjointBoxLayout()
 /** \param[in] a_domain The problem domain
  *  \param[in] a_maxBoxSize
  *                      Maximum box size in each direction
+ *  \param[in] a_distribution
+ *                      Strategy for distributing boxes among processes
+ *                      (default lexicographic)
+ *  \param[in] a_cost   Cost of each box indexed by global index.  If
+ *                      empty, the number of cells in each box is used
  *  The problem domain is partitioned into boxes, each having maximum
  *  size in a dimension given by a_maxBoxSize.  Depending on how well
  *  the boxes fit into the domain, either a few boxes have a size
@@ -71,10 +254,28 @@ DisjointBoxLayout::DisjointBoxLayout()
  *  a_maxBoxSize dimensions.
  *//*-----------------------------------------------------------------*/
 
-DisjointBoxLayout::DisjointBoxLayout(const Box&     a_domain,
-                                     const IntVect& a_maxBoxSize)
+DisjointBoxLayout::DisjointBoxLayout(const Box&               a_domain,
+                                     const IntVect&           a_maxBoxSize,
+                                     const Distribution       a_distribution,
+                                     const std::vector<Real>& a_cost)
 {
-  define(a_domain, a_maxBoxSize);
+  define(a_domain, a_maxBoxSize, a_distribution, a_cost);
+}
+
+/*--------------------------------------------------------------------*/
+//  Constructor with a given assignment of boxes to processes
+/** \param[in] a_domain The problem domain
+ *  \param[in] a_maxBoxSize
+ *                      Maximum box size in each direction
+ *  \param[in] a_boxProc
+ *                      Process for each box indexed by global index
+ *//*-----------------------------------------------------------------*/
+
+DisjointBoxLayout::DisjointBoxLayout(const Box&              a_domain,
+                                     const IntVect&          a_maxBoxSize,
+                                     const std::vector<int>& a_boxProc)
+{
+  define(a_domain, a_maxBoxSize, a_boxProc);
 }
 
 /*--------------------------------------------------------------------*/
@@ -82,18 +283,266 @@ DisjointBoxLayout::DisjointBoxLayout(const Box&     a_domain,
 /** \param[in] a_domain The problem domain
  *  \param[in] a_maxBoxSize
  *                      Maximum box size in each direction
+ *  \param[in] a_distribution
+ *                      Strategy for distributing boxes among processes
+ *                      (default lexicographic)
+ *  \param[in] a_cost   Cost of each box indexed by global index.  If
+ *                      empty, the number of cells in each box is used
  *  The problem domain is partitioned into boxes, each having maximum
  *  size in a dimension given by a_maxBoxSize.  Depending on how well
  *  the boxes fit into the domain, either a few boxes have a size
  *  reduced by 1 or there is one box at the end with a significantly
  *  different size.  Leading boxes in each direction usually have
  *  a_maxBoxSize dimensions.
+ *
+ *  With the default cost, the result only depends on the arguments and
+ *  the number of processes.  If a layout defined with the same
+ *  arguments is still alive, its arrays are shared instead of being
+ *  computed again, and both layouts have the same tag.
  *//*-----------------------------------------------------------------*/
 
 void
-DisjointBoxLayout::define(const Box& a_domain, const IntVect& a_maxBoxSize)
+DisjointBoxLayout::define(const Box&               a_domain,
+                          const IntVect&           a_maxBoxSize,
+                          const Distribution       a_distribution,
+                          const std::vector<Real>& a_cost)
+{
+  if (a_cost.empty() && shareDefined(a_domain, a_maxBoxSize, a_distribution))
+    {
+      return;
+    }
+  defineBoxes(a_domain, a_maxBoxSize);
+  std::vector<Real> cost(a_cost);
+  if (cost.empty())
+    {
+      cost.resize(m_size);
+#pragma omp parallel for default(shared) if (m_size >= s_minThreadBoxes)
+      for (int i = 0; i < m_size; ++i)
+        {
+          cost[i] = (*m_boxes)[i].box.size();
+        }
+    }
+  std::vector<int> boxProc;
+  distribute(boxProc, m_numBox, numProc(), a_distribution, cost);
+  defineProcs(boxProc);
+  if (a_cost.empty())
+    {
+      recordDefined(a_distribution);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Define with a given assignment of boxes to processes
+/** \param[in] a_domain The problem domain
+ *  \param[in] a_maxBoxSize
+ *                      Maximum box size in each direction
+ *  \param[in] a_boxProc
+ *                      Process for each box indexed by global index.
+ *                      Any number of boxes (including zero) may be
+ *                      assigned to a process.
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::define(const Box&              a_domain,
+                          const IntVect&          a_maxBoxSize,
+                          const std::vector<int>& a_boxProc)
+{
+  defineBoxes(a_domain, a_maxBoxSize);
+  defineProcs(a_boxProc);
+}
+
+/*--------------------------------------------------------------------*/
+//  Define with only some of the blocks of the lattice
+/** \param[in] a_domain The problem domain
+ *  \param[in] a_maxBoxSize
+ *                      Size of the blocks in each direction
+ *  \param[in] a_present
+ *                      Non-zero for each block of the lattice that is
+ *                      present, indexed lexicographically over the
+ *                      lattice
+ *  \param[in] a_distribution
+ *                      Strategy for distributing boxes among processes
+ *                      (default lexicographic).  Curves are still cut
+ *                      by position in the full lattice so each process
+ *                      gets a compact set of boxes.
+ *  \param[in] a_cost   Cost of each present box indexed by global
+ *                      index.  If empty, the number of cells in each
+ *                      box is used
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::defineSubset(const Box&               a_domain,
+                                const IntVect&           a_maxBoxSize,
+                                const std::vector<char>& a_present,
+                                const Distribution       a_distribution,
+                                const std::vector<Real>& a_cost)
+{
+  defineBoxes(a_domain, a_maxBoxSize, &a_present);
+  CH_assert(a_cost.empty() || (int)a_cost.size() == m_size);
+  // Distribute over the full lattice with no cost for absent blocks.  The
+  // present blocks are numbered in lattice order.
+  const int latticeSize = a_present.size();
+  std::vector<Real> latticeCost(latticeSize, (Real)0);
+  for (int iLat = 0, idx = 0; iLat != latticeSize; ++iLat)
+    {
+      if (a_present[iLat])
+        {
+          latticeCost[iLat] = (a_cost.empty()) ?
+            (Real)(*m_boxes)[idx].box.size() : a_cost[idx];
+          ++idx;
+        }
+    }
+  std::vector<int> latticeProc;
+  distribute(latticeProc, m_numBox, numProc(), a_distribution, latticeCost);
+  std::vector<int> boxProc(m_size);
+  for (int iLat = 0, idx = 0; iLat != latticeSize; ++iLat)
+    {
+      if (a_present[iLat])
+        {
+          boxProc[idx++] = latticeProc[iLat];
+        }
+    }
+  defineProcs(boxProc);
+}
+
+/*--------------------------------------------------------------------*/
+//  Define with only some of the blocks of the lattice and a given
+//  assignment of boxes to processes
+/** \param[in] a_domain The problem domain
+ *  \param[in] a_maxBoxSize
+ *                      Size of the blocks in each direction
+ *  \param[in] a_present
+ *                      Non-zero for each block of the lattice that is
+ *                      present, indexed lexicographically over the
+ *                      lattice
+ *  \param[in] a_boxProc
+ *                      Process for each present box indexed by global
+ *                      index
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::defineSubset(const Box&               a_domain,
+                                const IntVect&           a_maxBoxSize,
+                                const std::vector<char>& a_present,
+                                const std::vector<int>&  a_boxProc)
+{
+  defineBoxes(a_domain, a_maxBoxSize, &a_present);
+  defineProcs(a_boxProc);
+}
+
+/*--------------------------------------------------------------------*/
+//  Define with any set of disjoint boxes
+/** \param[in] a_domain The problem domain
+ *  \param[in] a_boxes  Disjoint boxes inside the domain.  Global
+ *                      indices are the order of the boxes.
+ *  \param[in] a_distribution
+ *                      Strategy for distributing boxes among processes
+ *                      (default lexicographic).  Curves are followed
+ *                      through the low corners of the boxes.
+ *  \param[in] a_cost   Cost of each box indexed by global index.  If
+ *                      empty, the number of cells in each box is used
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::defineIrregular(const Box&               a_domain,
+                                   const std::vector<Box>&  a_boxes,
+                                   const Distribution       a_distribution,
+                                   const std::vector<Real>& a_cost)
+{
+  defineIrregularBoxes(a_domain, a_boxes);
+  std::vector<Real> cost(a_cost);
+  if (cost.empty())
+    {
+      cost.resize(m_size);
+      for (int i = 0; i != m_size; ++i)
+        {
+          cost[i] = a_boxes[i].size();
+        }
+    }
+  std::vector<int> boxProc;
+  distribute(boxProc, a_boxes, a_domain, numProc(), a_distribution, cost);
+  defineProcs(boxProc);
+}
+
+/*--------------------------------------------------------------------*/
+//  Define with any set of disjoint boxes and a given assignment of
+//  boxes to processes
+/** \param[in] a_domain The problem domain
+ *  \param[in] a_boxes  Disjoint boxes inside the domain.  Global
+ *                      indices are the order of the boxes.
+ *  \param[in] a_boxProc
+ *                      Process for each box indexed by global index
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::defineIrregular(const Box&              a_domain,
+                                   const std::vector<Box>& a_boxes,
+                                   const std::vector<int>& a_boxProc)
+{
+  defineIrregularBoxes(a_domain, a_boxes);
+  defineProcs(a_boxProc);
+}
+
+/*--------------------------------------------------------------------*/
+//  Define by coarsening all boxes of another layout
+/** The boxes keep their global indices and processes so a LevelData
+ *  on this layout has the same local boxes as one on a_dbl.  This is
+ *  used to hold coarse data under fine boxes (see CoarseFine).
+ *  \param[in] a_dbl    Layout to coarsen
+ *  \param[in] a_ratio  Refinement ratio which must evenly divide the
+ *                      size of the boxes in a_dbl
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::defineCoarsened(const DisjointBoxLayout& a_dbl,
+                                   const int                a_ratio)
+{
+  CH_assert(a_ratio > 0);
+  const IntVect ratio(D_DECL(a_ratio, a_ratio, a_ratio));
+  CH_assert((a_dbl.m_boxSize/ratio)*ratio == a_dbl.m_boxSize);
+  m_domain = a_dbl.m_domain;
+  m_domain.coarsen(a_ratio);
+  m_stride = a_dbl.m_stride;
+  m_numBox = a_dbl.m_numBox;
+  m_boxSize = a_dbl.m_boxSize/ratio;
+  m_size = a_dbl.m_size;
+  m_irregular = a_dbl.m_irregular;
+  m_boxes = std::make_shared<std::vector<BoxEntry> >(*a_dbl.m_boxes);
+  for (BoxEntry& entry : *m_boxes)
+    {
+      CH_assert(Box(entry.box).coarsen(a_ratio).refine(a_ratio) == entry.box);
+      entry.box.coarsen(a_ratio);
+    }
+  m_boxBins.reset();
+  if (a_dbl.m_boxBins)
+    {
+      defineBins();
+    }
+  m_localBoxes = a_dbl.m_localBoxes;
+  m_localIdxBeg = a_dbl.m_localIdxBeg;
+  m_localIdxEnd = a_dbl.m_localIdxEnd;
+  m_numLocalBox = a_dbl.m_numLocalBox;
+}
+
+/*--------------------------------------------------------------------*/
+//  Define the boxes
+/** Processes are not assigned
+ *  \param[in] a_domain The problem domain
+ *  \param[in] a_maxBoxSize
+ *                      Maximum box size in each direction
+ *  \param[in] a_present
+ *                      If not null, non-zero for each block of the
+ *                      lattice that is present.  Otherwise all blocks
+ *                      are present.
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::defineBoxes(const Box&               a_domain,
+                               const IntVect&           a_maxBoxSize,
+                               const std::vector<char>* a_present)
 {
   m_domain = a_domain;
+  m_boxSize = a_maxBoxSize;
   const IntVect domainSize =
     a_domain.hiVect() - a_domain.loVect() + IntVect::Unit;
 
@@ -112,59 +561,276 @@ DisjointBoxLayout::define(const Box& a_domain, const IntVect& a_maxBoxSize)
   D_TERM(m_stride[0] = 1;,
          m_stride[1] = m_stride[0]*m_numBox[0];,
          m_stride[2] = m_stride[1]*m_numBox[1];)
-    m_size = m_stride[g_SpaceDim-1]*m_numBox[g_SpaceDim-1];
+  const int latticeSize = m_stride[g_SpaceDim-1]*m_numBox[g_SpaceDim-1];
+
+  // Number the present blocks in lattice order
+  m_irregular = false;
+  if (a_present)
+    {
+      CH_assert((int)a_present->size() == latticeSize);
+      m_size = std::count_if(a_present->begin(), a_present->end(),
+                             [](const char a_flag)
+                             {
+                               return a_flag != 0;
+                             });
+    }
+  else
+    {
+      m_size = latticeSize;
+    }
 
   // Allocate the array of boxes
   m_boxes = std::make_shared<std::vector<BoxEntry> >(m_size);
 
-  // Number of boxes per processor
-  const int boxPerProc = m_size/numProc();
-  m_numLocalBox = boxPerProc;
-  m_localIdxBeg = procID()*boxPerProc;
-  // Make sure the boxes fit evenly into the processors
-  CH_assert(m_size == boxPerProc*numProc());
-  
-//--Define the individual boxes and processor assignments for 'm_boxes'
-  int linIdxBox  = 0;
-  //int linIdxProc = 0;
-  IntVect temp_lo = a_domain.loVect();
-  IntVect temp_hi = temp_lo + a_maxBoxSize - IntVect::Unit;
-
-  for(int k = 0; k<numProc();++k)
-  {
-    for(int j = 0; j<boxPerProc;++j)
+//--Define the individual boxes in 'm_boxes'
+
+  if (!a_present)
     {
-      ((*m_boxes)[linIdxBox].box).define(temp_lo, temp_hi);
-      (*m_boxes)[linIdxBox].proc = k;
-      ++linIdxBox;
+      // The global index is the lattice index so boxes are independent
+#pragma omp parallel for default(shared) if (m_size >= s_minThreadBoxes)
+      for (int idx = 0; idx < m_size; ++idx)
+        {
+          IntVect iv;
+          for (int dir = 0; dir != g_SpaceDim; ++dir)
+            {
+              iv[dir] = (idx/m_stride[dir]) % m_numBox[dir];
+            }
+          const IntVect lo = a_domain.loVect() + iv*a_maxBoxSize;
+          BoxEntry& entry = (*m_boxes)[idx];
+          entry.box.define(lo, lo + a_maxBoxSize - IntVect::Unit);
+          entry.proc = -1;
+          entry.localIdx = -1;
+        }
+    }
+  else
+    {
+      const Box lattice(IntVect::Zero, m_numBox - IntVect::Unit);
+      int iLat = 0;
+      int idx = 0;
+      MD_BOXLOOP(lattice, i)
+        {
+          if ((*a_present)[iLat])
+            {
+              const IntVect iv(D_DECL(i0, i1, i2));
+              const IntVect lo = a_domain.loVect() + iv*a_maxBoxSize;
+              BoxEntry& entry = (*m_boxes)[idx++];
+              entry.box.define(lo, lo + a_maxBoxSize - IntVect::Unit);
+              entry.proc = -1;
+              entry.localIdx = -1;
+            }
+          ++iLat;
+        }
+    }
 
-      if(temp_lo[0]+a_maxBoxSize[0] < a_domain.hiVect(0))
-      {
-        temp_lo[0] += a_maxBoxSize[0];
-        temp_hi[0] += a_maxBoxSize[0];
-      }
-      else if(temp_lo[1] + a_maxBoxSize[1] < a_domain.hiVect(1))
-      {
-        temp_lo[0] = a_domain.loVect(0);
-        temp_hi[0] = a_domain.loVect(0) + a_maxBoxSize[0]-1;
-        temp_lo[1] += a_maxBoxSize[1];
-        temp_hi[1] += a_maxBoxSize[1];
-      }
-      else if(g_SpaceDim == 3)
-      {
-        if(temp_lo[2] + a_maxBoxSize[2] < a_domain.hiVect(2))
+  // Only subsets need an index to find the boxes
+  m_boxBins.reset();
+  if (a_present)
+    {
+      defineBins();
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Define the boxes of an irregular layout
+/** Processes are not assigned.  The bins of the spatial index have the
+ *  size of the largest box in each direction.
+ *  \param[in] a_domain The problem domain
+ *  \param[in] a_boxes  Disjoint boxes inside the domain
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::defineIrregularBoxes(const Box&              a_domain,
+                                        const std::vector<Box>& a_boxes)
+{
+  m_domain = a_domain;
+  m_irregular = true;
+  m_size = a_boxes.size();
+  m_boxSize = IntVect::Unit;
+  m_boxes = std::make_shared<std::vector<BoxEntry> >(m_size);
+  for (int i = 0; i != m_size; ++i)
+    {
+      const Box& box = a_boxes[i];
+      CH_assert(!box.isEmpty() && a_domain.contains(box));
+      m_boxSize.max(box.dimensions());
+      BoxEntry& entry = (*m_boxes)[i];
+      entry.box = box;
+      entry.proc = -1;
+      entry.localIdx = -1;
+    }
+
+  // The lattice of bins covering the domain
+  const IntVect domainSize = a_domain.dimensions();
+  m_numBox = (domainSize + m_boxSize - IntVect::Unit)/m_boxSize;
+  D_TERM(m_stride[0] = 1;,
+         m_stride[1] = m_stride[0]*m_numBox[0];,
+         m_stride[2] = m_stride[1]*m_numBox[1];)
+  defineBins();
+
+#ifndef RELEASE
+  // The boxes must be disjoint
+  std::vector<int> idxOverlap;
+  for (int i = 0; i != m_size; ++i)
+    {
+      m_boxBins->overlaps(a_boxes[i], idxOverlap);
+      CH_assert(idxOverlap.size() == 1);
+    }
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+//  Build the spatial index of the boxes
+/** Bins have the size m_boxSize starting from the low corner of the
+ *  domain so each block of a lattice is in its own bin.  Indices in
+ *  the spatial index are global indices.
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::defineBins()
+{
+  std::vector<Box> boxes(m_size);
+  for (int i = 0; i != m_size; ++i)
+    {
+      boxes[i] = (*m_boxes)[i].box;
+    }
+  m_boxBins = std::make_shared<BoxBins>(boxes, m_domain.loVect(), m_boxSize);
+}
+
+/*--------------------------------------------------------------------*/
+//  Assign processes to boxes and set up local indexing
+/** The box entries are modified in place.  m_boxes may be shared with
+ *  copies of a layout and with later layouts defined with the same
+ *  parameters (see shareDefined), so this must only be called right
+ *  after defineBoxes or defineIrregularBoxes have allocated new entries
+ *  and before recordDefined.
+ *  \param[in] a_boxProc
+ *                      Process for each box indexed by global index
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::defineProcs(const std::vector<int>& a_boxProc)
+{
+  CH_assert((int)a_boxProc.size() == m_size);
+  CH_assert(m_boxes.use_count() == 1);
+#pragma omp parallel for default(shared) if (m_size >= s_minThreadBoxes)
+  for (int i = 0; i < m_size; ++i)
+    {
+      CH_assert(a_boxProc[i] >= 0 && a_boxProc[i] < numProc());
+      BoxEntry& entry = (*m_boxes)[i];
+      entry.proc = a_boxProc[i];
+      entry.localIdx = -1;
+    }
+  // Local indices are assigned in order of global index
+  m_localBoxes = std::make_shared<std::vector<int> >();
+  for (int i = 0; i != m_size; ++i)
+    {
+      if (a_boxProc[i] == procID())
         {
-          temp_lo[0] = a_domain.loVect(0);
-          temp_lo[1] = a_domain.loVect(1);
-          temp_hi[0] = a_domain.loVect(0) + a_maxBoxSize[0]-1;
-          temp_hi[1] = a_domain.loVect(1) + a_maxBoxSize[1]-1;
-          temp_lo[2] += a_maxBoxSize[2];
-          temp_hi[2] += a_maxBoxSize[2];
+          (*m_boxes)[i].localIdx = m_localBoxes->size();
+          m_localBoxes->push_back(i);
         }
-      }
+    }
+  setLocalRange();
+}
 
+/*--------------------------------------------------------------------*/
+//  Set the range and number of local boxes from m_localBoxes
+/*--------------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::setLocalRange()
+{
+  m_numLocalBox = m_localBoxes->size();
+  if (m_numLocalBox > 0)
+    {
+      m_localIdxBeg = m_localBoxes->front();
+      m_localIdxEnd = m_localBoxes->back() + 1;
+    }
+  else
+    {
+      m_localIdxBeg = 0;
+      m_localIdxEnd = 0;
     }
-  }
+}
+
+/*--------------------------------------------------------------------*/
+//  Share the arrays of a live layout defined with the same parameters
+/** Only complete layouts defined from a distribution with the default
+ *  cost are recorded (see recordDefined).  Thread safe.
+ *  \param[in] a_domain The problem domain
+ *  \param[in] a_maxBoxSize
+ *                      Maximum box size in each direction
+ *  \param[in] a_distribution
+ *                      Strategy for distributing boxes among processes
+ *  \return             T - this layout is defined with the arrays of
+ *                          the recorded layout
+ *                      F - no live layout matches and this layout is
+ *                          unchanged
+ *//*-----------------------------------------------------------------*/
+
+bool
+DisjointBoxLayout::shareDefined(const Box&         a_domain,
+                                const IntVect&     a_maxBoxSize,
+                                const Distribution a_distribution)
+{
+  std::lock_guard<std::mutex> lock(s_definedLayoutsMutex);
+  for (const DefinedLayout& defined : s_definedLayouts)
+    {
+      if (defined.m_domain == a_domain &&
+          defined.m_boxSize == a_maxBoxSize &&
+          defined.m_distribution == a_distribution &&
+          defined.m_numProc == numProc())
+        {
+          std::shared_ptr<std::vector<BoxEntry> > boxes =
+            defined.m_boxes.lock();
+          std::shared_ptr<std::vector<int> > localBoxes =
+            defined.m_localBoxes.lock();
+          if (!boxes || !localBoxes) continue;
+          m_domain = a_domain;
+          m_boxSize = a_maxBoxSize;
+          const IntVect domainSize =
+            a_domain.hiVect() - a_domain.loVect() + IntVect::Unit;
+          m_numBox = domainSize/a_maxBoxSize;
+          D_TERM(m_stride[0] = 1;,
+                 m_stride[1] = m_stride[0]*m_numBox[0];,
+                 m_stride[2] = m_stride[1]*m_numBox[1];)
+          m_size = boxes->size();
+          m_irregular = false;
+          m_boxBins.reset();
+          m_boxes = boxes;
+          m_localBoxes = localBoxes;
+          setLocalRange();
+          return true;
+        }
+    }
+  return false;
+}
+
+/*--------------------------------------------------------------------*/
+//  Record this layout so later definitions can share its arrays
+/** Only weak references are kept so the arrays are released with the
+ *  last layout using them.  Expired records are removed.  Thread safe.
+ *  \param[in] a_distribution
+ *                      Strategy used to distribute the boxes
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::recordDefined(const Distribution a_distribution) const
+{
+  std::lock_guard<std::mutex> lock(s_definedLayoutsMutex);
+  s_definedLayouts.erase(
+    std::remove_if(s_definedLayouts.begin(), s_definedLayouts.end(),
+                   [](const DefinedLayout& a_defined)
+                   {
+                     return a_defined.m_boxes.expired() ||
+                       a_defined.m_localBoxes.expired();
+                   }),
+    s_definedLayouts.end());
+  s_definedLayouts.push_back(DefinedLayout{ m_domain,
+                                            m_boxSize,
+                                            a_distribution,
+                                            numProc(),
+                                            m_boxes,
+                                            m_localBoxes });
 }
 
 /*--------------------------------------------------------------------*/
@@ -177,14 +843,182 @@ DisjointBoxLayout::define(const Box& a_domain, const IntVect& a_maxBoxSize)
 void
 DisjointBoxLayout::defineDeepCopy(const DisjointBoxLayout& a_dbl)
 {
+  m_domain = a_dbl.m_domain;
   m_stride = a_dbl.m_stride;
   m_numBox = a_dbl.m_numBox;
+  m_boxSize = a_dbl.m_boxSize;
   m_size = a_dbl.m_size;
+  m_irregular = a_dbl.m_irregular;
+  m_boxBins.reset();
+  if (a_dbl.m_boxBins)
+    {
+      m_boxBins = std::make_shared<BoxBins>(*a_dbl.m_boxBins);
+    }
   m_boxes = std::make_shared<std::vector<BoxEntry> >(m_size);
   for (int i = 0; i != m_size; ++i)
     {
       getLinear(i) = a_dbl.getLinear(i);
     }
+  m_localBoxes = std::make_shared<std::vector<int> >(*a_dbl.m_localBoxes);
+  m_localIdxBeg = a_dbl.m_localIdxBeg;
+  m_localIdxEnd = a_dbl.m_localIdxEnd;
+  m_numLocalBox = a_dbl.m_numLocalBox;
+}
+
+/*--------------------------------------------------------------------*/
+//  Global indices of the boxes overlapping a region
+/** Complete layouts find the blocks from the lattice and all others
+ *  use the spatial index
+ *  \param[in]  a_region
+ *                      Region (may extend outside the domain)
+ *  \param[out] a_globalIdx
+ *                      Global indices of the boxes overlapping the
+ *                      region (ascending)
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::overlaps(const Box&        a_region,
+                            std::vector<int>& a_globalIdx) const
+{
+  if (m_boxBins)
+    {
+      m_boxBins->overlaps(a_region, a_globalIdx);
+      return;
+    }
+  a_globalIdx.clear();
+  Box region(a_region);
+  region &= m_domain;
+  if (region.isEmpty()) return;
+  const Box lattice((region.loVect() - m_domain.loVect())/m_boxSize,
+                    (region.hiVect() - m_domain.loVect())/m_boxSize);
+  MD_BOXLOOP(lattice, i)
+    {
+      a_globalIdx.push_back(linearNbrOffset(IntVect(D_DECL(i0, i1, i2))));
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Compute an assignment of boxes to processes
+/** This does not require a defined layout so can be used to examine
+ *  distributions for any number of processes.
+ *
+ *  For the curve-based distributions, boxes are ordered along the
+ *  curve and the curve is cut into contiguous pieces of approximately
+ *  equal cost.  This gives each process a compact set of boxes and
+ *  minimizes the surface area (communication) between processes.
+ *  Knapsack ignores locality and only balances the cost.
+ *  \param[out] a_boxProc
+ *                      Process for each box indexed by global index
+ *  \param[in]  a_numBox
+ *                      Number of boxes in each direction
+ *  \param[in]  a_numProc
+ *                      Number of processes
+ *  \param[in]  a_distribution
+ *                      Strategy to use
+ *  \param[in]  a_cost  Cost of each box indexed by global index.  If
+ *                      empty, all boxes have the same cost
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::distribute(std::vector<int>&        a_boxProc,
+                              const IntVect&           a_numBox,
+                              const int                a_numProc,
+                              const Distribution       a_distribution,
+                              const std::vector<Real>& a_cost)
+{
+  CH_assert(a_numProc > 0);
+  const int size = a_numBox.product();
+  CH_assert(a_cost.empty() || (int)a_cost.size() == size);
+  a_boxProc.assign(size, 0);
+  if (size == 0) return;
+
+//--Knapsack: largest cost first to the least loaded process
+
+  if (a_distribution == Distribution::knapsack)
+    {
+      distributeKnapsack(a_boxProc, a_numProc, a_cost);
+      return;
+    }
+
+//--Curves: find the position of each box along the curve
+
+  // Bits required to index the boxes in any direction
+  int maxNumBox = 0;
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      maxNumBox = std::max(maxNumBox, a_numBox[dir]);
+    }
+  int numBit = 0;
+  while ((1 << numBit) < maxNumBox) ++numBit;
+  CH_assert(numBit*g_SpaceDim <= 64);
+  std::vector<std::pair<std::uint64_t, int> > key(size);
+  const Box lattice(IntVect::Zero, a_numBox - IntVect::Unit);
+  int idx = 0;
+  MD_BOXLOOP(lattice, i)
+    {
+      const IntVect iv(D_DECL(i0, i1, i2));
+      const std::uint64_t k = (a_distribution == Distribution::lexicographic) ?
+        idx : curveKey(iv, numBit, a_distribution);
+      key[idx] = std::make_pair(k, idx);
+      ++idx;
+    }
+  std::sort(key.begin(), key.end());
+  cutCurve(a_boxProc, a_numProc, key, a_cost);
+}
+
+/*--------------------------------------------------------------------*/
+//  Compute an assignment of any set of boxes to processes
+/** Like distribute for a lattice, but the curves pass through the low
+ *  corners of the boxes.  Lexicographic gives contiguous runs of
+ *  global indices.
+ *  \param[out] a_boxProc
+ *                      Process for each box indexed by global index
+ *  \param[in]  a_boxes The boxes
+ *  \param[in]  a_domain
+ *                      Problem domain containing the boxes
+ *  \param[in]  a_numProc
+ *                      Number of processes
+ *  \param[in]  a_distribution
+ *                      Strategy to use
+ *  \param[in]  a_cost  Cost of each box indexed by global index.  If
+ *                      empty, all boxes have the same cost
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::distribute(std::vector<int>&        a_boxProc,
+                              const std::vector<Box>&  a_boxes,
+                              const Box&               a_domain,
+                              const int                a_numProc,
+                              const Distribution       a_distribution,
+                              const std::vector<Real>& a_cost)
+{
+  CH_assert(a_numProc > 0);
+  const int size = a_boxes.size();
+  CH_assert(a_cost.empty() || (int)a_cost.size() == size);
+  a_boxProc.assign(size, 0);
+  if (size == 0) return;
+  if (a_distribution == Distribution::knapsack)
+    {
+      distributeKnapsack(a_boxProc, a_numProc, a_cost);
+      return;
+    }
+  int numBit = 0;
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      while ((1 << numBit) < a_domain.dimensions()[dir]) ++numBit;
+    }
+  CH_assert(numBit*g_SpaceDim <= 64);
+  std::vector<std::pair<std::uint64_t, int> > key(size);
+  for (int idx = 0; idx != size; ++idx)
+    {
+      const std::uint64_t k = (a_distribution == Distribution::lexicographic) ?
+        idx :
+        curveKey(a_boxes[idx].loVect() - a_domain.loVect(), numBit,
+                 a_distribution);
+      key[idx] = std::make_pair(k, idx);
+    }
+  std::sort(key.begin(), key.end());
+  cutCurve(a_boxProc, a_numProc, key, a_cost);
 }
 
 #ifndef NO_CGNS
@@ -228,6 +1062,7 @@ DisjointBoxLayout::writeCGNSZoneGrid(const int      a_indexFile,
                                      const IntVect& a_origin,
                                      const Real     a_dx) const
 {
+  TIMED_REGION(timerWrite, "DisjointBoxLayout::writeCGNSZoneGrid");
   a_indexZoneOffset = -1;
   int cgerr;
   char zoneName[33];
@@ -314,6 +1149,14 @@ DisjointBoxLayout::writeCGNSZoneGrid(const int      a_indexFile,
   cgsize_t rmax[g_SpaceDim];
 #endif
 
+  // One buffer, large enough for the vertices of any box, holds the
+  // coordinates of each box in turn
+  std::vector<Real> coordsBuffer;
+  if (localSize() > 0)
+    {
+      coordsBuffer.resize((m_boxSize + IntVect::Unit).product());
+    }
+
   for (DataIterator dit(*this); dit.ok(); ++dit)
     {
       const int globalBoxIndex = (*dit).globalIndex();
@@ -322,7 +1165,10 @@ DisjointBoxLayout::writeCGNSZoneGrid(const int      a_indexFile,
       box.growHi(1);  // Since we need vertices
       const IntVect loV = box.loVect();
       const IntVect hiV = box.hiVect();
-      BaseFab<Real> coords(box, 1);
+      // The coordinates are written as one contiguous array
+      CH_assert(box.size() <= (int)coordsBuffer.size());
+      BaseFab<Real> coords(box, 1, BaseFab<Real>::Layout::planar,
+                           coordsBuffer.data());
 #ifdef USE_MPI
       const int localBoxIndex = (*dit).localIndex();
       CGNSIndices& thisCGNSIndices = localCGNSIndices[localBoxIndex];
@@ -336,11 +1182,11 @@ DisjointBoxLayout::writeCGNSZoneGrid(const int      a_indexFile,
 #endif
       // X
       {
-        Real* ptr = coords.dataPtr();
-        MD_BOXLOOP_OMP(box,i)
-	{
-		*ptr++ = i0;		
-	}
+        MD_ARRAY_RESTRICT(arrCoords, coords);
+        MD_BOXLOOP_OMP(box, i)
+          {
+            arrCoords[MD_IX(i, 0)] = i0;
+          }
 #ifdef USE_MPI
         cgerr = cgp_coord_write_data(a_indexFile, a_indexBase,indexZone,thisCGNSIndices.indexCoord[0], rmin,rmax,coords.dataPtr());
 #else
@@ -351,11 +1197,11 @@ DisjointBoxLayout::writeCGNSZoneGrid(const int      a_indexFile,
       // Y
       if (g_SpaceDim >= 2)
          {
-          Real* ptr = coords.dataPtr();
-	  MD_BOXLOOP_OMP(box,i)
-	{	
-		*ptr++ = i1;
-	}	
+          MD_ARRAY_RESTRICT(arrCoords, coords);
+          MD_BOXLOOP_OMP(box, i)
+            {
+              arrCoords[MD_IX(i, 0)] = i1;
+            }
 #ifdef USE_MPI
           cgerr = cgp_coord_write_data(a_indexFile, a_indexBase,indexZone,thisCGNSIndices.indexCoord[1], rmin,rmax,coords.dataPtr());
 #else
@@ -366,11 +1212,11 @@ DisjointBoxLayout::writeCGNSZoneGrid(const int      a_indexFile,
       // Z
       if (g_SpaceDim >= 3)
         {
-	Real* ptr = coords.dataPtr();
-	MD_BOXLOOP_OMP(box,i)
-	{
-		*ptr++ = i2;
-	}
+          MD_ARRAY_RESTRICT(arrCoords, coords);
+          MD_BOXLOOP_OMP(box, i)
+            {
+              arrCoords[MD_IX(i, 0)] = i2;
+            }
 #ifdef USE_MPI
           cgerr = cgp_coord_write_data(a_indexFile, a_indexBase,indexZone,thisCGNSIndices.indexCoord[2], rmin,rmax,coords.dataPtr());
 #else
@@ -381,20 +1227,149 @@ DisjointBoxLayout::writeCGNSZoneGrid(const int      a_indexFile,
     }
   return 0;
 }
+
+/*--------------------------------------------------------------------*/
+//  Write CGNS zones to a file and link the grid from another file
+/** The CGNS file must be open.  The zones are the same as those
+ *  written by writeCGNSZoneGrid but, instead of writing coordinates,
+ *  the GridCoordinates node of each zone is linked to the same node
+ *  in a grid file previously written by writeCGNSZoneGrid for this
+ *  layout.  This avoids rewriting the grid in every plot file.
+ *  \param[in]  a_indexFile
+ *                      CGNS index of file
+ *  \param[in]  a_indexBase
+ *                      CGNS index of base node
+ *  \param[out] a_indexZoneOffset
+ *                      The difference between CGNS indexZone and the
+ *                      globalBoxIndex
+ *  \param[in]  a_gridFileName
+ *                      Name of the grid file relative to the directory
+ *                      of this file
+ *  \param[in]  a_baseName
+ *                      Name of the base node in the grid file
+ *  \return             0  Success
+ *                      >0 1+ the global index of the box that failed
+ *//*-----------------------------------------------------------------*/
+
+int
+DisjointBoxLayout::writeCGNSZoneLinkGrid(const int   a_indexFile,
+                                         const int   a_indexBase,
+                                         int&        a_indexZoneOffset,
+                                         const char* a_gridFileName,
+                                         const char* a_baseName) const
+{
+  TIMED_REGION(timerWrite, "DisjointBoxLayout::writeCGNSZoneLinkGrid");
+  a_indexZoneOffset = -1;
+  cgsize_t isize[3][g_SpaceDim];
+  // Boundary vertex information (always zero for structured grids)
+  D_EXPR(isize[2][0] = 0,
+         isize[2][1] = 0,
+         isize[2][2] = 0);
+  char zoneName[33];
+  std::string linkPath;
+  int cntZone = 0;
+  for (LayoutIterator lit(*this); lit.ok(); ++lit)
+    {
+      const int globalBoxIndex = (*lit).globalIndex();
+      for (int dir = 0; dir != g_SpaceDim; ++dir)
+        {
+          isize[1][dir] = (*this)[lit].dimensions()[dir];
+          isize[0][dir] = isize[1][dir] + 1;
+        }
+      // Same names as in writeCGNSZoneGrid
+      sprintf(zoneName, "Zone_%06d", ++cntZone);
+      int indexZone;
+      int cgerr = cg_zone_write(a_indexFile, a_indexBase, zoneName, *isize,
+                                Structured, &indexZone);
+      if (cgerr) return globalBoxIndex+1;
+      if (a_indexZoneOffset < 0)
+        {
+          a_indexZoneOffset = indexZone - globalBoxIndex;
+        }
+      CH_assert(indexZone == (globalBoxIndex + a_indexZoneOffset));
+      cgerr = cg_goto(a_indexFile, a_indexBase, "Zone_t", indexZone, "end");
+      if (cgerr) return globalBoxIndex+1;
+      linkPath = std::string("/") + a_baseName + '/' + zoneName +
+        "/GridCoordinates";
+      cgerr = cg_link_write("GridCoordinates", a_gridFileName,
+                            linkPath.c_str());
+      if (cgerr) return globalBoxIndex+1;
+    }
+  return 0;
+}
 #endif  /* CGNS */
 
 /*--------------------------------------------------------------------*/
 //  Initialize MPI
-/** Any application or test using MPI must call this routine first
+/** Any application or test using MPI must call this routine first.
+ *  The provided thread support may be less than requested (see
+ *  threadSupport()).  Features that require more (the exchange
+ *  progress thread and background plot files require 'multiple') are
+ *  then disabled.
+ *  \param[in]  argc    Number of command-line arguments
+ *  \param[in]  argv    Command-line arguments
+ *  \param[in]  a_required
+ *                      Thread support requested from MPI
  *//*-----------------------------------------------------------------*/
 
 void
-DisjointBoxLayout::initMPI(int argc, const char* argv[])
+DisjointBoxLayout::initMPI(int                 argc,
+                           const char*         argv[],
+                           const ThreadSupport a_required)
 {
 #ifdef USE_MPI
-  MPI_Init(&argc, const_cast<char***>(&argv));
+  int required = MPI_THREAD_SINGLE;
+  switch (a_required)
+    {
+    case ThreadSupport::single:
+      required = MPI_THREAD_SINGLE;
+      break;
+    case ThreadSupport::funneled:
+      required = MPI_THREAD_FUNNELED;
+      break;
+    case ThreadSupport::multiple:
+      required = MPI_THREAD_MULTIPLE;
+      break;
+    }
+  int provided;
+  MPI_Init_thread(&argc, const_cast<char***>(&argv), required, &provided);
+  if (provided >= MPI_THREAD_MULTIPLE)
+    {
+      s_threadSupport = ThreadSupport::multiple;
+    }
+  else if (provided >= MPI_THREAD_FUNNELED)
+    {
+      s_threadSupport = ThreadSupport::funneled;
+    }
+  else
+    {
+      s_threadSupport = ThreadSupport::single;
+    }
   MPI_Comm_size(MPI_COMM_WORLD, &s_numProc);
   MPI_Comm_rank(MPI_COMM_WORLD, &s_procID);
+  // Processes that can share memory
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, s_procID,
+                      MPI_INFO_NULL, &s_nodeComm);
+  {
+    MPI_Group worldGroup;
+    MPI_Group nodeGroup;
+    MPI_Comm_group(MPI_COMM_WORLD, &worldGroup);
+    MPI_Comm_group(s_nodeComm, &nodeGroup);
+    std::vector<int> worldRank(s_numProc);
+    for (int iProc = 0; iProc != s_numProc; ++iProc)
+      {
+        worldRank[iProc] = iProc;
+      }
+    s_nodeRank.resize(s_numProc);
+    MPI_Group_translate_ranks(worldGroup, s_numProc, worldRank.data(),
+                              nodeGroup, s_nodeRank.data());
+    for (int& rank : s_nodeRank)
+      {
+        if (rank == MPI_UNDEFINED) rank = -1;
+      }
+    MPI_Group_free(&nodeGroup);
+    MPI_Group_free(&worldGroup);
+  }
 #ifndef NO_CGNS
   cgp_mpi_comm(MPI_COMM_WORLD);
 #endif
@@ -404,13 +1379,25 @@ DisjointBoxLayout::initMPI(int argc, const char* argv[])
 /*--------------------------------------------------------------------*/
 //  Finalize MPI
 /** Any application or test using MPI must call this routine when
- *  finished with MPI
+ *  finished with MPI.  If timing is enabled (see TimerRegistry), a
+ *  report of all timed regions is written to std::cout.
  *//*-----------------------------------------------------------------*/
 
 void
 DisjointBoxLayout::finalizeMPI()
 {
 #ifdef USE_MPI
+  ExchangeProgress::stop();
+#endif
+  // Cached copiers may hold persistent requests
+  CopierCache::clear();
+  if (TimerRegistry::enabled())
+    {
+      TimerRegistry::report(std::cout);
+    }
+#ifdef USE_MPI
+  Reduction::finalizeMPI();
+  MPI_Comm_free(&s_nodeComm);
   MPI_Finalize();
 #endif
 }
@@ -0,0 +1,237 @@
+
+/******************************************************************************/
+/**
+ * \file ExchangeProgress.cpp
+ *
+ * \brief Non-inline definitions for classes in ExchangeProgress.H
+ *
+ *//*+*************************************************************************/
+
+#ifdef USE_MPI
+
+#include <algorithm>
+
+#include "DisjointBoxLayout.H"
+#include "ExchangeProgress.H"
+
+
+/*******************************************************************************
+ *
+ * Class ExchangeProgress::Job: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Constructor
+/** \param[in]  a_requests
+ *                      Requests of the exchange.  Even indices are
+ *                      sends and odd indices are receives.
+ *  \param[in]  a_numRequest
+ *                      Number of requests
+ *  \param[in]  a_unpack
+ *                      Called by the progress thread with the request
+ *                      index of each completed receive
+ *//*-----------------------------------------------------------------*/
+
+ExchangeProgress::Job::Job(MPI_Request*                   a_requests,
+                           const int                      a_numRequest,
+                           std::function<void(const int)> a_unpack)
+  :
+  m_requests(a_requests),
+  m_numRequest(a_numRequest),
+  m_unpack(std::move(a_unpack)),
+  m_done(false),
+  m_status(0)
+{
+  m_arrived.reserve(a_numRequest/2);
+}
+
+/*--------------------------------------------------------------------*/
+//  Test for completed requests and unpack receives
+/** Only called by the progress thread
+ *  \return             T - all requests have completed (or there was
+ *                          an error)
+ *//*-----------------------------------------------------------------*/
+
+bool
+ExchangeProgress::Job::test()
+{
+  while (true)
+    {
+      int ridx;
+      int flag;
+      const int mpierr = MPI_Testany(m_numRequest, m_requests, &ridx, &flag,
+                                     MPI_STATUS_IGNORE);
+      if (mpierr || (flag && ridx == MPI_UNDEFINED))
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_status = mpierr;
+          m_done = true;
+          m_cond.notify_all();
+          return true;
+        }
+      if (!flag) return false;         // Nothing new has arrived
+      if (ridx & 1)  // This is a receive (has odd request index)
+        {
+          m_unpack(ridx);
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_arrived.push_back(ridx);
+        }
+    }
+}
+
+
+/*******************************************************************************
+ *
+ * Class ExchangeProgress: member definitions
+ *
+ ******************************************************************************/
+
+bool ExchangeProgress::s_enabled = true;
+
+/*--------------------------------------------------------------------*/
+//  Default constructor
+/*--------------------------------------------------------------------*/
+
+ExchangeProgress::ExchangeProgress()
+  :
+  m_quit(false)
+{
+}
+
+/*--------------------------------------------------------------------*/
+//  Destructor (stops the thread)
+/*--------------------------------------------------------------------*/
+
+ExchangeProgress::~ExchangeProgress()
+{
+  stopThread();
+}
+
+/*--------------------------------------------------------------------*/
+//  The single instance
+/*--------------------------------------------------------------------*/
+
+ExchangeProgress&
+ExchangeProgress::instance()
+{
+  static ExchangeProgress s_instance;
+  return s_instance;
+}
+
+/*--------------------------------------------------------------------*/
+//  Is the progress thread used by exchanges?
+/** \return             T - enabled (see setEnabled) and MPI provides
+ *                          MPI_THREAD_MULTIPLE
+ *//*-----------------------------------------------------------------*/
+
+bool
+ExchangeProgress::enabled()
+{
+  return s_enabled && (DisjointBoxLayout::threadSupport() ==
+                       DisjointBoxLayout::ThreadSupport::multiple);
+}
+
+/*--------------------------------------------------------------------*/
+//  Submit the requests of an exchange
+/** The requests must already be started.  The thread is started if
+ *  required.
+ *  \param[in]  a_requests
+ *                      Requests of the exchange (see Job::Job)
+ *  \param[in]  a_numRequest
+ *                      Number of requests
+ *  \param[in]  a_unpack
+ *                      Unpacks a receive given the request index
+ *  \return             The job.  Use Job::wait before any further use
+ *                      of the requests.
+ *//*-----------------------------------------------------------------*/
+
+std::shared_ptr<ExchangeProgress::Job>
+ExchangeProgress::submit(MPI_Request*                   a_requests,
+                         const int                      a_numRequest,
+                         std::function<void(const int)> a_unpack)
+{
+  ExchangeProgress& progress = instance();
+  auto job = std::make_shared<Job>(a_requests,
+                                   a_numRequest,
+                                   std::move(a_unpack));
+  {
+    std::lock_guard<std::mutex> lock(progress.m_mutex);
+    if (!progress.m_thread.joinable())
+      {
+        progress.m_thread = std::thread(&ExchangeProgress::run, &progress);
+      }
+    progress.m_jobs.push_back(job);
+  }
+  progress.m_cond.notify_all();
+  return job;
+}
+
+/*--------------------------------------------------------------------*/
+//  Stop the thread (waits for outstanding jobs)
+/** The thread is restarted by the next submission
+ *//*-----------------------------------------------------------------*/
+
+void
+ExchangeProgress::stop()
+{
+  instance().stopThread();
+}
+
+/*--------------------------------------------------------------------*/
+//  Stop the thread of this instance
+/*--------------------------------------------------------------------*/
+
+void
+ExchangeProgress::stopThread()
+{
+  if (!m_thread.joinable()) return;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_quit = true;
+  }
+  m_cond.notify_all();
+  m_thread.join();
+  m_quit = false;
+}
+
+/*--------------------------------------------------------------------*/
+//  Body of the progress thread
+/** Polls all outstanding jobs in turn until they are done, yielding
+ *  between passes.  Sleeps while there are no jobs and exits once
+ *  m_quit is set and no jobs remain.
+ *//*-----------------------------------------------------------------*/
+
+void
+ExchangeProgress::run()
+{
+  std::vector<std::shared_ptr<Job> > jobs;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true)
+    {
+      m_cond.wait(lock, [this]{ return !m_jobs.empty() || m_quit; });
+      if (m_jobs.empty()) return;
+      jobs = m_jobs;
+      lock.unlock();
+      for (auto& job : jobs)
+        {
+          if (!job->test()) job.reset();  // Keep only the jobs now done
+        }
+      lock.lock();
+      for (const auto& job : jobs)
+        {
+          if (job)
+            {
+              m_jobs.erase(std::find(m_jobs.begin(), m_jobs.end(), job));
+            }
+        }
+      if (!m_jobs.empty())
+        {
+          lock.unlock();
+          std::this_thread::yield();
+          lock.lock();
+        }
+    }
+}
+
+#endif  /* USE_MPI */
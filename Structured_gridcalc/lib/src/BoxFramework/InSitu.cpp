@@ -0,0 +1,341 @@
+
+/******************************************************************************/
+/**
+ * \file InSitu.cpp
+ *
+ * \brief Non-inline definitions for classes in InSitu.H
+ *
+ *//*+*************************************************************************/
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
+#include "Stopwatch.H"
+#include "InSitu.H"
+
+
+/*******************************************************************************
+ *
+ * Class InSitu::TimeSeries: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Constructor
+/** The file is created (replacing any existing file) with the first
+ *  flush.
+ *  \param[in]  a_fileName
+ *                      Name of the file
+ *  \param[in]  a_columnNames
+ *                      Names of the values in each row
+ *  \param[in]  a_bufferSize
+ *                      Rows buffered before they are written
+ *//*-----------------------------------------------------------------*/
+
+InSitu::TimeSeries::TimeSeries(const std::string&              a_fileName,
+                               const std::vector<std::string>& a_columnNames,
+                               const int                       a_bufferSize)
+  :
+  m_fileName(a_fileName),
+  m_columnNames(a_columnNames),
+  m_bufferSize(a_bufferSize),
+  m_started(false)
+{
+  CH_assert(m_bufferSize > 0);
+  m_iteration.reserve(m_bufferSize);
+  m_values.reserve(m_bufferSize*numColumn());
+}
+
+/*--------------------------------------------------------------------*/
+//  Destructor
+/*--------------------------------------------------------------------*/
+
+InSitu::TimeSeries::~TimeSeries()
+{
+  flush();
+}
+
+/*--------------------------------------------------------------------*/
+//  Record a row
+/** Values are usually the result of a collective (e.g., sample) and
+ *  are the same on all processes.  Only process 0 buffers them.
+ *  \param[in]  a_iteration
+ *                      Iteration of the row
+ *  \param[in]  a_values
+ *                      One value for each column
+ *  \return             Status of the flush if the buffer was full,
+ *                      otherwise 0
+ *//*-----------------------------------------------------------------*/
+
+int
+InSitu::TimeSeries::record(const int                a_iteration,
+                           const std::vector<Real>& a_values)
+{
+  CH_assert((int)a_values.size() == numColumn());
+  if (DisjointBoxLayout::procID() != 0) return 0;
+  m_iteration.push_back(a_iteration);
+  m_values.insert(m_values.end(), a_values.begin(), a_values.end());
+  if ((int)m_iteration.size() >= m_bufferSize)
+    {
+      return flush();
+    }
+  return 0;
+}
+
+/*--------------------------------------------------------------------*/
+//  Append buffered rows to the file
+/** The first flush writes a header with the column names.
+ *  \return             0 on success, -1 if the file could not be
+ *                      written (the rows are discarded)
+ *//*-----------------------------------------------------------------*/
+
+int
+InSitu::TimeSeries::flush()
+{
+  if (DisjointBoxLayout::procID() != 0) return 0;
+  if (m_iteration.empty() && m_started) return 0;
+  std::ofstream file(m_fileName.c_str(),
+                     (m_started) ? std::ios::app : std::ios::trunc);
+  int status = 0;
+  if (file)
+    {
+      file << std::setprecision(std::numeric_limits<Real>::max_digits10);
+      if (!m_started)
+        {
+          file << "# iteration";
+          for (const std::string& name : m_columnNames)
+            {
+              file << ' ' << name;
+            }
+          file << '\n';
+          m_started = true;
+        }
+      const int numCol = numColumn();
+      for (int iRow = 0, iRow_end = m_iteration.size(); iRow != iRow_end;
+           ++iRow)
+        {
+          file << m_iteration[iRow];
+          for (int iCol = 0; iCol != numCol; ++iCol)
+            {
+              file << ' ' << m_values[iRow*numCol + iCol];
+            }
+          file << '\n';
+        }
+      if (!file) status = -1;
+    }
+  else
+    {
+      status = -1;
+    }
+  m_iteration.clear();
+  m_values.clear();
+  return status;
+}
+
+
+/*******************************************************************************
+ *
+ * Class InSitu: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Default constructor
+/*--------------------------------------------------------------------*/
+
+InSitu::InSitu()
+{ }
+
+/*--------------------------------------------------------------------*/
+//  Register a stage
+/** \param[in]  a_name  Name of the stage
+ *  \param[in]  a_interval
+ *                      Iterations between runs (> 0)
+ *  \param[in]  a_callback
+ *                      Function to run.  The argument is the
+ *                      iteration.
+ *  \param[in]  a_offset
+ *                      First iteration at which the stage runs
+ *  \return             Index of the stage
+ *//*-----------------------------------------------------------------*/
+
+int
+InSitu::add(const std::string& a_name,
+            const int          a_interval,
+            const Callback&    a_callback,
+            const int          a_offset)
+{
+  CH_assert(a_interval > 0);
+  CH_assert(a_callback);
+  m_stages.push_back(
+    Stage{ a_name, a_interval, a_offset, a_callback, 0, 0. });
+  return size() - 1;
+}
+
+/*--------------------------------------------------------------------*/
+//  Run the stages due at an iteration
+/** Stages run in order of registration.  Collective if any stage is.
+ *  \param[in]  a_iteration
+ *                      Current iteration
+ *  \return             Number of stages run
+ *//*-----------------------------------------------------------------*/
+
+int
+InSitu::run(const int a_iteration)
+{
+  int numRun = 0;
+  for (int idx = 0, idx_end = size(); idx != idx_end; ++idx)
+    {
+      if (!due(idx, a_iteration)) continue;
+      Stage& stage = m_stages[idx];
+      Stopwatch<std::chrono::steady_clock> stopwatch;
+      stopwatch.start();
+      stage.m_callback(a_iteration);
+      stopwatch.stop();
+      stage.m_time += stopwatch.time();
+      ++stage.m_numRun;
+      ++numRun;
+    }
+  return numRun;
+}
+
+/*--------------------------------------------------------------------*/
+//  Sum values over all processes
+/** Collective over all processes.
+ *  \param[in]  a_values
+ *                      Values of this process
+ *  \param[out] a_values
+ *                      Sums on all processes
+ *//*-----------------------------------------------------------------*/
+
+void
+InSitu::allreduceSum(std::vector<Real>& a_values)
+{
+#ifdef USE_MPI
+  if (a_values.empty()) return;
+  const int mpierr = MPI_Allreduce(MPI_IN_PLACE,
+                                   a_values.data(),
+                                   (int)a_values.size(),
+                                   BXFR_MPI_REAL,
+                                   MPI_SUM,
+                                   MPI_COMM_WORLD);
+  if (mpierr)
+    {
+      std::cout << "Error in in-situ reduction on process "
+                << DisjointBoxLayout::procID() << std::endl;
+      abort();
+    }
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+//  Name of a product file
+/** \param[in]  a_base  Base of the name
+ *  \param[in]  a_iteration
+ *                      Iteration of the product
+ *  \param[in]  a_numDigit
+ *                      Digits for the iteration
+ *  \return             <base><iteration>.dat
+ *//*-----------------------------------------------------------------*/
+
+std::string
+InSitu::fileName(const std::string& a_base,
+                 const int          a_iteration,
+                 const int          a_numDigit)
+{
+  std::ostringstream fileName;
+  fileName << a_base << std::setw(a_numDigit) << std::setfill('0')
+           << a_iteration << ".dat";
+  return fileName.str();
+}
+
+/*--------------------------------------------------------------------*/
+//  Write a product of sample
+/** Only process 0 writes.  The file is text with a header giving the
+ *  coarsened region, followed by a row for each coarse cell with its
+ *  index and the value of each component.
+ *  \param[in]  a_fileName
+ *                      Name of the file
+ *  \param[in]  a_region
+ *                      Region given to sample
+ *  \param[in]  a_ratio Ratio given to sample
+ *  \param[in]  a_numComp
+ *                      Number of components given to sample
+ *  \param[in]  a_result
+ *                      Result of sample
+ *  \return             0 on success, -1 if the file could not be
+ *                      written
+ *//*-----------------------------------------------------------------*/
+
+int
+InSitu::writeSample(const std::string&       a_fileName,
+                    const Box&               a_region,
+                    const int                a_ratio,
+                    const int                a_numComp,
+                    const std::vector<Real>& a_result)
+{
+  const Box crRegion = Box(a_region).coarsen(a_ratio);
+  const int crSize = crRegion.size();
+  CH_assert((int)a_result.size() == a_numComp*crSize);
+  if (DisjointBoxLayout::procID() != 0) return 0;
+  std::ofstream file(a_fileName.c_str());
+  if (!file) return -1;
+  file << std::setprecision(std::numeric_limits<Real>::max_digits10);
+  file << "# region " << crRegion << " ratio " << a_ratio << " ncomp "
+       << a_numComp << '\n';
+  int idx = 0;
+  MD_BOXLOOP(crRegion, i)
+    {
+      file << D_TERM(i0, << ' ' << i1, << ' ' << i2);
+      for (int iComp = 0; iComp != a_numComp; ++iComp)
+        {
+          file << ' ' << a_result[iComp*crSize + idx];
+        }
+      file << '\n';
+      ++idx;
+    }
+  return (file) ? 0 : -1;
+}
+
+/*--------------------------------------------------------------------*/
+//  Write a product of histogram
+/** Only process 0 writes.  The file is text with a row for each bin
+ *  giving its lower bound, upper bound, and count.
+ *  \param[in]  a_fileName
+ *                      Name of the file
+ *  \param[in]  a_lo    Lower bound given to histogram
+ *  \param[in]  a_hi    Upper bound given to histogram
+ *  \param[in]  a_count Result of histogram
+ *  \return             0 on success, -1 if the file could not be
+ *                      written
+ *//*-----------------------------------------------------------------*/
+
+int
+InSitu::writeHistogram(const std::string&       a_fileName,
+                       const Real               a_lo,
+                       const Real               a_hi,
+                       const std::vector<Real>& a_count)
+{
+  if (DisjointBoxLayout::procID() != 0) return 0;
+  std::ofstream file(a_fileName.c_str());
+  if (!file) return -1;
+  file << std::setprecision(std::numeric_limits<Real>::max_digits10);
+  file << "# lo hi count\n";
+  const int numBin = a_count.size();
+  const Real width = (a_hi - a_lo)/numBin;
+  for (int iBin = 0; iBin != numBin; ++iBin)
+    {
+      file << a_lo + iBin*width << ' ' << a_lo + (iBin + 1)*width << ' '
+           << a_count[iBin] << '\n';
+    }
+  return (file) ? 0 : -1;
+}
@@ -0,0 +1,287 @@
+
+/******************************************************************************/
+/**
+ * \file LayoutCopier.cpp
+ *
+ * \brief Non-inline definitions for classes in LayoutCopier.H
+ *
+ *//*+*************************************************************************/
+
+#include <algorithm>
+#include <map>
+
+#include "BaseFabMacros.H"
+#include "LayoutCopier.H"
+#include "LayoutIterator.H"
+#include "TimerRegistry.H"
+
+
+/*==============================================================================
+ * Local helpers
+ *============================================================================*/
+
+namespace
+{
+
+/*--------------------------------------------------------------------*/
+//  Apply a function to the global index of each box of a layout that
+//  overlaps a region
+/** \param[in]  a_dbl   Layout of boxes
+ *  \param[in]  a_region
+ *                      Region which must be inside the problem domain
+ *  \param[in]  a_func  Function taking the global index of the box
+ *//*-----------------------------------------------------------------*/
+
+template <typename F>
+void
+forEachOverlap(const DisjointBoxLayout& a_dbl,
+               const Box&               a_region,
+               const F&                 a_func)
+{
+  if (a_region.isEmpty()) return;
+  std::vector<int> idxOverlap;
+  a_dbl.overlaps(a_region, idxOverlap);
+  for (const int idx : idxOverlap)
+    {
+      a_func(idx);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Order items the same way on the sending and receiving processes
+/*--------------------------------------------------------------------*/
+
+bool
+itemLess(const LayoutCopier::Item& a_x, const LayoutCopier::Item& a_y)
+{
+  if (a_x.m_dstIdx != a_y.m_dstIdx) return a_x.m_dstIdx < a_y.m_dstIdx;
+  if (a_x.m_srcIdx != a_y.m_srcIdx) return a_x.m_srcIdx < a_y.m_srcIdx;
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      if (a_x.m_shift[dir] != a_y.m_shift[dir])
+        {
+          return a_x.m_shift[dir] < a_y.m_shift[dir];
+        }
+    }
+  return false;
+}
+
+/*--------------------------------------------------------------------*/
+//  Sort the items of each process and assign offsets in the messages
+/*--------------------------------------------------------------------*/
+
+void
+buildMessages(std::map<int, std::vector<LayoutCopier::Item> >& a_itemByProc,
+              std::vector<LayoutCopier::RankMessage>&         a_messages)
+{
+  a_messages.clear();
+  a_messages.reserve(a_itemByProc.size());
+  for (auto& procItem : a_itemByProc)
+    {
+      a_messages.emplace_back();
+      LayoutCopier::RankMessage& message = a_messages.back();
+      message.m_procID = procItem.first;
+      message.m_item = std::move(procItem.second);
+      std::sort(message.m_item.begin(), message.m_item.end(), itemLess);
+      message.m_numCell = 0;
+      for (LayoutCopier::Item& item : message.m_item)
+        {
+          item.m_offset = message.m_numCell;
+          message.m_numCell += item.m_regionDst.size();
+        }
+    }
+}
+
+}  // anonymous namespace
+
+
+/*******************************************************************************
+ *
+ * Class LayoutCopier: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Default constructor
+/*--------------------------------------------------------------------*/
+
+LayoutCopier::LayoutCopier()
+  :
+  m_srcTag(0),
+  m_dstTag(0),
+  m_dstGhost(0)
+{
+}
+
+/*--------------------------------------------------------------------*/
+//  Constructor
+/** \param[in]  a_src   Layout of the source
+ *  \param[in]  a_dst   Layout of the destination
+ *  \param[in]  a_dstGhost
+ *                      Number of ghost cells of the destination to
+ *                      fill (default 0)
+ *  \param[in]  a_periodic
+ *                      Which directions are periodic (e.g., PeriodicX
+ *                      | PeriodicY).  Ghost cells of the destination
+ *                      outside the domain are filled from periodic
+ *                      images of the source.  Default is no periodic.
+ *//*-----------------------------------------------------------------*/
+
+LayoutCopier::LayoutCopier(const DisjointBoxLayout& a_src,
+                           const DisjointBoxLayout& a_dst,
+                           const int                a_dstGhost,
+                           const unsigned           a_periodic)
+{
+  define(a_src, a_dst, a_dstGhost, a_periodic);
+}
+
+/*--------------------------------------------------------------------*/
+//  Weak construction
+/** \param[in]  a_src   Layout of the source
+ *  \param[in]  a_dst   Layout of the destination
+ *  \param[in]  a_dstGhost
+ *                      Number of ghost cells of the destination to
+ *                      fill (default 0)
+ *  \param[in]  a_periodic
+ *                      Which directions are periodic (default none)
+ *//*-----------------------------------------------------------------*/
+
+void
+LayoutCopier::define(const DisjointBoxLayout& a_src,
+                     const DisjointBoxLayout& a_dst,
+                     const int                a_dstGhost,
+                     const unsigned           a_periodic)
+{
+  TIMED_REGION(timerDefine, "LayoutCopier::define");
+  const Box& domain = a_src.problemDomain();
+  CH_assert(domain == a_dst.problemDomain());
+  CH_assert(a_dstGhost >= 0);
+  m_srcTag = a_src.tag();
+  m_dstTag = a_dst.tag();
+  m_dstGhost = a_dstGhost;
+  m_localItem.clear();
+
+  // Shifts to periodic images (including no shift)
+  std::vector<IntVect> shifts;
+  {
+    IntVect lo(IntVect::Zero);
+    IntVect hi(IntVect::Zero);
+    for (int dir = 0; dir != g_SpaceDim; ++dir)
+      {
+        if ((a_periodic & (1<<dir)) && a_dstGhost > 0)
+          {
+            lo[dir] = -1;
+            hi[dir] = 1;
+          }
+      }
+    const IntVect domainSize = domain.dimensions();
+    const Box shiftBox(lo, hi);
+    MD_BOXLOOP(shiftBox, i)
+      {
+        shifts.push_back(IntVect(D_DECL(i0, i1, i2))*domainSize);
+      }
+  }
+
+  std::map<int, std::vector<Item> > recvItem;
+  std::map<int, std::vector<Item> > sendItem;
+
+//--Destination boxes on this process receive from the source boxes they
+//--overlap
+
+  for (DataIterator dit(a_dst); dit.ok(); ++dit)
+    {
+      const int dstIdx = (*dit).globalIndex();
+      Box dstBox = a_dst[dit];
+      dstBox.grow(a_dstGhost);
+      for (const IntVect& shift : shifts)
+        {
+          Box region(dstBox);
+          region.shift(-shift);
+          region &= domain;
+          forEachOverlap(
+            a_src, region,
+            [&]
+            (const int a_srcIdx)
+            {
+              Item item;
+              item.m_srcIdx = a_srcIdx;
+              item.m_dstIdx = dstIdx;
+              item.m_srcLocal = a_src.localIndex(a_srcIdx);
+              item.m_dstLocal = (*dit).localIndex();
+              item.m_regionDst = region;
+              item.m_regionDst &= a_src.getLinear(a_srcIdx).box;
+              item.m_regionDst.shift(shift);
+              item.m_shift = shift;
+              item.m_offset = 0;
+              if (item.m_srcLocal >= 0)
+                {
+                  m_localItem.push_back(item);
+                }
+              else
+                {
+                  recvItem[a_src.getLinear(a_srcIdx).proc].push_back(item);
+                }
+            });
+        }
+    }
+
+//--Source boxes on this process send to the remote destination boxes they
+//--overlap
+
+  for (DataIterator sit(a_src); sit.ok(); ++sit)
+    {
+      const int srcIdx = (*sit).globalIndex();
+      for (const IntVect& shift : shifts)
+        {
+          Box srcImage = a_src[sit];
+          srcImage.shift(shift);
+          Box region(srcImage);
+          region.grow(a_dstGhost);
+          region &= domain;
+          forEachOverlap(
+            a_dst, region,
+            [&]
+            (const int a_dstIdx)
+            {
+              const int dstProc = a_dst.getLinear(a_dstIdx).proc;
+              if (dstProc == DisjointBoxLayout::procID()) return;
+              Item item;
+              item.m_srcIdx = srcIdx;
+              item.m_dstIdx = a_dstIdx;
+              item.m_srcLocal = (*sit).localIndex();
+              item.m_dstLocal = -1;
+              item.m_regionDst = a_dst.getLinear(a_dstIdx).box;
+              item.m_regionDst.grow(a_dstGhost);
+              item.m_regionDst &= srcImage;
+              item.m_shift = shift;
+              item.m_offset = 0;
+              if (!item.m_regionDst.isEmpty())
+                {
+                  sendItem[dstProc].push_back(item);
+                }
+            });
+        }
+    }
+
+  buildMessages(recvItem, m_recv);
+  buildMessages(sendItem, m_send);
+}
+
+/*--------------------------------------------------------------------*/
+//  Number of cells copied into boxes on this process
+/*--------------------------------------------------------------------*/
+
+long long
+LayoutCopier::numCellRecv() const
+{
+  long long numCell = 0;
+  for (const Item& item : m_localItem)
+    {
+      numCell += item.m_regionDst.size();
+    }
+  for (const RankMessage& message : m_recv)
+    {
+      numCell += message.m_numCell;
+    }
+  return numCell;
+}
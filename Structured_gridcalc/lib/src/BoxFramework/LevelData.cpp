@@ -70,6 +70,7 @@ LevelData<BaseFab<Real> >::writeCGNSSolData(
   const int                a_indexZoneOffset,
   const char *const *const a_varNames) const
 {
+  TIMED_REGION(timerWrite, "LevelData::writeCGNSSolData");
   int cgerr;
   std::vector<CGNSIndices> localCGNSIndices(m_disjointBoxLayout.localSize());
 
@@ -152,16 +153,23 @@ LevelData<BaseFab<Real> >::writeCGNSSolData(
       // at 1, not 0.
       const IntVect boxdim = m_disjointBoxLayout[dit].dimensions();
       const BaseFab<Real>& fab = this->operator[](dit);
-      const IntVect fabdim = fab.box().dimensions();
+      // CGNS reads each component as a separate array
+      CH_assert(fab.layout() == BaseFab<Real>::Layout::planar);
+      // The size and range of data in memory.  Rows may be padded before
+      // the first cell and after the last.
+      int fabmemdim[g_SpaceDim];
+      int fabmemrmin[g_SpaceDim];
+      int fabmemrmax[g_SpaceDim];
+      fab.memRange(m_disjointBoxLayout[dit], fabmemdim, fabmemrmin,
+                   fabmemrmax);
       for (int dir = 0; dir != g_SpaceDim; ++dir)
         {
           // The range of the data in the CGNS file (only contains core grid)
           rmin[dir]    = 1;
           rmax[dir]    = boxdim[dir];
-          // The size and range of data in memory
-          memdim[dir]  = fabdim[dir];
-          memrmin[dir] = 1 + m_nghost;
-          memrmax[dir] = memdim[dir] - m_nghost;
+          memdim[dir]  = fabmemdim[dir];
+          memrmin[dir] = fabmemrmin[dir];
+          memrmax[dir] = fabmemrmax[dir];
         }
       for (int iComp = 0; iComp != ncomp(); ++iComp)
         {
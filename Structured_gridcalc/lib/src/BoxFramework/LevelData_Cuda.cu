@@ -0,0 +1,302 @@
+
+/******************************************************************************/
+/**
+ * \file LevelData_Cuda.cu
+ *
+ * \brief Isolated Cuda drivers and kernels for exchanging device-resident
+ *        LevelData
+ *
+ *//*+*************************************************************************/
+
+#include "CudaFab.H"
+#include "LevelData_Cuda.H"
+
+/*
+ * The drivers receive BaseFabs but BaseFab.H cannot be compiled by nvcc.
+ * Like WavePatch_Cuda, they are reinterpreted as BaseFabData (which has the
+ * same layout) and aliased on the device with CudaFab.  Buffers use the same
+ * format as BaseFab::linearOut so messages packed on the host and on the
+ * device are interchangeable.
+ */
+
+//--Components to move in a kernel
+
+struct CompList
+{
+  int m_num;                          ///< Number of components
+  int m_comp[LevelData_Cuda::g_maxComp];
+                                      ///< Component indices
+};
+
+/*--------------------------------------------------------------------*/
+/// Select components in a range using bit flags
+/** \param[in]  a_startComp
+ *                      Start of range of components
+ *  \param[in]  a_endComp
+ *                      One past end of range of components
+ *  \param[in]  a_compFlags
+ *                      Components are selected based on these bits
+ *                      (see BaseFab::linearOut)
+ *  \return             List of components
+ *//*-----------------------------------------------------------------*/
+
+static CompList
+selectComps(const int a_startComp, const int a_endComp,
+            const unsigned a_compFlags)
+{
+  CompList comps;
+  comps.m_num = 0;
+  for (int ic = a_startComp; ic != a_endComp; ++ic)
+    {
+      if ((ic >= (int)(8*sizeof(unsigned))) || (a_compFlags & (1u << ic)))
+        {
+          CH_assert(comps.m_num < LevelData_Cuda::g_maxComp);
+          comps.m_comp[comps.m_num++] = ic;
+        }
+    }
+  return comps;
+}
+
+/*--------------------------------------------------------------------*/
+/// Number of blocks to cover a number of elements
+/*--------------------------------------------------------------------*/
+
+static int
+numBlk(const int a_numElem)
+{
+  const int num = (a_numElem + LevelData_Cuda::g_numThr - 1)/
+    LevelData_Cuda::g_numThr;
+  return (num < LevelData_Cuda::g_maxBlk) ? num : LevelData_Cuda::g_maxBlk;
+}
+
+/*--------------------------------------------------------------------*/
+/// Pack a region of a fab into a buffer
+/** \param[in]  a_fab   Device alias of the fab
+ *  \param[out] a_buffer
+ *                      Component-planar buffer
+ *  \param[in]  a_region
+ *                      Region to pack
+ *  \param[in]  a_comps Components to pack
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+__global__ void
+kernelPack(const CudaFab<T> a_fab,
+           T *const         a_buffer,
+           const Box        a_region,
+           const CompList   a_comps)
+{
+  const int numCell = a_region.size();
+  const int numElem = numCell*a_comps.m_num;
+  for (int idx = blockIdx.x*blockDim.x + threadIdx.x; idx < numElem;
+       idx += gridDim.x*blockDim.x)
+    {
+      const int iBufC = idx/numCell;
+      IntVect iv;
+      a_region.linToVec(idx - iBufC*numCell, iv);
+      a_buffer[idx] = a_fab(iv, a_comps.m_comp[iBufC]);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+/// Unpack a buffer into a region of a fab
+/** \param[in]  a_fab   Device alias of the fab
+ *  \param[in]  a_buffer
+ *                      Component-planar buffer
+ *  \param[in]  a_region
+ *                      Region to unpack
+ *  \param[in]  a_comps Components to unpack
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+__global__ void
+kernelUnpack(CudaFab<T>     a_fab,
+             const T *const a_buffer,
+             const Box      a_region,
+             const CompList a_comps)
+{
+  const int numCell = a_region.size();
+  const int numElem = numCell*a_comps.m_num;
+  for (int idx = blockIdx.x*blockDim.x + threadIdx.x; idx < numElem;
+       idx += gridDim.x*blockDim.x)
+    {
+      const int iBufC = idx/numCell;
+      IntVect iv;
+      a_region.linToVec(idx - iBufC*numCell, iv);
+      a_fab(iv, a_comps.m_comp[iBufC]) = a_buffer[idx];
+    }
+}
+
+/*--------------------------------------------------------------------*/
+/// Copy between regions of fabs
+/** \param[in]  a_dst   Device alias of the destination fab
+ *  \param[in]  a_dstRegion
+ *                      Region to copy to
+ *  \param[in]  a_src   Device alias of the source fab
+ *  \param[in]  a_shift Shift from destination to source region
+ *  \param[in]  a_comps Components to copy
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+__global__ void
+kernelCopy(CudaFab<T>       a_dst,
+           const Box        a_dstRegion,
+           const CudaFab<T> a_src,
+           const IntVect    a_shift,
+           const CompList   a_comps)
+{
+  const int numCell = a_dstRegion.size();
+  const int numElem = numCell*a_comps.m_num;
+  for (int idx = blockIdx.x*blockDim.x + threadIdx.x; idx < numElem;
+       idx += gridDim.x*blockDim.x)
+    {
+      const int iC = idx/numCell;
+      IntVect iv;
+      a_dstRegion.linToVec(idx - iC*numCell, iv);
+      IntVect ivSrc(iv);
+      ivSrc += a_shift;
+      a_dst(iv, a_comps.m_comp[iC]) = a_src(ivSrc, a_comps.m_comp[iC]);
+    }
+}
+
+
+/*******************************************************************************
+ *
+ * Drivers
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Driver to pack a region of a fab into a buffer on the device
+/** \param[in]  a_fab   Fab (data must be on the device)
+ *  \param[out] a_buffer
+ *                      Buffer on the device
+ *  \param[in]  a_region
+ *                      Region to pack
+ *  \param[in]  a_startComp
+ *                      Start of range of components
+ *  \param[in]  a_endComp
+ *                      One past end of range of components
+ *  \param[in]  a_compFlags
+ *                      Components are selectively packed based on
+ *                      these bits (see BaseFab::linearOut)
+ *  \param[in]  a_stream
+ *                      Stream on which to queue the kernel
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+void
+LevelData_Cuda::driverPack(const BaseFab<T>& a_fab,
+                           void *const       a_buffer,
+                           const Box&        a_region,
+                           const int         a_startComp,
+                           const int         a_endComp,
+                           const unsigned    a_compFlags,
+                           cudaStream_t      a_stream)
+{
+  const CudaFab<T> fab(reinterpret_cast<const BaseFabData<T>&>(a_fab));
+  const CompList comps = selectComps(a_startComp, a_endComp, a_compFlags);
+  const int numElem = a_region.size()*comps.m_num;
+  if (numElem == 0) return;
+  kernelPack<T><<<numBlk(numElem), g_numThr, 0, a_stream>>>(
+    fab, static_cast<T*>(a_buffer), a_region, comps);
+}
+
+/*--------------------------------------------------------------------*/
+//  Driver to unpack a buffer on the device into a region of a fab
+/** \param[out] a_fab   Fab (data must be on the device)
+ *  \param[in]  a_buffer
+ *                      Buffer on the device
+ *  \param[in]  a_region
+ *                      Region to unpack
+ *  \param[in]  a_startComp
+ *                      Start of range of components
+ *  \param[in]  a_endComp
+ *                      One past end of range of components
+ *  \param[in]  a_compFlags
+ *                      Components are selectively unpacked based on
+ *                      these bits (see BaseFab::linearIn)
+ *  \param[in]  a_stream
+ *                      Stream on which to queue the kernel
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+void
+LevelData_Cuda::driverUnpack(BaseFab<T>&       a_fab,
+                             const void *const a_buffer,
+                             const Box&        a_region,
+                             const int         a_startComp,
+                             const int         a_endComp,
+                             const unsigned    a_compFlags,
+                             cudaStream_t      a_stream)
+{
+  const CudaFab<T> fab(reinterpret_cast<const BaseFabData<T>&>(a_fab));
+  const CompList comps = selectComps(a_startComp, a_endComp, a_compFlags);
+  const int numElem = a_region.size()*comps.m_num;
+  if (numElem == 0) return;
+  kernelUnpack<T><<<numBlk(numElem), g_numThr, 0, a_stream>>>(
+    fab, static_cast<const T*>(a_buffer), a_region, comps);
+}
+
+/*--------------------------------------------------------------------*/
+//  Driver to copy between regions of fabs on the device
+/** \param[out] a_dst   Destination fab (data must be on the device)
+ *  \param[in]  a_dstRegion
+ *                      Region to copy to
+ *  \param[in]  a_src   Source fab (data must be on the device)
+ *  \param[in]  a_srcRegion
+ *                      Region to copy from (same size as a_dstRegion)
+ *  \param[in]  a_startComp
+ *                      Start of range of components (same for source
+ *                      and destination)
+ *  \param[in]  a_numComp
+ *                      Number of components
+ *  \param[in]  a_compFlags
+ *                      Components are selectively copied based on
+ *                      these bits (see BaseFab::copy)
+ *  \param[in]  a_stream
+ *                      Stream on which to queue the kernel
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+void
+LevelData_Cuda::driverCopy(BaseFab<T>&       a_dst,
+                           const Box&        a_dstRegion,
+                           const BaseFab<T>& a_src,
+                           const Box&        a_srcRegion,
+                           const int         a_startComp,
+                           const int         a_numComp,
+                           const unsigned    a_compFlags,
+                           cudaStream_t      a_stream)
+{
+  CH_assert(a_dstRegion.dimensions() == a_srcRegion.dimensions());
+  const CudaFab<T> dst(reinterpret_cast<const BaseFabData<T>&>(a_dst));
+  const CudaFab<T> src(reinterpret_cast<const BaseFabData<T>&>(a_src));
+  const CompList comps = selectComps(a_startComp, a_startComp + a_numComp,
+                                     a_compFlags);
+  const int numElem = a_dstRegion.size()*comps.m_num;
+  if (numElem == 0) return;
+  IntVect shift(a_srcRegion.loVect());
+  shift -= a_dstRegion.loVect();
+  kernelCopy<T><<<numBlk(numElem), g_numThr, 0, a_stream>>>(
+    dst, a_dstRegion, src, shift, comps);
+}
+
+//--Explicit instantiations (matching those of BaseFab)
+
+#define LEVELDATA_CUDA_INSTANTIATE(T)                                   \
+  template void LevelData_Cuda::driverPack<T>(                          \
+    const BaseFab<T>&, void *const, const Box&, const int, const int,   \
+    const unsigned, cudaStream_t);                                      \
+  template void LevelData_Cuda::driverUnpack<T>(                        \
+    BaseFab<T>&, const void *const, const Box&, const int, const int,   \
+    const unsigned, cudaStream_t);                                      \
+  template void LevelData_Cuda::driverCopy<T>(                          \
+    BaseFab<T>&, const Box&, const BaseFab<T>&, const Box&, const int,  \
+    const int, const unsigned, cudaStream_t);
+
+LEVELDATA_CUDA_INSTANTIATE(char)
+LEVELDATA_CUDA_INSTANTIATE(int)
+LEVELDATA_CUDA_INSTANTIATE(unsigned)
+LEVELDATA_CUDA_INSTANTIATE(float)
+LEVELDATA_CUDA_INSTANTIATE(double)
@@ -112,3 +112,23 @@ int System::sleep(const double s)
   req.tv_nsec = static_cast<long>((std::fabs(s) - sec)*1.E9);
   return nanosleep(&req, &rem);
 }
+
+
+/*============================================================================*/
+//  Get the name of the host
+/**
+ *  \param[out] a_hostName
+ *                      Name of the host (null terminated, possibly
+ *                      truncated)
+ *  \param[in]  a_len   Length of a_hostName
+ *  \return              0 - Success
+ *                      -1 - Error
+ *//*=========================================================================*/
+
+int System::getHostName(char *const a_hostName, int a_len)
+{
+  if (a_len <= 0) return -1;
+  const int err = gethostname(a_hostName, a_len);
+  a_hostName[a_len-1] = '\0';
+  return (err == 0) ? 0 : -1;
+}
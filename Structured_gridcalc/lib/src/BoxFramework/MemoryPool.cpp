@@ -0,0 +1,168 @@
+
+/******************************************************************************/
+/**
+ * \file MemoryPool.cpp
+ *
+ * \brief Non-inline definitions for classes in MemoryPool.H
+ *
+ *//*+*************************************************************************/
+
+#include <cstdlib>
+#include <new>
+
+#include "Parameters.H"
+#include "LinuxSupport.H"
+#include "MemoryPool.H"
+
+
+/*******************************************************************************
+ *
+ * Class MemoryPool: member definitions
+ *
+ ******************************************************************************/
+
+constexpr std::size_t MemoryPool::s_alignment;
+
+/*--------------------------------------------------------------------*/
+//  Default constructor
+/*--------------------------------------------------------------------*/
+
+MemoryPool::MemoryPool()
+  :
+  m_bytesInUse(0),
+  m_bytesFree(0)
+{
+}
+
+/*--------------------------------------------------------------------*/
+//  Destructor
+/** Blocks still in use are not freed since their owners may yet
+ *  return them
+ *//*-----------------------------------------------------------------*/
+
+MemoryPool::~MemoryPool()
+{
+  for (auto& freeList : m_free)
+    {
+      for (void* ptr : freeList.second)
+        {
+          std::free(ptr);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  The single instance
+/** Constructed on first use so it outlives any static objects that
+ *  allocate from it
+ *//*-----------------------------------------------------------------*/
+
+MemoryPool&
+MemoryPool::instance()
+{
+  static MemoryPool pool;
+  return pool;
+}
+
+/*--------------------------------------------------------------------*/
+//  Allocate a block
+/** \param[in]  a_numBytes
+ *                      Minimum size of the block
+ *  \return             Pointer to the block aligned to s_alignment
+ *  \throw std::bad_alloc
+ *                      If memory cannot be obtained from the system
+ *//*-----------------------------------------------------------------*/
+
+void*
+MemoryPool::allocate(const std::size_t a_numBytes)
+{
+  MemoryPool& pool = instance();
+  const std::size_t numBytes = roundUp((a_numBytes == 0) ? 1 : a_numBytes);
+  void* ptr = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(pool.m_mutex);
+    auto freeList = pool.m_free.find(numBytes);
+    if (freeList != pool.m_free.end() && !freeList->second.empty())
+      {
+        ptr = freeList->second.back();
+        freeList->second.pop_back();
+        pool.m_bytesFree -= numBytes;
+      }
+  }
+  if (ptr == nullptr)
+    {
+      if (System::memalign(&ptr, s_alignment, numBytes) != 0)
+        {
+          throw std::bad_alloc();
+        }
+    }
+  std::lock_guard<std::mutex> lock(pool.m_mutex);
+  pool.m_inUse[ptr] = numBytes;
+  pool.m_bytesInUse += numBytes;
+  return ptr;
+}
+
+/*--------------------------------------------------------------------*/
+//  Return a block to the pool
+/** \param[in]  a_ptr   Block obtained from allocate
+ *//*-----------------------------------------------------------------*/
+
+void
+MemoryPool::deallocate(void *const a_ptr)
+{
+  if (a_ptr == nullptr) return;
+  MemoryPool& pool = instance();
+  std::lock_guard<std::mutex> lock(pool.m_mutex);
+  auto used = pool.m_inUse.find(a_ptr);
+  CH_assert(used != pool.m_inUse.end());
+  const std::size_t numBytes = used->second;
+  pool.m_inUse.erase(used);
+  pool.m_bytesInUse -= numBytes;
+  pool.m_free[numBytes].push_back(a_ptr);
+  pool.m_bytesFree += numBytes;
+}
+
+/*--------------------------------------------------------------------*/
+//  Return all free blocks to the system
+/** Blocks in use are not affected
+ *//*-----------------------------------------------------------------*/
+
+void
+MemoryPool::release()
+{
+  MemoryPool& pool = instance();
+  std::lock_guard<std::mutex> lock(pool.m_mutex);
+  for (auto& freeList : pool.m_free)
+    {
+      for (void* ptr : freeList.second)
+        {
+          std::free(ptr);
+        }
+    }
+  pool.m_free.clear();
+  pool.m_bytesFree = 0;
+}
+
+/*--------------------------------------------------------------------*/
+//  Number of bytes held in blocks that are in use
+/*--------------------------------------------------------------------*/
+
+std::size_t
+MemoryPool::bytesInUse()
+{
+  MemoryPool& pool = instance();
+  std::lock_guard<std::mutex> lock(pool.m_mutex);
+  return pool.m_bytesInUse;
+}
+
+/*--------------------------------------------------------------------*/
+//  Number of bytes held in free blocks
+/*--------------------------------------------------------------------*/
+
+std::size_t
+MemoryPool::bytesFree()
+{
+  MemoryPool& pool = instance();
+  std::lock_guard<std::mutex> lock(pool.m_mutex);
+  return pool.m_bytesFree;
+}
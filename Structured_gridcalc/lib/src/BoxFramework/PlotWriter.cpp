@@ -0,0 +1,518 @@
+
+/******************************************************************************/
+/**
+ * \file PlotWriter.cpp
+ *
+ * \brief Non-inline definitions for classes in PlotWriter.H
+ *
+ *//*+*************************************************************************/
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
+#ifndef NO_CGNS
+#ifdef USE_MPI
+#include "pcgnslib.h"
+#else
+#include "cgnslib.h"
+#endif
+#endif
+
+#include "PlotWriter.H"
+#include "TimerRegistry.H"
+
+
+/*******************************************************************************
+ *
+ * Class PlotWriter: static member initialization
+ *
+ ******************************************************************************/
+
+std::mutex PlotWriter::s_cgnsMutex;
+
+
+namespace
+{
+
+#if defined(USE_MPI) && !defined(NO_CGNS)
+/*--------------------------------------------------------------------*/
+///  Use a communicator for CGNS while in scope
+/**  MPI_COMM_WORLD (see DisjointBoxLayout::initMPI) is restored on
+ *   exit.  Does nothing if the communicator is MPI_COMM_NULL.
+ *//*-----------------------------------------------------------------*/
+
+class CGNSCommScope
+{
+public:
+  CGNSCommScope(const MPI_Comm a_comm)
+    :
+    m_active(a_comm != MPI_COMM_NULL)
+    {
+      if (m_active) cgp_mpi_comm(a_comm);
+    }
+  ~CGNSCommScope()
+    {
+      if (m_active) cgp_mpi_comm(MPI_COMM_WORLD);
+    }
+  CGNSCommScope(const CGNSCommScope&) = delete;
+  CGNSCommScope& operator=(const CGNSCommScope&) = delete;
+private:
+  bool m_active;                      ///< T - a communicator was set
+};
+#endif
+
+/*--------------------------------------------------------------------*/
+//  Copy a box of data into the staging buffer
+/*--------------------------------------------------------------------*/
+
+void
+stageBox(FArrayBox& a_staging, const Box& a_box, const FArrayBox& a_src)
+{
+  a_staging.copy(a_box, a_src);
+}
+
+/*--------------------------------------------------------------------*/
+//  Copy a box of data in another precision into the staging buffer
+/*--------------------------------------------------------------------*/
+
+template <typename S>
+void
+stageBox(FArrayBox& a_staging, const Box& a_box, const BaseFab<S>& a_src)
+{
+  a_staging.convert(a_box, a_src);
+}
+
+}  // anonymous namespace
+
+
+/*******************************************************************************
+ *
+ * Class PlotWriter: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Constructor
+/** \param[in]  a_basePlotName
+ *                      Base name of plot files, including any path.
+ *                      Files are named <base><iteration>.cgns
+ *  \param[in]  a_origin
+ *                      Origin of the problem domain (lower vertex)
+ *  \param[in]  a_dx    Mesh spacing
+ *  \param[in]  a_numDigit
+ *                      Digits for the iteration in file names
+ *  \param[in]  a_async T - write files with a background thread if
+ *                          possible (see async())
+ *                      F - write files synchronously
+ *  With MPI, construction is collective if writing asynchronously.
+ *//*-----------------------------------------------------------------*/
+
+PlotWriter::PlotWriter(const std::string& a_basePlotName,
+                       const IntVect&     a_origin,
+                       const Real         a_dx,
+                       const int          a_numDigit,
+                       const bool         a_async)
+  :
+  m_basePlotName(a_basePlotName),
+  m_origin(a_origin),
+  m_dx(a_dx),
+  m_numDigit(a_numDigit),
+  m_async(a_async),
+  m_numAggregator(0),
+  m_stagingTag(0),
+  m_stagedIteration(-1),
+  m_gridTag(0),
+  m_pending(false),
+  m_quit(false),
+  m_status(0),
+  m_numWritten(0)
+{
+#ifdef USE_MPI
+  m_info = MPI_INFO_NULL;
+  m_comm = MPI_COMM_NULL;
+  int initialized;
+  MPI_Initialized(&initialized);
+  if (m_async && initialized)
+    {
+      // Collective I/O from the writer thread overlaps communication
+      int provided;
+      MPI_Query_thread(&provided);
+      if (provided < MPI_THREAD_MULTIPLE)
+        {
+          m_async = false;
+        }
+      else
+        {
+          MPI_Comm_dup(MPI_COMM_WORLD, &m_comm);
+        }
+    }
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+//  Destructor (waits for any pending write)
+/*--------------------------------------------------------------------*/
+
+PlotWriter::~PlotWriter()
+{
+  if (m_thread.joinable())
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+      }
+      m_cond.notify_all();
+      m_thread.join();
+    }
+#ifdef USE_MPI
+  int finalized;
+  MPI_Finalized(&finalized);
+  if (m_info != MPI_INFO_NULL && !finalized)
+    {
+      MPI_Info_free(&m_info);
+    }
+  if (m_comm != MPI_COMM_NULL && !finalized)
+    {
+      MPI_Comm_free(&m_comm);
+    }
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+//  Stage data and write it to a plot file
+/** Returns once the data is staged if writing asynchronously.  With
+ *  MPI, this is collective.
+ *  \param[in]  a_data  Data to write (only the core cells are
+ *                      written).  The data may be modified as soon as
+ *                      this routine returns.
+ *  \param[in]  a_iteration
+ *                      Iteration used to name the file
+ *  \param[in]  a_varNames
+ *                      Names of variables (a_data.ncomp() of them)
+ *  \return             Status of the previous write if writing
+ *                      asynchronously (errors are reported one write
+ *                      late, see also wait()), otherwise of this write
+ *                      -1 Error
+ *                       0 Success
+ *                      >0 CGNS error
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+int
+PlotWriter::write(const LevelData<BaseFab<T> >& a_data,
+                  const int                     a_iteration,
+                  const char *const *const      a_varNames)
+{
+  TIMED_REGION(timerWrite, "PlotWriter::write");
+  // The staging buffer is only reused once the previous write completes
+  const int status = wait();
+  stage(a_data, a_iteration, a_varNames);
+  if (!m_async)
+    {
+      const int statusWrite = writeStaged();
+      return (status) ? status : statusWrite;
+    }
+  if (!m_thread.joinable())
+    {
+      m_thread = std::thread(&PlotWriter::run, this);
+    }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending = true;
+  }
+  m_cond.notify_all();
+  return status;
+}
+
+/*--------------------------------------------------------------------*/
+//  Wait for any pending write to complete
+/** \return             Status of the last write (see write()).  The
+ *                      status is cleared.
+ *//*-----------------------------------------------------------------*/
+
+int
+PlotWriter::wait()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cond.wait(lock, [this]{ return !m_pending; });
+  const int status = m_status;
+  m_status = 0;
+  return status;
+}
+
+/*--------------------------------------------------------------------*/
+//  Name of a plot file
+/** \param[in]  a_iteration
+ *                      Iteration
+ *  \return             File name
+ *//*-----------------------------------------------------------------*/
+
+std::string
+PlotWriter::plotFileName(const int a_iteration) const
+{
+  std::ostringstream fileName;
+  fileName << m_basePlotName << std::setw(m_numDigit) << std::setfill('0')
+           << a_iteration << ".cgns";
+  return fileName.str();
+}
+
+/*--------------------------------------------------------------------*/
+//  Copy the core cells of data into the staging buffer
+/** The staging buffer is redefined if the layout or number of
+ *  components changes.  Data in storage precision is converted to
+ *  Real.  There must not be a pending write.
+ *  \param[in]  a_data  Data to stage
+ *  \param[in]  a_iteration
+ *                      Iteration of the data
+ *  \param[in]  a_varNames
+ *                      Names of variables
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+void
+PlotWriter::stage(const LevelData<BaseFab<T> >& a_data,
+                  const int                     a_iteration,
+                  const char *const *const      a_varNames)
+{
+  CH_assert(!m_pending);
+  const DisjointBoxLayout& dbl = a_data.disjointBoxLayout();
+  if (m_stagingTag != dbl.tag() || m_staging.ncomp() != a_data.ncomp())
+    {
+      m_staging.define(dbl, a_data.ncomp(), 0);
+      m_stagingTag = dbl.tag();
+    }
+  for (DataIterator dit(dbl); dit.ok(); ++dit)
+    {
+      stageBox(m_staging[dit], dbl[dit], a_data[dit]);
+    }
+  m_stagedIteration = a_iteration;
+  m_stagedVarNames.assign(a_varNames, a_varNames + a_data.ncomp());
+}
+
+/*--------------------------------------------------------------------*/
+//  Write the staged data to a file
+/** Writes the grid file first if this is a new layout.  With MPI, this
+ *  is collective over m_comm if writing asynchronously, otherwise over
+ *  MPI_COMM_WORLD.
+ *  \return             -1 Error
+ *                       0 Success
+ *                      >0 CGNS error
+ *//*-----------------------------------------------------------------*/
+
+int
+PlotWriter::writeStaged()
+{
+  int status = 0;
+#ifndef NO_CGNS
+  std::lock_guard<std::mutex> lockCGNS(s_cgnsMutex);
+#ifdef USE_MPI
+  const CGNSCommScope commScope(m_comm);
+#endif
+  const DisjointBoxLayout& dbl = m_staging.disjointBoxLayout();
+  if (m_gridTag != dbl.tag())
+    {
+      status = writeGrid();
+      if (status) return status;
+      m_gridTag = dbl.tag();
+    }
+
+  // Open the CGNS file
+  const std::string fileName = plotFileName(m_stagedIteration);
+  int indexFile;
+#ifdef USE_MPI
+  int cgerr = cgp_open(fileName.c_str(), CG_MODE_WRITE, &indexFile);
+#else
+  int cgerr = cg_open(fileName.c_str(), CG_MODE_WRITE, &indexFile);
+#endif
+  if (cgerr)
+    {
+      cg_error_print();
+      return cgerr;
+    }
+
+  // Create the base
+  int indexBase;
+  cgerr = cg_base_write(indexFile, "Base", g_SpaceDim, g_SpaceDim,
+                        &indexBase);
+  if (cgerr)
+    {
+      cg_error_print();
+      return cgerr;
+    }
+
+  // Write the zones and link the grid (the grid file is in the same
+  // directory)
+  const std::string::size_type sep = m_gridFileName.find_last_of('/');
+  const std::string gridLinkName = (sep == std::string::npos) ?
+    m_gridFileName : m_gridFileName.substr(sep + 1);
+  int indexZoneOffset;
+  cgerr = dbl.writeCGNSZoneLinkGrid(indexFile,
+                                    indexBase,
+                                    indexZoneOffset,
+                                    gridLinkName.c_str());
+  if (cgerr)
+    {
+      std::cout << "EE Failed to write zone for box " << cgerr-1 << '!'
+                << std::endl;
+      status = -1;
+    }
+
+  // Write the solution data
+  if (status == 0)
+    {
+      std::vector<const char*> varNames;
+      for (const std::string& name : m_stagedVarNames)
+        {
+          varNames.push_back(name.c_str());
+        }
+      cgerr = m_staging.writeCGNSSolData(indexFile,
+                                         indexBase,
+                                         indexZoneOffset,
+                                         varNames.data());
+      if (cgerr)
+        {
+          std::cout << "EE Failed to write solution for box " << cgerr-1
+                    << '!' << std::endl;
+          status = -1;
+        }
+    }
+
+  // Close the CGNS file
+#ifdef USE_MPI
+  cgerr = cgp_close(indexFile);
+#else
+  cgerr = cg_close(indexFile);
+#endif
+  if (cgerr && status == 0)
+    {
+      cg_error_print();
+      status = cgerr;
+    }
+#endif  /* CGNS */
+  if (status == 0)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      ++m_numWritten;
+    }
+  return status;
+}
+
+/*--------------------------------------------------------------------*/
+//  Write the grid file for the staged layout
+/** Must be called with s_cgnsMutex locked.  With MPI, this is
+ *  collective.
+ *  \return             -1 Error
+ *                       0 Success
+ *                      >0 CGNS error
+ *//*-----------------------------------------------------------------*/
+
+int
+PlotWriter::writeGrid()
+{
+#ifndef NO_CGNS
+#ifdef USE_MPI
+#if defined(CGNS_VERSION) && CGNS_VERSION >= 3400
+  // Hints for MPI-IO to aggregate collective writes on a subset of
+  // processes.  CGNS keeps the handle so it is freed in the destructor.
+  if (m_numAggregator > 0 && m_info == MPI_INFO_NULL)
+    {
+      MPI_Info_create(&m_info);
+      MPI_Info_set(m_info, "romio_cb_write", "enable");
+      MPI_Info_set(m_info, "cb_nodes",
+                   std::to_string(m_numAggregator).c_str());
+      cgp_mpi_info(m_info);
+    }
+#endif
+#endif
+  m_gridFileName = m_basePlotName + "grid" +
+    plotFileName(m_stagedIteration).substr(m_basePlotName.size());
+  int indexFile;
+#ifdef USE_MPI
+  int cgerr = cgp_open(m_gridFileName.c_str(), CG_MODE_WRITE, &indexFile);
+#else
+  int cgerr = cg_open(m_gridFileName.c_str(), CG_MODE_WRITE, &indexFile);
+#endif
+  if (cgerr)
+    {
+      cg_error_print();
+      return cgerr;
+    }
+  int indexBase;
+  cgerr = cg_base_write(indexFile, "Base", g_SpaceDim, g_SpaceDim,
+                        &indexBase);
+  if (cgerr)
+    {
+      cg_error_print();
+      return cgerr;
+    }
+  int indexZoneOffset;
+  cgerr = m_staging.disjointBoxLayout().writeCGNSZoneGrid(indexFile,
+                                                          indexBase,
+                                                          indexZoneOffset,
+                                                          m_origin,
+                                                          m_dx);
+  if (cgerr)
+    {
+      std::cout << "EE Failed to write zone and grid for box " << cgerr-1
+                << '!' << std::endl;
+      return -1;
+    }
+#ifdef USE_MPI
+  cgerr = cgp_close(indexFile);
+#else
+  cgerr = cg_close(indexFile);
+#endif
+  if (cgerr)
+    {
+      cg_error_print();
+      return cgerr;
+    }
+#endif  /* CGNS */
+  return 0;
+}
+
+/*--------------------------------------------------------------------*/
+//  Body of the writer thread
+/** Writes staged data whenever m_pending is set and exits once m_quit
+ *  is set and nothing is pending.
+ *//*-----------------------------------------------------------------*/
+
+void
+PlotWriter::run()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true)
+    {
+      m_cond.wait(lock, [this]{ return m_pending || m_quit; });
+      if (m_pending)
+        {
+          lock.unlock();
+          const int status = writeStaged();
+          lock.lock();
+          m_status = status;
+          m_pending = false;
+          m_cond.notify_all();
+        }
+      else
+        {
+          return;
+        }
+    }
+}
+
+
+/*******************************************************************************
+ *
+ * Explicit instantiations of class PlotWriter members
+ *
+ ******************************************************************************/
+
+template int PlotWriter::write(const LevelData<BaseFab<float> >&,
+                               const int, const char *const *const);
+template int PlotWriter::write(const LevelData<BaseFab<double> >&,
+                               const int, const char *const *const);
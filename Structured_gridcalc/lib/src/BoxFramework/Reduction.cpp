@@ -0,0 +1,285 @@
+
+/******************************************************************************/
+/**
+ * \file Reduction.cpp
+ *
+ * \brief Non-inline definitions for classes in Reduction.H
+ *
+ *//*+*************************************************************************/
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include "DisjointBoxLayout.H"
+#include "Reduction.H"
+
+
+/*******************************************************************************
+ *
+ * Class Reduction: member definitions
+ *
+ ******************************************************************************/
+
+#ifdef USE_MPI
+MPI_Op Reduction::s_mpiOp = MPI_OP_NULL;
+#endif
+
+/*--------------------------------------------------------------------*/
+//  Default constructor
+/** Partials are available for the maximum number of OpenMP threads at
+ *  the time of construction
+ *//*-----------------------------------------------------------------*/
+
+Reduction::Reduction()
+  :
+#ifdef _OPENMP
+  m_numThread(omp_get_max_threads()),
+#else
+  m_numThread(1),
+#endif
+  m_stride(0),
+  m_pending(false)
+#ifdef USE_MPI
+  ,
+  m_request(MPI_REQUEST_NULL)
+#endif
+{
+}
+
+/*--------------------------------------------------------------------*/
+//  Destructor (completes any outstanding allreduce)
+/** Nothing is done if MPI has already been finalized
+ *//*-----------------------------------------------------------------*/
+
+Reduction::~Reduction()
+{
+  if (m_pending)
+    {
+#ifdef USE_MPI
+      int finalized;
+      MPI_Finalized(&finalized);
+      if (finalized) return;
+#endif
+      allreduceEnd();
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Add a quantity
+/** Add all quantities before accumulating.  The partials of all
+ *  quantities are reset.
+ *  \param[in]  a_op    Operation for the quantity
+ *  \return             Index of the quantity
+ *//*-----------------------------------------------------------------*/
+
+int
+Reduction::add(const Op a_op)
+{
+  CH_assert(!m_pending);
+  m_op.push_back(a_op);
+  const int numQuantity = size();
+  // Pad the partials of each thread to a multiple of 64 bytes
+  const int lineElem = std::max(1, (int)(64/sizeof(Real)));
+  m_stride = ((numQuantity + lineElem - 1)/lineElem)*lineElem;
+  m_partial.resize(m_numThread*m_stride);
+  m_result.push_back(identity(a_op));
+  m_sendBuffer.resize(1 + numQuantity);
+#ifdef USE_MPI
+  m_recvBuffer.resize(1 + numQuantity);
+#endif
+  reset();
+  return numQuantity - 1;
+}
+
+/*--------------------------------------------------------------------*/
+//  Reset the partial values of all threads
+/** Not required after allreduceBegin which resets the partials itself
+ *//*-----------------------------------------------------------------*/
+
+void
+Reduction::reset()
+{
+  const int numQuantity = size();
+  for (int iThread = 0; iThread != m_numThread; ++iThread)
+    {
+      for (int iq = 0; iq != numQuantity; ++iq)
+        {
+          m_partial[iThread*m_stride + iq] = identity(m_op[iq]);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Begin combining the partial values of all threads and processes
+/** Collective over all processes.  The partials of the threads are
+ *  combined and then reset so accumulation for the next reduction may
+ *  start before allreduceEnd.  The results are available after
+ *  allreduceEnd.
+ *//*-----------------------------------------------------------------*/
+
+void
+Reduction::allreduceBegin()
+{
+  CH_assert(!m_pending);
+  const int numQuantity = size();
+
+  // Combine the threads and pack sums followed by maxima
+  int numSum = 0;
+  for (int iq = 0; iq != numQuantity; ++iq)
+    {
+      if (!byMax(m_op[iq])) ++numSum;
+    }
+  m_sendBuffer[0] = (Real)numSum;
+  int iSum = 1;
+  int iMax = 1 + numSum;
+  for (int iq = 0; iq != numQuantity; ++iq)
+    {
+      const Op op = m_op[iq];
+      Real val = identity(op);
+      for (int iThread = 0; iThread != m_numThread; ++iThread)
+        {
+          val = combine(op, val, m_partial[iThread*m_stride + iq]);
+        }
+      if (byMax(op))
+        {
+          m_sendBuffer[iMax++] = (op == Op::min) ? -val : val;
+        }
+      else
+        {
+          m_sendBuffer[iSum++] = val;
+        }
+    }
+  reset();
+  m_pending = true;
+
+#ifdef USE_MPI
+  // A single collective for all quantities.  Buffers with only sums or
+  // only maxima use the built-in operations.
+  const int numMax = numQuantity - numSum;
+  int mpierr = 0;
+  if (numMax == 0 || numSum == 0)
+    {
+      mpierr = MPI_Iallreduce(m_sendBuffer.data() + 1,
+                              m_recvBuffer.data() + 1,
+                              numQuantity,
+                              BXFR_MPI_REAL,
+                              (numMax == 0) ? MPI_SUM : MPI_MAX,
+                              MPI_COMM_WORLD,
+                              &m_request);
+      m_recvBuffer[0] = m_sendBuffer[0];
+    }
+  else
+    {
+      if (s_mpiOp == MPI_OP_NULL)
+        {
+          MPI_Op_create(combineMPI, 1, &s_mpiOp);
+        }
+      mpierr = MPI_Iallreduce(m_sendBuffer.data(),
+                              m_recvBuffer.data(),
+                              1 + numQuantity,
+                              BXFR_MPI_REAL,
+                              s_mpiOp,
+                              MPI_COMM_WORLD,
+                              &m_request);
+    }
+  if (mpierr)
+    {
+      std::cout << "Error starting reduction on process "
+                << DisjointBoxLayout::procID() << std::endl;
+      abort();
+    }
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+//  End combining the partial values of all threads and processes
+/** Collective over all processes.  Waits for the collective started by
+ *  allreduceBegin and sets the results.
+ *//*-----------------------------------------------------------------*/
+
+void
+Reduction::allreduceEnd()
+{
+  CH_assert(m_pending);
+  m_pending = false;
+#ifdef USE_MPI
+  const int mpierr = MPI_Wait(&m_request, MPI_STATUS_IGNORE);
+  if (mpierr)
+    {
+      std::cout << "Error completing reduction on process "
+                << DisjointBoxLayout::procID() << std::endl;
+      abort();
+    }
+  const std::vector<Real>& buffer = m_recvBuffer;
+#else
+  const std::vector<Real>& buffer = m_sendBuffer;
+#endif
+
+  // Unpack in the same order as packed
+  const int numQuantity = size();
+  int iSum = 1;
+  int iMax = 1 + (int)buffer[0];
+  for (int iq = 0; iq != numQuantity; ++iq)
+    {
+      switch (m_op[iq])
+        {
+        case Op::min:
+          m_result[iq] = -buffer[iMax++];
+          break;
+        case Op::max:
+        case Op::normInf:
+          m_result[iq] = buffer[iMax++];
+          break;
+        case Op::norm2:
+          m_result[iq] = std::sqrt(buffer[iSum++]);
+          break;
+        default:
+          m_result[iq] = buffer[iSum++];
+          break;
+        }
+    }
+}
+
+#ifdef USE_MPI
+/*--------------------------------------------------------------------*/
+//  Free MPI resources (called by DisjointBoxLayout::finalizeMPI)
+/*--------------------------------------------------------------------*/
+
+void
+Reduction::finalizeMPI()
+{
+  if (s_mpiOp != MPI_OP_NULL)
+    {
+      MPI_Op_free(&s_mpiOp);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  MPI operation combining sums and maxima in one buffer
+/** The buffer is laid out as m_sendBuffer: the number of sums followed
+ *  by the sums and then the maxima.  The count is the same on all
+ *  processes and is left unchanged.
+ *//*-----------------------------------------------------------------*/
+
+void
+Reduction::combineMPI(void*         a_in,
+                      void*         a_inout,
+                      int*          a_len,
+                      MPI_Datatype* a_datatype)
+{
+  CH_assert(*a_datatype == BXFR_MPI_REAL);
+  const Real *const in = static_cast<const Real*>(a_in);
+  Real *const inout = static_cast<Real*>(a_inout);
+  const int len = *a_len;
+  const int endSum = 1 + (int)inout[0];
+  for (int i = 1; i != endSum; ++i)
+    {
+      inout[i] += in[i];
+    }
+  for (int i = endSum; i != len; ++i)
+    {
+      inout[i] = (in[i] > inout[i]) ? in[i] : inout[i];
+    }
+}
+#endif
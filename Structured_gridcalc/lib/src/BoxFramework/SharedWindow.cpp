@@ -0,0 +1,90 @@
+
+/******************************************************************************/
+/**
+ * \file SharedWindow.cpp
+ *
+ * \brief Non-inline definitions for classes in SharedWindow.H
+ *
+ *//*+*************************************************************************/
+
+#ifdef USE_MPI
+
+#include <cstdlib>
+#include <iostream>
+
+#include "DisjointBoxLayout.H"
+#include "SharedWindow.H"
+
+
+/*******************************************************************************
+ *
+ * Class SharedWindow: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Constructor (allocates this process's segment)
+/** Collective over DisjointBoxLayout::nodeComm()
+ *  \param[in]  a_bytes Size of the segment of this process (may be 0)
+ *//*-----------------------------------------------------------------*/
+
+SharedWindow::SharedWindow(const size_t a_bytes)
+  :
+  m_win(MPI_WIN_NULL)
+{
+  const MPI_Comm comm = DisjointBoxLayout::nodeComm();
+  int numNodeProc;
+  MPI_Comm_size(comm, &numNodeProc);
+  void* base;
+  int mpierr = MPI_Win_allocate_shared(a_bytes, 1, MPI_INFO_NULL, comm,
+                                       &base, &m_win);
+  if (mpierr)
+    {
+      std::cout << "Error allocating shared window on process "
+                << DisjointBoxLayout::procID() << std::endl;
+      abort();
+    }
+  m_segment.resize(numNodeProc);
+  for (int iRank = 0; iRank != numNodeProc; ++iRank)
+    {
+      MPI_Aint size;
+      int dispUnit;
+      MPI_Win_shared_query(m_win, iRank, &size, &dispUnit,
+                           &m_segment[iRank]);
+    }
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, m_win);
+}
+
+/*--------------------------------------------------------------------*/
+//  Destructor (frees the window)
+/** Collective over DisjointBoxLayout::nodeComm().  The window is not
+ *  freed if MPI has already been finalized.
+ *//*-----------------------------------------------------------------*/
+
+SharedWindow::~SharedWindow()
+{
+  int finalized;
+  MPI_Finalized(&finalized);
+  if (!finalized)
+    {
+      MPI_Win_unlock_all(m_win);
+      MPI_Win_free(&m_win);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Synchronize memory with all processes of the node
+/** Collective over DisjointBoxLayout::nodeComm().  Stores by any
+ *  process before the call are visible to loads by all processes
+ *  after the call.
+ *//*-----------------------------------------------------------------*/
+
+void
+SharedWindow::sync() const
+{
+  MPI_Win_sync(m_win);
+  MPI_Barrier(DisjointBoxLayout::nodeComm());
+  MPI_Win_sync(m_win);
+}
+
+#endif  /* USE_MPI */
@@ -0,0 +1,217 @@
+
+/******************************************************************************/
+/**
+ * \file TimerRegistry.cpp
+ *
+ * \brief Non-inline definitions for classes in TimerRegistry.H
+ *
+ *//*+*************************************************************************/
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
+#include "TimerRegistry.H"
+#include "DisjointBoxLayout.H"
+
+
+/*******************************************************************************
+ *
+ * Class TimerRegistry: static member initialization
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+/// Initial state of timing from the environment
+/** \return             T - BOXFRAMEWORK_TIMERS is set to a value other
+ *                          than 0
+ *//*-----------------------------------------------------------------*/
+
+static bool
+enabledFromEnvironment()
+{
+  const char* const env = std::getenv("BOXFRAMEWORK_TIMERS");
+  return (env != nullptr && std::strcmp(env, "0") != 0);
+}
+
+std::map<std::string, TimerRegistry::Region> TimerRegistry::s_regions;
+std::mutex TimerRegistry::s_mutex;
+bool TimerRegistry::s_enabled = enabledFromEnvironment();
+
+
+/*******************************************************************************
+ *
+ * Class TimerRegistry: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Get a region by name (created if it does not exist)
+/** \param[in]  a_name  Name of the region
+ *  \return             The region.  References remain valid for the
+ *                      duration of the program.
+ *//*-----------------------------------------------------------------*/
+
+TimerRegistry::Region&
+TimerRegistry::region(const std::string& a_name)
+{
+  std::lock_guard<std::mutex> lock(s_mutex);
+  return s_regions[a_name];
+}
+
+/*--------------------------------------------------------------------*/
+//  Reset all regions
+/*--------------------------------------------------------------------*/
+
+void
+TimerRegistry::reset()
+{
+  std::lock_guard<std::mutex> lock(s_mutex);
+  for (auto& entry : s_regions)
+    {
+      entry.second.m_timer.reset();
+      entry.second.m_bytes = 0;
+      entry.second.m_count = 0;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Write a report of all regions (collective if using MPI)
+/** With MPI, all processes must call this routine.  Regions are
+ *  matched by name and any region that is missing on a process is
+ *  treated as empty there.  The report is only written by process 0.
+ *  For each region, the time (ms) is given as the minimum, mean, and
+ *  maximum over processes together with the ratio max/mean (load
+ *  imbalance).  Calls, bytes, and counts are totals over all
+ *  processes.
+ *  \param[in]  a_os    Stream to write to
+ *//*-----------------------------------------------------------------*/
+
+void
+TimerRegistry::report(std::ostream& a_os)
+{
+  std::lock_guard<std::mutex> lock(s_mutex);
+  const int numProc = DisjointBoxLayout::numProc();
+
+//--Names of all regions on all processes
+
+  std::set<std::string> nameSet;
+  for (const auto& entry : s_regions)
+    {
+      nameSet.insert(entry.first);
+    }
+#ifdef USE_MPI
+  {
+    std::string localNames;
+    for (const std::string& name : nameSet)
+      {
+        localNames.append(name);
+        localNames.push_back('\0');
+      }
+    int localLen = localNames.size();
+    std::vector<int> len(numProc);
+    MPI_Allgather(&localLen, 1, MPI_INT, len.data(), 1, MPI_INT,
+                  MPI_COMM_WORLD);
+    std::vector<int> displ(numProc + 1, 0);
+    for (int iProc = 0; iProc != numProc; ++iProc)
+      {
+        displ[iProc + 1] = displ[iProc] + len[iProc];
+      }
+    std::vector<char> allNames(displ[numProc] + 1);
+    MPI_Allgatherv(&localNames[0], localLen, MPI_CHAR,
+                   allNames.data(), len.data(), displ.data(), MPI_CHAR,
+                   MPI_COMM_WORLD);
+    for (int i = 0; i < displ[numProc]; i += std::strlen(&allNames[i]) + 1)
+      {
+        nameSet.insert(std::string(&allNames[i]));
+      }
+  }
+#endif
+  const std::vector<std::string> names(nameSet.begin(), nameSet.end());
+  const int numRegion = names.size();
+
+//--Local values
+
+  std::vector<double> time(numRegion, 0.);
+  std::vector<long long> sums(3*numRegion, 0);  // Calls, bytes, and count
+  for (int i = 0; i != numRegion; ++i)
+    {
+      const auto entry = s_regions.find(names[i]);
+      if (entry != s_regions.end())
+        {
+          const Region& region = entry->second;
+          time[i]           = region.m_timer.time();
+          sums[3*i]         = region.m_timer.m_sessions;
+          sums[3*i + 1]     = region.m_bytes;
+          sums[3*i + 2]     = region.m_count;
+        }
+    }
+
+//--Reduce over processes
+
+  std::vector<double> timeMin(time);
+  std::vector<double> timeMax(time);
+  std::vector<double> timeSum(time);
+#ifdef USE_MPI
+  if (numRegion > 0)
+    {
+      MPI_Reduce(time.data(), timeMin.data(), numRegion, MPI_DOUBLE, MPI_MIN,
+                 0, MPI_COMM_WORLD);
+      MPI_Reduce(time.data(), timeMax.data(), numRegion, MPI_DOUBLE, MPI_MAX,
+                 0, MPI_COMM_WORLD);
+      MPI_Reduce(time.data(), timeSum.data(), numRegion, MPI_DOUBLE, MPI_SUM,
+                 0, MPI_COMM_WORLD);
+      std::vector<long long> localSums(sums);
+      MPI_Reduce(localSums.data(), sums.data(), 3*numRegion, MPI_LONG_LONG,
+                 MPI_SUM, 0, MPI_COMM_WORLD);
+    }
+#endif
+  if (DisjointBoxLayout::procID() != 0) return;
+
+//--Write
+
+  // The region column fits the longest name and a space
+  int nameWidth = std::strlen("Region");
+  for (const std::string& name : names)
+    {
+      nameWidth = std::max(nameWidth, (int)name.size());
+    }
+  ++nameWidth;
+  const std::ios_base::fmtflags flags = a_os.flags();
+  const std::streamsize precision = a_os.precision();
+  a_os << "Timers on " << numProc << " process(es) (times in ms)\n";
+  a_os << std::left << std::setw(nameWidth) << "Region" << std::right
+       << std::setw(10) << "calls"
+       << std::setw(12) << "min"
+       << std::setw(12) << "mean"
+       << std::setw(12) << "max"
+       << std::setw(9)  << "max/mean"
+       << std::setw(15) << "bytes"
+       << std::setw(11) << "count" << '\n';
+  a_os << std::fixed << std::setprecision(3);
+  for (int i = 0; i != numRegion; ++i)
+    {
+      const double timeMean = timeSum[i]/numProc;
+      a_os << std::left << std::setw(nameWidth) << names[i] << std::right
+           << std::setw(10) << sums[3*i]
+           << std::setw(12) << timeMin[i]
+           << std::setw(12) << timeMean
+           << std::setw(12) << timeMax[i]
+           << std::setw(9)  << std::setprecision(2)
+           << ((timeMean > 0.) ? timeMax[i]/timeMean : 1.)
+           << std::setprecision(3)
+           << std::setw(15) << sums[3*i + 1]
+           << std::setw(11) << sums[3*i + 2] << '\n';
+    }
+  a_os.flush();
+  a_os.flags(flags);
+  a_os.precision(precision);
+}
@@ -0,0 +1,451 @@
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
+#include "BaseFab.H"
+#include "BaseFabMacros.H"
+#include "DisjointBoxLayout.H"
+#include "LayoutIterator.H"
+#include "LevelData.H"
+#include "LayoutCopier.H"
+#include "CoarseFine.H"
+#include "AMRHierarchy.H"
+
+// Linear function of the cell centers on a mesh with spacing a_dx
+Real linear(const IntVect& a_iv, const Real a_dx)
+{
+  return 1. + D_TERM(  2.*(a_iv[0] + 0.5)*a_dx,
+                     + 3.*(a_iv[1] + 0.5)*a_dx,
+                     + 5.*(a_iv[2] + 0.5)*a_dx);
+}
+
+// Set the valid cells of level data to the linear function
+void setLinear(LevelData<BaseFab<Real> >& a_data, const Real a_dx)
+{
+  const DisjointBoxLayout& dbl = a_data.disjointBoxLayout();
+  for (DataIterator dit(dbl); dit.ok(); ++dit)
+    {
+      BaseFab<Real>& fab = a_data[dit];
+      const Box& box = dbl[dit];
+      MD_BOXLOOP(box, i)
+        {
+          const IntVect iv(D_DECL(i0, i1, i2));
+          for (int iComp = 0; iComp != a_data.ncomp(); ++iComp)
+            {
+              fab(iv, iComp) = (iComp + 1)*linear(iv, a_dx);
+            }
+        }
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+  const bool verbose = ((argc == 2) && (std::strcmp(argv[1], "-v") == 0));
+  int status = 0;
+
+//--Initialize MPI
+
+  DisjointBoxLayout::initMPI(argc, argv);
+  const int procID = DisjointBoxLayout::procID();
+  const bool masterProc = (procID == 0);
+
+//--Tests
+
+  const Box domain(IntVect::Zero, 15*IntVect::Unit);
+  const Real tol = 1.E-10;
+
+#if 1
+  // Subset layout with only the blocks in the lower half in x
+  {
+    const Box lattice(IntVect::Zero, 3*IntVect::Unit);
+    std::vector<char> present(lattice.size(), 0);
+    int numPresent = 0;
+    {
+      int idx = 0;
+      MD_BOXLOOP(lattice, i)
+        {
+          if (i0 < 2)
+            {
+              present[idx] = 1;
+              ++numPresent;
+            }
+          ++idx;
+        }
+    }
+    DisjointBoxLayout dbl;
+    dbl.defineSubset(domain, 4*IntVect::Unit, present);
+    if (dbl.complete()) ++status;
+    if (dbl.size() != numPresent) ++status;
+    if (dbl.boxSize() != 4*IntVect::Unit) ++status;
+    // Positions in lattice and global indices are consistent
+    for (LayoutIterator lit(dbl); lit.ok(); ++lit)
+      {
+        const int globalIdx = (*lit).globalIndex();
+        const IntVect ivLattice = dbl.latticePosition(globalIdx);
+        if (dbl.latticeBox(ivLattice) != globalIdx) ++status;
+        if (ivLattice[0] >= 2) ++status;
+        // Neighbors are only present boxes
+        int numNbr = 0;
+        for (NeighborIterator nit(lit); nit.ok(); ++nit)
+          {
+            if (dbl.latticePosition((*nit).globalIndex())[0] >= 2) ++status;
+            ++numNbr;
+          }
+        int expectNbr = 0;
+        Box nbrs(ivLattice - IntVect::Unit, ivLattice + IntVect::Unit);
+        nbrs &= Box(IntVect::Zero, IntVect(D_DECL(1, 3, 3)));
+        expectNbr = nbrs.size() - 1;
+        if (numNbr != expectNbr) ++status;
+      }
+    if (dbl.latticeBox(IntVect(D_DECL(2, 0, 0))) != -1) ++status;
+    if (dbl.latticeBox(IntVect(D_DECL(-1, 0, 0))) != -1) ++status;
+
+    // Exchange fills ghosts inside other boxes and leaves the rest
+    LevelData<BaseFab<Real> > lvldata(dbl, 1, 1);
+    lvldata.setVal(-1.);
+    setLinear(lvldata, 1.);
+    Copier copier;
+    copier.defineExchangeLD(lvldata);
+    lvldata.exchange(copier);
+    const Box covered(IntVect::Zero, IntVect(D_DECL(7, 15, 15)));
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        const BaseFab<Real>& fab = lvldata[dit];
+        for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+          {
+            const Real expect = covered.contains(*bit) ?
+              linear(*bit, 1.) : -1.;
+            if (fab(*bit, 0) != expect) ++status;
+          }
+      }
+  }
+#endif
+
+#if 1
+  // LayoutCopier between layouts with different block sizes, with and
+  // without ghost cells
+  {
+    DisjointBoxLayout dblSrc(domain, 8*IntVect::Unit);
+    const Box lattice(IntVect::Zero, 3*IntVect::Unit);
+    std::vector<char> present(lattice.size(), 0);
+    for (int idx = 0; idx < lattice.size(); idx += 3)
+      {
+        present[idx] = 1;
+      }
+    DisjointBoxLayout dblDst;
+    dblDst.defineSubset(domain, 4*IntVect::Unit, present,
+                        DisjointBoxLayout::Distribution::morton);
+    LevelData<BaseFab<Real> > src(dblSrc, 2, 0);
+    LevelData<BaseFab<Real> > dst(dblDst, 2, 1);
+    setLinear(src, 1.);
+    for (int iTest = 0; iTest != 2; ++iTest)
+      {
+        dst.setVal(-1.);
+        LayoutCopier copier(dblSrc, dblDst, iTest);
+        long long numCell = 0;
+        for (DataIterator dit(dblDst); dit.ok(); ++dit)
+          {
+            Box box = dblDst[dit];
+            box.grow(iTest);
+            box &= domain;
+            numCell += box.size();
+          }
+        if (copier.numCellRecv() != numCell) ++status;
+        // Copy only the second component
+        dst.copy(src, copier, 1, 1, 1);
+        for (DataIterator dit(dblDst); dit.ok(); ++dit)
+          {
+            const BaseFab<Real>& fab = dst[dit];
+            Box box = dblDst[dit];
+            box.grow(iTest);
+            for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+              {
+                if (fab(*bit, 0) != -1.) ++status;
+                const Real expect = (box.contains(*bit) &&
+                                     domain.contains(*bit)) ?
+                  2.*linear(*bit, 1.) : -1.;
+                if (fab(*bit, 1) != expect) ++status;
+              }
+          }
+      }
+  }
+#endif
+
+#if 1
+  // Averaging and interpolation between a coarse level and a fine level
+  // covering the middle of the domain in x
+  {
+    const int ratio = 2;
+    const int fnGhost = 2;
+    DisjointBoxLayout crDBL(domain, 8*IntVect::Unit);
+    const Box fnDomain = Box(domain).refine(ratio);
+    const Box lattice(IntVect::Zero, 3*IntVect::Unit);
+    std::vector<char> present(lattice.size(), 0);
+    {
+      int idx = 0;
+      MD_BOXLOOP(lattice, i)
+        {
+          if (i0 == 1 || i0 == 2) present[idx] = 1;
+          ++idx;
+        }
+    }
+    DisjointBoxLayout fnDBL;
+    fnDBL.defineSubset(fnDomain, 8*IntVect::Unit, present,
+                       DisjointBoxLayout::Distribution::morton);
+    CoarseFine coarseFine(crDBL, fnDBL, ratio, 1, fnGhost);
+    if (coarseFine.nestingBuffer() != 2) ++status;
+    if (coarseFine.coarsenedLayout().size() != fnDBL.size()) ++status;
+
+    LevelData<BaseFab<Real> > crOld(crDBL, 1, 0);
+    LevelData<BaseFab<Real> > crNew(crDBL, 1, 0);
+    LevelData<BaseFab<Real> > fnData(fnDBL, 1, fnGhost);
+
+    // Average down linear data
+    setLinear(fnData, 1./ratio);
+    crNew.setVal(0.);
+    coarseFine.averageDown(crNew, fnData);
+    const Box crCovered(IntVect(D_DECL(4, 0, 0)),
+                        IntVect(D_DECL(11, 15, 15)));
+    for (DataIterator dit(crDBL); dit.ok(); ++dit)
+      {
+        const BaseFab<Real>& fab = crNew[dit];
+        for (BoxIterator bit(crDBL[dit]); bit.ok(); ++bit)
+          {
+            const Real expect = crCovered.contains(*bit) ?
+              linear(*bit, 1.) : 0.;
+            if (std::fabs(fab(*bit, 0) - expect) > tol) ++status;
+          }
+      }
+
+    // Interpolation is exact for linear data
+    setLinear(crNew, 1.);
+    fnData.setVal(-1.);
+    coarseFine.interpolate(fnData, crNew);
+    for (DataIterator dit(fnDBL); dit.ok(); ++dit)
+      {
+        const BaseFab<Real>& fab = fnData[dit];
+        for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+          {
+            const Real expect = fnDBL[dit].contains(*bit) ?
+              linear(*bit, 1./ratio) : -1.;
+            if (std::fabs(fab(*bit, 0) - expect) > tol) ++status;
+          }
+      }
+
+    // Ghost cells inside the domain are interpolated in time between the
+    // old (f) and new (2f) coarse data and valid cells are not modified
+    setLinear(crOld, 1.);
+    crNew.setVal(0.);
+    for (DataIterator dit(crDBL); dit.ok(); ++dit)
+      {
+        BaseFab<Real>& fabNew = crNew[dit];
+        const BaseFab<Real>& fabOld = crOld[dit];
+        const Box& box = crDBL[dit];
+        MD_BOXLOOP(box, i)
+          {
+            const IntVect iv(D_DECL(i0, i1, i2));
+            fabNew(iv, 0) = 2.*fabOld(iv, 0);
+          }
+      }
+    fnData.setVal(-1.);
+    coarseFine.interpolateGhosts(fnData, crOld, crNew, 0.25);
+    for (DataIterator dit(fnDBL); dit.ok(); ++dit)
+      {
+        const BaseFab<Real>& fab = fnData[dit];
+        for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+          {
+            Real expect = -1.;
+            if (!fnDBL[dit].contains(*bit) && fnDomain.contains(*bit))
+              {
+                expect = 1.25*linear(*bit, 1./ratio);
+              }
+            if (std::fabs(fab(*bit, 0) - expect) > tol) ++status;
+          }
+      }
+  }
+#endif
+
+#if 1
+  // Hierarchy with three levels refined around cells tagged on each level
+  {
+    const int ratio = 2;
+    const int nghost = 1;
+    DisjointBoxLayout baseDBL(domain, 8*IntVect::Unit);
+    AMRHierarchy amr(baseDBL, 2, ratio, 1, nghost);
+    const IntVect ivTag[2] = { 4*IntVect::Unit, 9*IntVect::Unit };
+    int numTagCall = 0;
+    AMRHierarchy::TagFunction tagFunc =
+      [&]
+      (const int                        a_level,
+       const LevelData<BaseFab<Real> >& a_state,
+       LevelData<BaseFab<int> >&        a_tags)
+      {
+        ++numTagCall;
+        const DisjointBoxLayout& dbl = a_tags.disjointBoxLayout();
+        for (DataIterator dit(dbl); dit.ok(); ++dit)
+          {
+            if (dbl[dit].contains(ivTag[a_level]))
+              {
+                a_tags[dit](ivTag[a_level], 0) = 1;
+              }
+          }
+      };
+    amr.regrid(tagFunc);
+    if (numTagCall != 2) ++status;
+    if (amr.numLevel() != 3) ++status;
+    for (int lev = 1; lev < amr.numLevel(); ++lev)
+      {
+        const DisjointBoxLayout& crDBL = amr.layout(lev - 1);
+        const DisjointBoxLayout& fnDBL = amr.layout(lev);
+        if (fnDBL.problemDomain() != Box(crDBL.problemDomain()).refine(ratio))
+          {
+            ++status;
+          }
+        // The refined tag is covered
+        Box tagged(ivTag[lev - 1], ivTag[lev - 1]);
+        tagged.refine(ratio);
+        bool found = false;
+        for (LayoutIterator lit(fnDBL); lit.ok(); ++lit)
+          {
+            if (fnDBL[lit].contains(tagged)) found = true;
+            // Proper nesting
+            Box crRegion = fnDBL[lit];
+            crRegion.coarsen(ratio);
+            crRegion.grow(CoarseFine::nestingBuffer(ratio, nghost));
+            crRegion &= crDBL.problemDomain();
+            for (BoxIterator bit(crRegion); bit.ok(); ++bit)
+              {
+                const IntVect ivLattice =
+                  (*bit - crDBL.problemDomain().loVect())/crDBL.boxSize();
+                if (crDBL.latticeBox(ivLattice) < 0) ++status;
+              }
+          }
+        if (!found) ++status;
+        if (amr.numCell(lev) != fnDBL.size()*fnDBL.boxSize().product())
+          {
+            ++status;
+          }
+      }
+
+    // Each level adds its time step to a uniform state.  The state is
+    // then the time and so are the ghost cells interpolated in time.
+    const Real dt = 0.5;
+    int numCall[3] = { 0, 0, 0 };
+    AMRHierarchy::AdvanceFunction advanceFunc =
+      [&]
+      (const int                  a_level,
+       LevelData<BaseFab<Real> >& a_state,
+       const Real                 a_time,
+       const Real                 a_dt)
+      {
+        ++numCall[a_level];
+        if (std::fabs(a_dt - dt/std::pow(ratio, a_level)) > tol) ++status;
+        const DisjointBoxLayout& dbl = a_state.disjointBoxLayout();
+        for (DataIterator dit(dbl); dit.ok(); ++dit)
+          {
+            BaseFab<Real>& fab = a_state[dit];
+            Box box = fab.box();
+            box &= dbl.problemDomain();
+            for (BoxIterator bit(box); bit.ok(); ++bit)
+              {
+                if (std::fabs(fab(*bit, 0) - a_time) > tol) ++status;
+              }
+            const Box& valid = dbl[dit];
+            MD_BOXLOOP(valid, i)
+              {
+                fab(IntVect(D_DECL(i0, i1, i2)), 0) += a_dt;
+              }
+          }
+      };
+    amr.advance(advanceFunc, dt);
+    amr.advance(advanceFunc, dt);
+    if (numCall[0] != 2 || numCall[1] != 4 || numCall[2] != 8) ++status;
+    for (int lev = 0; lev != amr.numLevel(); ++lev)
+      {
+        if (std::fabs(amr.time(lev) - 2*dt) > tol) ++status;
+        const DisjointBoxLayout& dbl = amr.layout(lev);
+        for (DataIterator dit(dbl); dit.ok(); ++dit)
+          {
+            const BaseFab<Real>& fab = amr.state(lev)[dit];
+            for (BoxIterator bit(dbl[dit]); bit.ok(); ++bit)
+              {
+                if (std::fabs(fab(*bit, 0) - 2*dt) > tol) ++status;
+              }
+          }
+      }
+
+    // Regridding keeps the data and removing the tags removes the levels
+    tagFunc =
+      [&]
+      (const int                        a_level,
+       const LevelData<BaseFab<Real> >& a_state,
+       LevelData<BaseFab<int> >&        a_tags)
+      {
+        if (a_level == 0)
+          {
+            const DisjointBoxLayout& dbl = a_tags.disjointBoxLayout();
+            for (DataIterator dit(dbl); dit.ok(); ++dit)
+              {
+                if (dbl[dit].contains(ivTag[1]))
+                  {
+                    a_tags[dit](ivTag[1], 0) = 1;
+                  }
+              }
+          }
+      };
+    amr.regrid(tagFunc);
+    if (amr.numLevel() != 2) ++status;
+    for (DataIterator dit(amr.layout(1)); dit.ok(); ++dit)
+      {
+        const BaseFab<Real>& fab = amr.state(1)[dit];
+        for (BoxIterator bit(amr.layout(1)[dit]); bit.ok(); ++bit)
+          {
+            if (std::fabs(fab(*bit, 0) - 2*dt) > tol) ++status;
+          }
+      }
+    tagFunc =
+      []
+      (const int                        a_level,
+       const LevelData<BaseFab<Real> >& a_state,
+       LevelData<BaseFab<int> >&        a_tags)
+      { };
+    amr.regrid(tagFunc);
+    if (amr.numLevel() != 1) ++status;
+  }
+#endif
+
+#ifdef USE_MPI
+  // Sum of the status of all processes
+  {
+    int allStatus;
+    MPI_Allreduce(&status, &allStatus, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    status = allStatus;
+  }
+#endif
+
+//--Output status
+
+  if (masterProc)
+    {
+      if (verbose)
+        {
+          std::cout << "Status: " << status << std::endl;
+        }
+      const char* const testName = "testAMR";
+      const char* const statLbl[] = {
+        "failed",
+        "passed"
+      };
+      std::cout << std::left << std::setw(40) << testName
+                << statLbl[(status == 0)] << std::endl;
+    }
+
+  // Finalize MPI
+  DisjointBoxLayout::finalizeMPI();
+  return status;
+}
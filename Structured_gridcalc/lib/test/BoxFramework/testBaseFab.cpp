@@ -1,9 +1,19 @@
 #include <iostream>
 #include <iomanip>
 #include <vector>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
 
 #include "BaseFab.H"
+#include "BaseFabMacros.H"
 #include "BoxIterator.H"
+#include "MemoryPool.H"
+
+// Exercise the vector backends of the stencils
+#define USE_VEX
+#include "Stencil.H"
 
 int main(const int argc, const char* argv[])
 { 
@@ -256,6 +266,599 @@ int main(const int argc, const char* argv[])
   }
 #endif
 
+  // Test pooled allocation
+#if 1
+  {
+    int statusPA = 0;
+    const Box boxC(IntVect::Zero, 2*IntVect::Unit);
+    const int testSizeC = 2*boxC.size();
+    FArrayBox::setDefaultAllocBy(FArrayBox::AllocBy::pool);
+    const std::size_t inUse0 = MemoryPool::bytesInUse();
+    const std::size_t free0 = MemoryPool::bytesFree();
+    const std::size_t fabBytes = MemoryPool::roundUp(testSizeC*sizeof(Real));
+    const Real* addrC = nullptr;
+    {
+      FArrayBox fabC(boxC, 2);
+      addrC = fabC.dataPtr();
+      // Aligned, constructed, and accounted for
+      if (reinterpret_cast<std::uintptr_t>(addrC) % MemoryPool::s_alignment
+          != 0) ++statusPA;
+      for (BoxIterator bit(boxC); bit.ok(); ++bit)
+        {
+          if (fabC(*bit, 0) != 0. || fabC(*bit, 1) != 0.) ++statusPA;
+        }
+      if (MemoryPool::bytesInUse() != inUse0 + fabBytes) ++statusPA;
+      // Redefine with the same size recycles the block
+      fabC.define(boxC, 2, 1.5);
+      if (fabC.dataPtr() != addrC) ++statusPA;
+      if (fabC(boxC.loVect(), 1) != 1.5) ++statusPA;
+      // Move assignment from a pooled fab
+      FArrayBox fabD;
+      fabD = std::move(fabC);
+      if (fabD.dataPtr() != addrC) ++statusPA;
+      if (fabD.size() != testSizeC) ++statusPA;
+      if (fabD(boxC.hiVect(), 1) != 1.5) ++statusPA;
+    }
+    // Returned to the pool and reused by a new fab of the same size
+    if (MemoryPool::bytesInUse() != inUse0) ++statusPA;
+    if (MemoryPool::bytesFree() < free0 + fabBytes) ++statusPA;
+    {
+      FArrayBox fabE(boxC, 2);
+      if (fabE.dataPtr() != addrC) ++statusPA;
+    }
+    MemoryPool::release();
+    if (MemoryPool::bytesFree() != 0) ++statusPA;
+    FArrayBox::setDefaultAllocBy(FArrayBox::AllocBy::array);
+    if (verbose || statusPA != 0)
+      {
+        std::cout << "Pooled allocation test " << statLbl[(statusPA == 0)]
+                  << std::endl;
+      }
+    status += statusPA;
+  }
+#endif
+
+  // Test layouts of components
+#if 1
+  {
+    int statusLY = 0;
+    // Odd length in direction 0 so rows of tiled layouts are padded
+    const Box boxL(IntVect(D_DECL(1, -1, 2)), IntVect(D_DECL(5, 2, 4)));
+    const int ncompL = 3;
+    auto val = [](const IntVect& a_iv, const int a_c) -> Real
+      {
+        return D_TERM(a_iv[0], + 10*a_iv[1], + 100*a_iv[2]) + 1000*a_c;
+      };
+    FArrayBox fabRef(boxL, ncompL, FArrayBox::Layout::planar);
+    for (BoxIterator bit(boxL); bit.ok(); ++bit)
+      {
+        for (int c = 0; c != ncompL; ++c)
+          {
+            fabRef(*bit, c) = val(*bit, c);
+          }
+      }
+    const FArrayBox::Layout layouts[] = {
+      FArrayBox::Layout::planar,
+      FArrayBox::Layout::interleaved,
+      FArrayBox::Layout::tiled
+    };
+    for (const FArrayBox::Layout layout : layouts)
+      {
+        FArrayBox fabL(boxL, ncompL, layout);
+        if (fabL.layout() != layout) ++statusLY;
+        if (fabL.size() < boxL.size()*ncompL) ++statusLY;
+        fabL.setVal(-1.);
+        // Copy all components from planar layout and check every element
+        // is distinct and in range
+        fabL.copy(boxL, fabRef);
+        std::vector<int> touched(fabL.size(), 0);
+        for (BoxIterator bit(boxL); bit.ok(); ++bit)
+          {
+            for (int c = 0; c != ncompL; ++c)
+              {
+                if (fabL(*bit, c) != val(*bit, c)) ++statusLY;
+                const std::ptrdiff_t off = &fabL(*bit, c) - fabL.dataPtr();
+                if (off < 0 || off >= fabL.size()) ++statusLY;
+                else ++touched[off];
+              }
+            if ((&fabL(*bit, 1) - &fabL(*bit, 0)) !=
+                fabL.getComponentStride()) ++statusLY;
+          }
+        int numTouched = 0;
+        for (int n : touched)
+          {
+            if (n > 1) ++statusLY;
+            numTouched += n;
+          }
+        if (numTouched != boxL.size()*ncompL) ++statusLY;
+        // Layout specific access
+        if (layout == FArrayBox::Layout::interleaved)
+          {
+            MD_ARRAY_CELL(arrL, fabL);
+            MD_BOXLOOP(boxL, i)
+              {
+                const IntVect iv(D_DECL(i0, i1, i2));
+                for (int c = 0; c != ncompL; ++c)
+                  {
+                    if (&arrL[MD_CIX(i, c)] != &fabL(iv, c)) ++statusLY;
+                  }
+              }
+          }
+        if (layout == FArrayBox::Layout::tiled)
+          {
+            const int ts = FArrayBox::tileSize();
+            if (fabL.getStride()[0] != 1) ++statusLY;
+            if (g_SpaceDim > 1 && fabL.getStride()[1] % ts != 0) ++statusLY;
+            for (BoxIterator bit(boxL); bit.ok(); ++bit)
+              {
+                const Real* tile = fabL.tilePtr(*bit);
+                for (int c = 0; c != ncompL; ++c)
+                  {
+                    if (&tile[c*ts + fabL.index(*bit) % ts] != &fabL(*bit, c))
+                      {
+                        ++statusLY;
+                      }
+                  }
+              }
+          }
+        // Copy a sub-region of components back to planar layout
+        const Box boxS(boxL.loVect() + IntVect::Unit, boxL.hiVect());
+        FArrayBox fabP(boxL, 2, FArrayBox::Layout::planar);
+        fabP.setVal(-1.);
+        fabP.copy(boxS, 0, fabL, boxS, 1, 2);
+        for (BoxIterator bit(boxL); bit.ok(); ++bit)
+          {
+            for (int c = 0; c != 2; ++c)
+              {
+                const Real expected = boxS.contains(*bit) ?
+                  val(*bit, c + 1) : -1.;
+                if (fabP(*bit, c) != expected) ++statusLY;
+              }
+          }
+        // Buffers are the same for all layouts (skip component 1)
+        const unsigned flags = 5u;
+        std::vector<Real> bufRef(2*boxS.size());
+        std::vector<Real> bufL(2*boxS.size(), -1.);
+        fabRef.linearOut(bufRef.data(), boxS, 0, ncompL, flags);
+        fabL.linearOut(bufL.data(), boxS, 0, ncompL, flags);
+        if (bufL != bufRef) ++statusLY;
+        FArrayBox fabIn2(boxL, ncompL, layout);
+        fabIn2.setVal(0.);
+        fabIn2.linearIn(bufL.data(), boxS, 0, ncompL, flags);
+        for (BoxIterator bit(boxL); bit.ok(); ++bit)
+          {
+            for (int c = 0; c != ncompL; ++c)
+              {
+                const Real expected = (boxS.contains(*bit) && c != 1) ?
+                  val(*bit, c) : 0.;
+                if (fabIn2(*bit, c) != expected) ++statusLY;
+              }
+          }
+        // Assign a single component
+        fabL.setVal(2, 7.);
+        for (BoxIterator bit(boxL); bit.ok(); ++bit)
+          {
+            if (fabL(*bit, 1) != val(*bit, 1)) ++statusLY;
+            if (fabL(*bit, 2) != 7.) ++statusLY;
+          }
+      }
+    // Default layout
+    FArrayBox::setDefaultLayout(FArrayBox::Layout::interleaved);
+    {
+      FArrayBox fabD(boxL, ncompL);
+      if (fabD.layout() != FArrayBox::Layout::interleaved) ++statusLY;
+      fabD.define(boxL, ncompL, FArrayBox::Layout::tiled);
+      if (fabD.layout() != FArrayBox::Layout::tiled) ++statusLY;
+    }
+    FArrayBox::setDefaultLayout(FArrayBox::Layout::planar);
+    if (verbose || statusLY != 0)
+      {
+        std::cout << "Layout test " << statLbl[(statusLY == 0)]
+                  << std::endl;
+      }
+    status += statusLY;
+  }
+#endif
+
+  // Test aligned rows
+#if 1
+  {
+    int statusAR = 0;
+    const int ts = FArrayBox::tileSize();
+    // Lower corner is not a multiple of the tile size
+    const Box boxR(IntVect(D_DECL(-3, 1, 0)), IntVect(D_DECL(5, 3, 2)));
+    const int ncompR = 2;
+    auto val = [](const IntVect& a_iv, const int a_c) -> Real
+      {
+        return D_TERM(a_iv[0], + 10*a_iv[1], + 100*a_iv[2]) + 1000*a_c;
+      };
+    if (FArrayBox::defaultAlignRows()) ++statusAR;
+    FArrayBox::setDefaultAlignRows(true);
+    FArrayBox fabR(boxR, ncompR);
+    FArrayBox fabE(boxR, ncompR, FArrayBox::Layout::planar);
+    FArrayBox::setDefaultAlignRows(false);
+    // Explicit layouts are never padded
+    if (fabE.alignedRows()) ++statusAR;
+    if (fabE.rowLead() != 0) ++statusAR;
+    if (fabE.rowSize() != boxR.dimensions()[0]) ++statusAR;
+    // Rows hold whole tiles starting at i0 a multiple of the tile size
+    if (!fabR.alignedRows()) ++statusAR;
+    if (fabR.rowLead() != ((boxR.loVect()[0] % ts) + ts) % ts) ++statusAR;
+    if (fabR.rowSize() % ts != 0) ++statusAR;
+    if (fabR.rowSize() < fabR.rowLead() + boxR.dimensions()[0]) ++statusAR;
+    if (fabR.size() != ncompR*fabR.rowSize()*(boxR.size()/
+                                              boxR.dimensions()[0]))
+      {
+        ++statusAR;
+      }
+    if (fabR.index(boxR.loVect()) != fabR.rowLead()) ++statusAR;
+#ifdef CH_STENCIL_VEX
+    if (!fabR.vectorAligned()) ++statusAR;
+#endif
+    if (fabR.vectorAligned())
+      {
+        for (BoxIterator bit(boxR); bit.ok(); ++bit)
+          {
+            if ((*bit)[0] % ts != 0) continue;
+            for (int c = 0; c != ncompR; ++c)
+              {
+                if (reinterpret_cast<uintptr_t>(&fabR(*bit, c)) %
+                    (ts*sizeof(Real)) != 0) ++statusAR;
+              }
+          }
+      }
+    // MD_ARRAY indexes the padded rows
+    {
+      MD_ARRAY_RESTRICT(arrR, fabR);
+      for (int c = 0; c != ncompR; ++c)
+        {
+          MD_BOXLOOP(boxR, i)
+            {
+              const IntVect iv(D_DECL(i0, i1, i2));
+              if (&arrR[MD_IX(i, c)] != &fabR(iv, c)) ++statusAR;
+              arrR[MD_IX(i, c)] = val(iv, c);
+            }
+        }
+    }
+    // Copy, linearOut, and linearIn with contiguous fabs
+    const Box boxRS(boxR.loVect() + IntVect::Unit, boxR.hiVect());
+    fabE.setVal(-1.);
+    fabE.copy(boxRS, fabR);
+    std::vector<Real> bufR(ncompR*boxRS.size());
+    std::vector<Real> bufE(ncompR*boxRS.size());
+    fabR.linearOut(bufR.data(), boxRS, 0, ncompR);
+    fabE.linearOut(bufE.data(), boxRS, 0, ncompR);
+    if (bufR != bufE) ++statusAR;
+    fabR.setVal(0, 0.);
+    fabR.linearIn(bufE.data(), boxRS, 0, ncompR);
+    for (BoxIterator bit(boxR); bit.ok(); ++bit)
+      {
+        for (int c = 0; c != ncompR; ++c)
+          {
+            const Real expectedE = boxRS.contains(*bit) ? val(*bit, c) : -1.;
+            const Real expectedR = (boxRS.contains(*bit) || c == 1) ?
+              val(*bit, c) : 0.;
+            if (fabE(*bit, c) != expectedE) ++statusAR;
+            if (fabR(*bit, c) != expectedR) ++statusAR;
+          }
+      }
+    // Round trip through the memory range used for CGNS I/O.  The range
+    // addresses the array of a component as CGNS does.
+    {
+      int memdim[g_SpaceDim];
+      int memrmin[g_SpaceDim];
+      int memrmax[g_SpaceDim];
+      fabR.memRange(boxRS, memdim, memrmin, memrmax);
+      if (memrmin[0] != 1 + fabR.rowLead() + 1) ++statusAR;
+      if (memrmax[0] != fabR.rowLead() + boxR.dimensions()[0]) ++statusAR;
+      for (int dir = 0; dir != g_SpaceDim; ++dir)
+        {
+          if (memrmax[dir] - memrmin[dir] + 1 != boxRS.dimensions()[dir])
+            {
+              ++statusAR;
+            }
+        }
+      const IntVect bufDim = boxRS.dimensions();
+      auto memIdx = [&](const IntVect& a_iv) -> int
+        {
+          int idx = 0;
+          int stride = 1;
+          for (int dir = 0; dir != g_SpaceDim; ++dir)
+            {
+              idx += stride*(memrmin[dir] - 1 + a_iv[dir] -
+                             boxRS.loVect()[dir]);
+              stride *= memdim[dir];
+            }
+          return idx;
+        };
+      auto bufIdx = [&](const IntVect& a_iv, const int a_c) -> int
+        {
+          const IntVect off = a_iv - boxRS.loVect();
+          return a_c*boxRS.size() + D_TERM(off[0],
+                                           + bufDim[0]*off[1],
+                                           + bufDim[0]*bufDim[1]*off[2]);
+        };
+      std::vector<Real> bufM(ncompR*boxRS.size());
+      for (int c = 0; c != ncompR; ++c)
+        {
+          const Real *const data = fabR.dataPtr(c);
+          for (BoxIterator bit(boxRS); bit.ok(); ++bit)
+            {
+              bufM[bufIdx(*bit, c)] = data[memIdx(*bit)];
+            }
+        }
+      if (bufM != bufE) ++statusAR;
+      FArrayBox::setDefaultAlignRows(true);
+      FArrayBox fabM(boxR, ncompR);
+      FArrayBox::setDefaultAlignRows(false);
+      fabM.setVal(-1.);
+      for (int c = 0; c != ncompR; ++c)
+        {
+          Real *const data = fabM.dataPtr(c);
+          for (BoxIterator bit(boxRS); bit.ok(); ++bit)
+            {
+              data[memIdx(*bit)] = bufM[bufIdx(*bit, c)];
+            }
+        }
+      for (BoxIterator bit(boxR); bit.ok(); ++bit)
+        {
+          for (int c = 0; c != ncompR; ++c)
+            {
+              const Real expected = boxRS.contains(*bit) ? val(*bit, c) : -1.;
+              if (fabM(*bit, c) != expected) ++statusAR;
+            }
+        }
+    }
+    if (verbose || statusAR != 0)
+      {
+        std::cout << "Aligned rows test " << statLbl[(statusAR == 0)]
+                  << std::endl;
+      }
+    status += statusAR;
+  }
+#endif
+
+  // Test stencils
+#if 1
+  {
+    int statusST = 0;
+    // Odd length in direction 0 so pencils have a tail
+    const Box boxS(IntVect(D_DECL(-2, 0, 1)), IntVect(D_DECL(8, 3, 4)));
+    const int nghostS = StencilLaplacian4::s_radius;
+    if (StencilLaplacian2::s_radius != 1) ++statusST;
+    if (nghostS != 2) ++statusST;
+    Box boxSG(boxS);
+    boxSG.grow(nghostS);
+    // Laplacian of a quadratic is 2*(1 + 2 + 3 ...)
+    FArrayBox fabU(boxSG, 1);
+    for (BoxIterator bit(boxSG); bit.ok(); ++bit)
+      {
+        const IntVect& iv = *bit;
+        fabU(iv, 0) = D_TERM(iv[0]*iv[0], + 2*iv[1]*iv[1], + 3*iv[2]*iv[2]);
+      }
+    const Real lapExact = D_TERM(2., + 4., + 6.);
+    MD_ARRAY_RESTRICT(arrU, fabU);
+
+    // Scalar backend against the hand-written stencil
+    {
+      FArrayBox fabLap(boxS, 2);
+      MD_ARRAY_RESTRICT(arrLap, fabLap);
+      const StencilOpsScalar ops;
+      MD_BOXLOOP(boxS, i)
+        {
+          arrLap[MD_IX(i, 0)] = StencilLaplacian2::apply(
+            MD_STENCILLOAD(arrU, i, 0, ops));
+          arrLap[MD_IX(i, 1)] = StencilLaplacian4::apply(
+            MD_STENCILLOAD(arrU, i, 0, ops));
+        }
+      for (int dir = 0; dir != g_SpaceDim; ++dir)
+        {
+          const int MD_ID(o, dir);
+          MD_BOXLOOP(boxS, i)
+            {
+              arrLap[MD_IX(i, 0)] -= arrU[MD_OFFSETIX(i,+,o, 0)] -
+                                   2*arrU[MD_IX(i, 0)] +
+                                     arrU[MD_OFFSETIX(i,-,o, 0)];
+            }
+        }
+      for (BoxIterator bit(boxS); bit.ok(); ++bit)
+        {
+          if (fabLap(*bit, 0) != 0.) ++statusST;
+          if (std::fabs(fabLap(*bit, 1) - lapExact) > 1.E-10) ++statusST;
+        }
+    }
+
+    // Pencils with vectors and tails only update the pencil
+    {
+      const Real sentinel = -1.;
+      FArrayBox fabLap(boxSG, 1, sentinel);
+      MD_ARRAY_RESTRICT(arrLap, fabLap);
+      MD_BOXLOOP_PENCIL(boxS, i)
+        {
+          stencilPencil(boxS.loVect(0), boxS.hiVect(0),
+                        [=](const auto a_ops, const int i0)
+            {
+              MD_CAPTURE_RESTRICT(arrLap);
+              a_ops.store(&arrLap[MD_IX(i, 0)],
+                          a_ops.set1(0.5)*StencilLaplacian2::apply(
+                            MD_STENCILLOAD(arrU, i, 0, a_ops)));
+            });
+        }
+      for (BoxIterator bit(boxSG); bit.ok(); ++bit)
+        {
+          const Real expected = boxS.contains(*bit) ? 0.5*lapExact : sentinel;
+          if (fabLap(*bit, 0) != expected) ++statusST;
+        }
+    }
+
+    // Aligned pencils have masked vectors at both ends
+    {
+      const Real sentinel = -1.;
+      FArrayBox::setDefaultAlignRows(true);
+      FArrayBox fabUA(boxSG, 1);
+      FArrayBox fabLap(boxSG, 1, sentinel);
+      FArrayBox::setDefaultAlignRows(false);
+      fabUA.copy(boxSG, fabU);
+      const bool aligned = fabUA.vectorAligned() && fabLap.vectorAligned();
+#ifdef CH_STENCIL_VEX
+      if (!aligned) ++statusST;
+#endif
+      MD_ARRAY_RESTRICT(arrUA, fabUA);
+      MD_ARRAY_RESTRICT(arrLap, fabLap);
+      MD_BOXLOOP_PENCIL(boxS, i)
+        {
+          stencilPencil(boxS.loVect(0), boxS.hiVect(0), aligned,
+                        [=](const auto a_ops, const int i0)
+            {
+              MD_CAPTURE_RESTRICT(arrLap);
+              a_ops.store(&arrLap[MD_IX(i, 0)],
+                          StencilLaplacian4::apply(
+                            MD_STENCILLOAD(arrUA, i, 0, a_ops)));
+            });
+        }
+      for (BoxIterator bit(boxSG); bit.ok(); ++bit)
+        {
+          if (boxS.contains(*bit))
+            {
+              if (std::fabs(fabLap(*bit, 0) - lapExact) > 1.E-10) ++statusST;
+            }
+          else if (fabLap(*bit, 0) != sentinel) ++statusST;
+        }
+    }
+    if (verbose || statusST != 0)
+      {
+        std::cout << "Stencil test " << statLbl[(statusST == 0)]
+                  << std::endl;
+      }
+    status += statusST;
+  }
+#endif
+
+  // Test storage in float with computations in double
+#if 1
+  {
+    int statusMP = 0;
+    const Box boxM(IntVect(D_DECL(-2, 0, 1)), IntVect(D_DECL(8, 3, 4)));
+    const int nghostM = StencilLaplacian2::s_radius;
+    Box boxMG(boxM);
+    boxMG.grow(nghostM);
+    // Values are exactly representable as float
+    BaseFab<double> fabD(boxMG, 2);
+    for (BoxIterator bit(boxMG); bit.ok(); ++bit)
+      {
+        const IntVect& iv = *bit;
+        fabD(iv, 0) = D_TERM(iv[0]*iv[0], + 2*iv[1]*iv[1], + 3*iv[2]*iv[2]);
+        fabD(iv, 1) = 0.5*iv[0];
+      }
+
+    // Conversion between precisions and layouts
+    BaseFab<float> fabF(boxMG, 2);
+    fabF.convert(boxMG, fabD);
+    BaseFab<float> fabFI(boxMG, 2, BaseFab<float>::Layout::interleaved);
+    fabFI.convert(boxMG, fabD);
+    BaseFab<double> fabD2(boxMG, 2, -1.);
+    fabD2.convert(boxM, fabFI);
+    for (BoxIterator bit(boxMG); bit.ok(); ++bit)
+      {
+        for (int c = 0; c != 2; ++c)
+          {
+            if (fabF(*bit, c) != (float)fabD(*bit, c)) ++statusMP;
+            if (fabFI(*bit, c) != (float)fabD(*bit, c)) ++statusMP;
+            const double expected = boxM.contains(*bit) ? fabD(*bit, c) : -1.;
+            if (fabD2(*bit, c) != expected) ++statusMP;
+          }
+      }
+
+    // Stencils load and store float (aligned rows have masked ends)
+    {
+      const float sentinel = -1.f;
+      BaseFab<float>::setDefaultAlignRows(true);
+      BaseFab<float> fabU(boxMG, 1);
+      BaseFab<float> fabLap(boxMG, 1, sentinel);
+      BaseFab<float>::setDefaultAlignRows(false);
+      fabU.copy(boxMG, 0, fabF, boxMG, 0, 1);
+      const bool aligned = fabU.vectorAligned() && fabLap.vectorAligned();
+#ifdef CH_STENCIL_VEX
+      if (!aligned) ++statusMP;
+#endif
+      MD_ARRAY_RESTRICT(arrU, fabU);
+      MD_ARRAY_RESTRICT(arrLap, fabLap);
+      MD_BOXLOOP_PENCIL(boxM, i)
+        {
+          stencilPencil(boxM.loVect(0), boxM.hiVect(0), aligned,
+                        [=](const auto a_ops, const int i0)
+            {
+              MD_CAPTURE_RESTRICT(arrLap);
+              a_ops.store(&arrLap[MD_IX(i, 0)],
+                          a_ops.set1(0.5)*StencilLaplacian2::apply(
+                            MD_STENCILLOAD(arrU, i, 0, a_ops)));
+            });
+        }
+      const float lapExact = 0.5*(D_TERM(2., + 4., + 6.));
+      for (BoxIterator bit(boxMG); bit.ok(); ++bit)
+        {
+          const float expected = boxM.contains(*bit) ? lapExact : sentinel;
+          if (fabLap(*bit, 0) != expected) ++statusMP;
+        }
+    }
+
+    // Values that are not representable as float.  The stencil cancels the
+    // large constant part so the error is relative to the stored values,
+    // not to the result.  Each stored value is within half an ulp and the
+    // stencil coefficients sum to 4*g_SpaceDim in magnitude.
+    {
+      const double small = 1.E-2;
+      BaseFab<double> fabG(boxMG, 1);
+      double maxU = 0.;
+      for (BoxIterator bit(boxMG); bit.ok(); ++bit)
+        {
+          const IntVect& iv = *bit;
+          fabG(*bit, 0) = 1./3. + small*(D_TERM(iv[0]*iv[0],
+                                                + 2*iv[1]*iv[1],
+                                                + 3*iv[2]*iv[2]));
+          maxU = std::max(maxU, std::fabs(fabG(*bit, 0)));
+        }
+      BaseFab<float> fabU(boxMG, 1);
+      fabU.convert(boxMG, fabG);
+      BaseFab<float> fabLap(boxMG, 1, 0.f);
+      MD_ARRAY_RESTRICT(arrU, fabU);
+      MD_ARRAY_RESTRICT(arrLap, fabLap);
+      MD_BOXLOOP_PENCIL(boxM, i)
+        {
+          stencilPencil(boxM.loVect(0), boxM.hiVect(0), false,
+                        [=](const auto a_ops, const int i0)
+            {
+              MD_CAPTURE_RESTRICT(arrLap);
+              a_ops.store(&arrLap[MD_IX(i, 0)],
+                          StencilLaplacian2::apply(
+                            MD_STENCILLOAD(arrU, i, 0, a_ops)));
+            });
+        }
+      const double lapExact = small*(D_TERM(2., + 4., + 6.));
+      const double eps = std::numeric_limits<float>::epsilon();
+      const double tol = (2*g_SpaceDim*maxU + lapExact)*eps;
+      double maxErr = 0.;
+      for (BoxIterator bit(boxM); bit.ok(); ++bit)
+        {
+          maxErr = std::max(maxErr, std::fabs(fabLap(*bit, 0) - lapExact));
+        }
+      if (maxErr > tol) ++statusMP;
+      if (verbose)
+        {
+          std::cout << "Mixed precision Laplacian relative error "
+                    << maxErr/lapExact << " (tolerance " << tol/lapExact
+                    << ')' << std::endl;
+        }
+    }
+    if (verbose || statusMP != 0)
+      {
+        std::cout << "Mixed precision test " << statLbl[(statusMP == 0)]
+                  << std::endl;
+      }
+    status += statusMP;
+  }
+#endif
+
 //--Output status
 
   if (verbose)
@@ -2,7 +2,9 @@
 #include <iomanip>
 
 #include "BoxIterator.H"
+#include "TileIterator.H"
 #include "BaseFab.H"
+#include "BaseFabMacros.H"
 
 int main(const int argc, const char* argv[])
 {
@@ -146,6 +148,71 @@ int main(const int argc, const char* argv[])
   }
 #endif
 
+  // Test tiles
+  {
+    if (verbose)
+      {
+        std::cout << "--- Tiles\n";
+      }
+    const Box boxT(IntVect(D_DECL(-3, 1, 2)), IntVect(D_DECL(9, 10, 7)));
+    const IntVect shape(D_DECL(0, 4, 3));
+    if (BoxTasks::numTiles(boxT, shape) != IntVect(D_DECL(1, 3, 2)))
+      ++status;
+
+    // The tiles cover the box once and sizes differ by at most one
+    BaseFab<int> fabT(boxT, 1);
+    fabT.setVal(0);
+    int numTile = 0;
+    for (TileIterator tit(boxT, shape); tit.ok(); ++tit, ++numTile)
+      {
+        if (verbose) std::cout << *tit << std::endl;
+        if (!boxT.contains(*tit)) ++status;
+        const IntVect dims = tit->dimensions();
+        if (dims[0] != boxT.dimensions()[0]) ++status;
+        for (int dir = 1; dir != g_SpaceDim; ++dir)
+          {
+            if (dims[dir] > shape[dir] || dims[dir] < shape[dir] - 1)
+              ++status;
+          }
+        for (BoxIterator bit(*tit); bit.ok(); ++bit)
+          {
+            ++fabT(*bit, 0);
+          }
+      }
+    TileIterator titIdx(boxT, shape);
+    if (numTile != titIdx.size() || numTile != titIdx.numTiles().product())
+      ++status;
+    if (!(titIdx[titIdx.size() - 1] ==
+          BoxTasks::tile(boxT, titIdx.numTiles(), titIdx.numTiles() -
+                         IntVect::Unit))) ++status;
+    for (BoxIterator bit(boxT); bit.ok(); ++bit)
+      {
+        if (fabT(*bit, 0) != 1) ++status;
+      }
+    if (TileIterator(Box()).ok()) ++status;
+
+    // The tiled loops visit each cell once
+    const IntVect shapeSave = BoxTasks::tileShape();
+    BoxTasks::setTileShape(IntVect(D_DECL(5, 2, 4)));
+    fabT.setVal(0);
+    MD_BOXLOOP_TILE_OMP(boxT, i)
+      {
+        ++fabT(IntVect(D_DECL(i0, i1, i2)), 0);
+      }
+    MD_BOXLOOP_PENCIL_TILE_OMP(boxT, j)
+      {
+        for (int j0 = boxT.loVect(0); j0 <= boxT.hiVect(0); ++j0)
+          {
+            ++fabT(IntVect(D_DECL(j0, j1, j2)), 0);
+          }
+      }
+    BoxTasks::setTileShape(shapeSave);
+    for (BoxIterator bit(boxT); bit.ok(); ++bit)
+      {
+        if (fabT(*bit, 0) != 2) ++status;
+      }
+  }
+
 //--Output status
 
   if (verbose)
@@ -1,8 +1,11 @@
 #include <iostream>
 #include <iomanip>
 #include <cstring>
+#include <vector>
+#include <cstdlib>
 
 #include "DisjointBoxLayout.H"
+#include "LayoutIterator.H"
 
 int main(const int argc, const char* argv[])
 {
@@ -82,6 +85,286 @@ int main(const int argc, const char* argv[])
     }
 #endif
 
+//--Distribution of boxes among processes (examined for any number of
+//--processes without requiring a parallel run)
+
+  {
+    using Distribution = DisjointBoxLayout::Distribution;
+    const IntVect numBox = 4*IntVect::Unit;
+    const int size = numBox.product();
+    const Box lattice(IntVect::Zero, numBox - IntVect::Unit);
+    const auto ivOf =
+      [&numBox]
+      (int a_idx)
+      {
+        IntVect iv;
+        D_TERM(iv[0] = a_idx % numBox[0]; a_idx /= numBox[0];,
+               iv[1] = a_idx % numBox[1]; a_idx /= numBox[1];,
+               iv[2] = a_idx;)
+        return iv;
+      };
+    std::vector<int> boxProc;
+
+    // Lexicographic reproduces contiguous runs of global indices
+    DisjointBoxLayout::distribute(boxProc, numBox, 4,
+                                  Distribution::lexicographic);
+    for (int i = 0; i != size; ++i)
+      {
+        if (boxProc[i] != i/(size/4)) ++status;
+      }
+
+    // One box per process orders the boxes along the curve.  Consecutive
+    // boxes on a Hilbert curve must be face neighbours.
+    DisjointBoxLayout::distribute(boxProc, numBox, size,
+                                  Distribution::hilbert);
+    {
+      std::vector<int> curve(size, -1);
+      for (int i = 0; i != size; ++i)
+        {
+          if (boxProc[i] < 0 || boxProc[i] >= size) ++status;
+          else curve[boxProc[i]] = i;
+        }
+      for (int i = 0; i != size; ++i)
+        {
+          if (curve[i] < 0) ++status;
+        }
+      if (status == 0)
+        {
+          for (int i = 1; i != size; ++i)
+            {
+              const IntVect diff = ivOf(curve[i]) - ivOf(curve[i-1]);
+              int dist = 0;
+              for (int dir = 0; dir != g_SpaceDim; ++dir)
+                {
+                  dist += std::abs(diff[dir]);
+                }
+              if (dist != 1)
+                {
+                  if (verbose)
+                    {
+                      std::cout << "Hilbert jump at " << i << std::endl;
+                    }
+                  ++status;
+                }
+            }
+        }
+    }
+
+    // Morton groups of 2^SpaceDim boxes form a block of 2 boxes per
+    // direction
+    const int numGroup = size >> g_SpaceDim;
+    DisjointBoxLayout::distribute(boxProc, numBox, numGroup,
+                                  Distribution::morton);
+    {
+      for (int i = 0; i != size; ++i)
+        {
+          const IntVect iv = ivOf(i);
+          for (int j = 0; j != size; ++j)
+            {
+              if (boxProc[j] == boxProc[i] && ivOf(j)/(2*IntVect::Unit) != iv/(2*IntVect::Unit)) ++status;
+            }
+        }
+    }
+
+    // Uneven number of boxes per process
+    for (const Distribution dist : { Distribution::lexicographic,
+                                     Distribution::morton,
+                                     Distribution::hilbert,
+                                     Distribution::knapsack })
+      {
+        const int numProc = 5;
+        DisjointBoxLayout::distribute(boxProc, numBox, numProc, dist);
+        std::vector<int> count(numProc, 0);
+        for (int i = 0; i != size; ++i)
+          {
+            ++count[boxProc[i]];
+          }
+        for (int iProc = 0; iProc != numProc; ++iProc)
+          {
+            if (count[iProc] < size/numProc ||
+                count[iProc] > size/numProc + 1) ++status;
+          }
+      }
+
+    // Weighted partitioning along the curve and knapsack balance costs
+    {
+      std::vector<Real> cost(size, 1.);
+      for (int i = 0; i != size/2; ++i)
+        {
+          cost[i] = 3.;
+        }
+      for (const Distribution dist : { Distribution::hilbert,
+                                       Distribution::knapsack })
+        {
+          DisjointBoxLayout::distribute(boxProc, numBox, 2, dist, cost);
+          Real load[2] = { 0., 0. };
+          for (int i = 0; i != size; ++i)
+            {
+              load[boxProc[i]] += cost[i];
+            }
+          if (load[0] != load[1]) ++status;
+        }
+    }
+
+    // A layout with a given distribution
+    {
+      const Box domain4(IntVect::Zero, 4*numBox - IntVect::Unit);
+      DisjointBoxLayout dbl(domain4, 4*IntVect::Unit, Distribution::hilbert);
+      if (dbl.size() != size) ++status;
+      int numLocal = 0;
+      int lastGlobal = -1;
+      for (DataIterator dit(dbl); dit.ok(); ++dit)
+        {
+          const BoxIndex bidx = *dit;
+          if (bidx.localIndex() != numLocal) ++status;
+          if (bidx.globalIndex() <= lastGlobal) ++status;
+          if (dbl.localIndex(bidx.globalIndex()) != numLocal) ++status;
+          if (dbl.proc(dit) != DisjointBoxLayout::procID()) ++status;
+          lastGlobal = bidx.globalIndex();
+          ++numLocal;
+        }
+      if (numLocal != dbl.localSize()) ++status;
+    }
+  }
+
+
+//--Irregular layouts
+
+  {
+    // Slabs of different thickness in direction 0, split at different
+    // places in direction 1, with one box missing
+    const Box domain(IntVect::Zero, 15*IntVect::Unit);
+    const int slabLo[] = { 0, 4, 10, 16 };
+    std::vector<Box> boxes;
+    for (int iSlab = 0; iSlab != 3; ++iSlab)
+      {
+        const int split = (iSlab % 2 == 0) ? 8 : 6;
+        const int yLo[] = { 0, split, 16 };
+        for (int iy = 0; iy != 2; ++iy)
+          {
+            if (iSlab == 1 && iy == 1) continue;
+            IntVect lo(domain.loVect());
+            IntVect hi(domain.hiVect());
+            lo[0] = slabLo[iSlab];
+            hi[0] = slabLo[iSlab + 1] - 1;
+            lo[1] = yLo[iy];
+            hi[1] = yLo[iy + 1] - 1;
+            boxes.emplace_back(lo, hi);
+          }
+      }
+    const int numBox = boxes.size();
+
+    DisjointBoxLayout dbl;
+    dbl.defineIrregular(domain, boxes);
+    if (!dbl.irregular()) ++status;
+    if (dbl.size() != numBox) ++status;
+    for (int idx = 0; idx != numBox; ++idx)
+      {
+        if (dbl.getLinear(idx).box != boxes[idx]) ++status;
+      }
+
+    // Overlaps compared to a search of all boxes
+    std::vector<int> idxOverlap;
+    for (const Box& region : { Box(IntVect::Zero, IntVect::Unit),
+                               Box(IntVect(D_DECL(2, 4, 0)),
+                                   IntVect(D_DECL(9, 10, 3))),
+                               Box(-2*IntVect::Unit, 20*IntVect::Unit),
+                               Box(IntVect(D_DECL(4, 9, 0)),
+                                   IntVect(D_DECL(7, 14, 15))),
+                               Box(16*IntVect::Unit, 17*IntVect::Unit) })
+      {
+        dbl.overlaps(region, idxOverlap);
+        std::vector<int> idxSearch;
+        for (int idx = 0; idx != numBox; ++idx)
+          {
+            Box overlap(boxes[idx]);
+            overlap &= region;
+            if (!overlap.isEmpty()) idxSearch.push_back(idx);
+          }
+        if (idxOverlap != idxSearch) ++status;
+      }
+
+    // The spatial index directly
+    const BoxBins bins(boxes, IntVect::Zero, 4*IntVect::Unit);
+    if (bins.size() != numBox) ++status;
+    for (int idx = 0; idx != numBox; ++idx)
+      {
+        if (bins.find(boxes[idx].loVect()) != idx) ++status;
+        if (bins.find(boxes[idx].hiVect()) != idx) ++status;
+      }
+    if (bins.find(IntVect(D_DECL(5, 12, 0))) != -1) ++status;
+    if (bins.find(-IntVect::Unit) != -1) ++status;
+
+    // Every box is assigned to a process
+    using Distribution = DisjointBoxLayout::Distribution;
+    std::vector<int> boxProc;
+    for (const Distribution dist : { Distribution::lexicographic,
+                                     Distribution::morton,
+                                     Distribution::hilbert,
+                                     Distribution::knapsack })
+      {
+        DisjointBoxLayout::distribute(boxProc, boxes, domain, 2, dist);
+        if ((int)boxProc.size() != numBox) ++status;
+        for (const int iProc : boxProc)
+          {
+            if (iProc < 0 || iProc >= 2) ++status;
+          }
+      }
+
+    // Coarsening keeps the layout irregular
+    DisjointBoxLayout crDBL;
+    crDBL.defineCoarsened(dbl, 2);
+    if (!crDBL.irregular()) ++status;
+    crDBL.overlaps(crDBL.problemDomain(), idxOverlap);
+    if ((int)idxOverlap.size() != numBox) ++status;
+    crDBL.overlaps(Box(IntVect(D_DECL(4, 2, 0)), IntVect(D_DECL(5, 4, 0))),
+                   idxOverlap);
+    if (idxOverlap != std::vector<int>{ 2, 3, 4 }) ++status;
+  }
+
+//--Repeated definitions share their arrays
+
+  {
+    using Distribution = DisjointBoxLayout::Distribution;
+    const Box domain(IntVect::Zero, 15*IntVect::Unit);
+    const DisjointBoxLayout dblA(domain, IntVect::Unit, Distribution::morton);
+    const DisjointBoxLayout dblB(domain, IntVect::Unit, Distribution::morton);
+    if (dblB.tag() != dblA.tag()) ++status;
+    if (dblB.size() != dblA.size()) ++status;
+    if (dblB.dimensions() != dblA.dimensions()) ++status;
+    if (dblB.localSize() != dblA.localSize()) ++status;
+    if (dblB.localIdxBegin() != dblA.localIdxBegin()) ++status;
+    if (dblB.localIdxEnd() != dblA.localIdxEnd()) ++status;
+    if (!dblB.complete()) ++status;
+
+    // Different parameters or a given cost are not shared
+    const DisjointBoxLayout dblC(domain, IntVect::Unit,
+                                 Distribution::hilbert);
+    if (dblC.tag() == dblA.tag()) ++status;
+    const DisjointBoxLayout dblD(domain, 2*IntVect::Unit,
+                                 Distribution::morton);
+    if (dblD.tag() == dblA.tag()) ++status;
+    const std::vector<Real> cost(dblA.size(), (Real)1);
+    const DisjointBoxLayout dblE(domain, IntVect::Unit, Distribution::morton,
+                                 cost);
+    if (dblE.tag() == dblA.tag()) ++status;
+
+    // The boxes match those of a subset with all blocks present
+    DisjointBoxLayout dblF;
+    dblF.defineSubset(domain, IntVect::Unit,
+                      std::vector<char>(dblA.size(), 1),
+                      Distribution::morton);
+    if (dblF.size() != dblA.size()) ++status;
+    for (int idx = 0, idx_end = dblA.size(); idx != idx_end; ++idx)
+      {
+        if (dblF.getLinear(idx).box != dblA.getLinear(idx).box) ++status;
+        if (dblF.getLinear(idx).proc != dblA.getLinear(idx).proc) ++status;
+        if (dblF.getLinear(idx).localIdx != dblA.getLinear(idx).localIdx)
+          {
+            ++status;
+          }
+      }
+  }
 
 //--Output status
   if (verbose)
@@ -1,9 +1,21 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
 
 #include "BaseFab.H"
+#include "BaseFabMacros.H"
 #include "DisjointBoxLayout.H"
 #include "LevelData.H"
+#include "BoxTasks.H"
+#include "TimerRegistry.H"
+#include "PlotWriter.H"
+#include "Checkpoint.H"
+#include "Reduction.H"
+#include "InSitu.H"
+#include "AutoTune.H"
 
 int main(const int argc, const char* argv[])
 {
@@ -171,6 +183,594 @@ int main(const int argc, const char* argv[])
   }
 #endif
 
+#if 1
+  // Test timed regions
+  if (verbose) std::cout << "Testing timed regions\n";
+  {
+    const bool enabled = TimerRegistry::enabled();
+    TimerRegistry::setEnabled(true);
+    TimerRegistry::reset();
+    lvldata.exchange(copier);
+    int numLocal = 0;
+    long long bytesLocal = 0;
+    for (int midx = 0; midx != copier.numMotionItem(); ++midx)
+      {
+        if (copier[midx].isLocal())
+          {
+            ++numLocal;
+            bytesLocal += copier[midx].regionRecv().size()*2*sizeof(Real);
+          }
+      }
+    const TimerRegistry::Region& regionLocal =
+      TimerRegistry::region("LevelData::exchange local copy");
+    if (regionLocal.m_timer.m_sessions != 1) ++status;
+    if (regionLocal.m_bytes != bytesLocal) ++status;
+    if (TimerRegistry::region("BaseFab::copy").m_timer.m_sessions != numLocal)
+      ++status;
+    // Nothing is recorded if disabled
+    TimerRegistry::setEnabled(false);
+    lvldata.exchange(copier);
+    if (regionLocal.m_timer.m_sessions != 1) ++status;
+    TimerRegistry::reset();
+    TimerRegistry::setEnabled(enabled);
+  }
+#endif
+
+#if 1
+  // Test staged writing of plot files
+  if (verbose) std::cout << "Testing plot writer\n";
+  {
+    static const char *const varNames[] = { "u", "v" };
+    PlotWriter plotWriter("testPlotWriter", IntVect::Zero, 1.);
+    if (plotWriter.plotFileName(12) != "testPlotWriter000012.cgns") ++status;
+    if (plotWriter.write(lvldata, 0, varNames) != 0) ++status;
+    // The second write waits for the first to complete
+    if (plotWriter.write(lvldata, 1, varNames) != 0) ++status;
+    if (plotWriter.wait() != 0) ++status;
+    if (plotWriter.numWritten() != 2) ++status;
+  }
+#endif
+
+#if 1
+  // Test the copier cache
+  {
+    Copier& cacheCopier1 = CopierCache::exchangeLD(lvldata);
+    Copier& cacheCopier2 = CopierCache::exchangeLD(lvldata);
+    // Same pattern returns the same copier
+    if (&cacheCopier1 != &cacheCopier2) ++status;
+    if (CopierCache::size() != 1) ++status;
+    if (!cacheCopier1.persistent()) ++status;
+    if (cacheCopier1.numMotionItem() != copier.numMotionItem()) ++status;
+    // Different trim or component range gives a different copier
+    Copier& cacheCopier3 =
+      CopierCache::exchangeDBL<Real>(dbl, 1, 0, 2, 0u, TrimCorner);
+    if (&cacheCopier3 == &cacheCopier1) ++status;
+    CopierCache::exchangeDBL<Real>(dbl, 1, 1, 1);
+    if (CopierCache::size() != 3) ++status;
+    // A LevelData with the same layout, ncomp, and nghost shares the copier
+    LevelData<BaseFab<Real> > lvldata2(dbl, 2, 1);
+    if (&CopierCache::exchangeLD(lvldata2) != &cacheCopier1) ++status;
+    // Exchange with the cached copier should match the original exchange
+    lvldata2.setVal(0.);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        lvldata2[dit].copy(dbl[dit], lvldata[dit]);
+      }
+    lvldata2.exchange(cacheCopier1);
+    for (int c = 0; c != numBox; ++c)
+      {
+        const BaseFab<Real>& fab1 = lvldata.getLinear(c);
+        const BaseFab<Real>& fab2 = lvldata2.getLinear(c);
+        // Ghosts outside the domain are not filled
+        Box region(fab1.box());
+        region &= domain;
+        for (BoxIterator bit(region); bit.ok(); ++bit)
+          {
+            if (fab1(*bit, 0) != fab2(*bit, 0) ||
+                fab1(*bit, 1) != fab2(*bit, 1)) ++status;
+          }
+      }
+    CopierCache::clear();
+    if (CopierCache::size() != 0) ++status;
+  }
+#endif
+
+#if 1
+  // Test the box task scheduler
+  if (verbose) std::cout << "Testing forEachBox\n";
+  {
+    const int maxTileCellsSave = BoxTasks::maxTileCells();
+    // Boxes have 4 cells in the outermost direction.  Ask for 3 tiles.
+    BoxTasks::setMaxTileCells((4*IntVect::Unit).product()/3 + 1);
+    const Box& box0 = dbl.getLinear(0).box;
+    const int numTile = BoxTasks::numTile(box0);
+    if (numTile != 3) ++status;
+    int numCellTiles = 0;
+    for (int idxTile = 0; idxTile != numTile; ++idxTile)
+      {
+        const Box tile = BoxTasks::tile(box0, numTile, idxTile);
+        if (!box0.contains(tile)) ++status;
+        numCellTiles += tile.size();
+      }
+    if (numCellTiles != box0.size()) ++status;
+    // Never more tiles than cells in the outermost direction
+    BoxTasks::setMaxTileCells(1);
+    if (BoxTasks::numTile(box0) != 4) ++status;
+    BoxTasks::setMaxTileCells(0);
+    if (BoxTasks::numTile(box0) != 1) ++status;
+    BoxTasks::setMaxTileCells((4*IntVect::Unit).product()/3 + 1);
+
+    // Every interior cell is visited exactly once
+    LevelData<BaseFab<Real> > lvlvisit(dbl, 1, 1);
+    lvlvisit.setVal(0.);
+    lvlvisit.forEachBox([&](const BoxIndex& a_bidx, const Box& a_tile)
+      {
+        BaseFab<Real>& fab = lvlvisit[a_bidx];
+        MD_BOXLOOP(a_tile, i)
+          {
+            fab(IntVect(D_DECL(i0, i1, i2)), 0) += 1.;
+          }
+      });
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        const BaseFab<Real>& fab = lvlvisit[dit];
+        for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+          {
+            const Real expected = (dbl[dit].contains(*bit)) ? 1. : 0.;
+            if (fab(*bit, 0) != expected) ++status;
+          }
+      }
+
+    // With a copier, ghost cells of a box are filled before its tiles are
+    // processed.  Sum the face neighbours within the domain.
+    LevelData<BaseFab<Real> > lvlsrc(dbl, 2, 1);
+    LevelData<BaseFab<Real> > lvlsum(dbl, 1, 0);
+    lvlsrc.setVal(0.);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        lvlsrc[dit].copy(dbl[dit], lvldata[dit]);
+      }
+    lvlsrc.exchangeBegin(copier);
+    lvlsrc.forEachBox(copier, [&](const BoxIndex& a_bidx, const Box& a_tile)
+      {
+        const BaseFab<Real>& fabSrc = lvlsrc[a_bidx];
+        BaseFab<Real>& fabSum = lvlsum[a_bidx];
+        MD_BOXLOOP(a_tile, i)
+          {
+            const IntVect iv(D_DECL(i0, i1, i2));
+            Real sum = 0.;
+            for (int dir = 0; dir != g_SpaceDim; ++dir)
+              {
+                for (int side = -1; side <= 1; side += 2)
+                  {
+                    IntVect ivNbr(iv);
+                    ivNbr[dir] += side;
+                    if (domain.contains(ivNbr)) sum += fabSrc(ivNbr, 0);
+                  }
+              }
+            fabSum(iv, 0) = sum;
+          }
+      });
+    lvlsrc.exchangeEnd(copier);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        const BaseFab<Real>& fab = lvldata[dit];
+        const BaseFab<Real>& fabSum = lvlsum[dit];
+        for (BoxIterator bit(dbl[dit]); bit.ok(); ++bit)
+          {
+            Real sum = 0.;
+            for (int dir = 0; dir != g_SpaceDim; ++dir)
+              {
+                for (int side = -1; side <= 1; side += 2)
+                  {
+                    IntVect ivNbr(*bit);
+                    ivNbr[dir] += side;
+                    if (domain.contains(ivNbr)) sum += fab(ivNbr, 0);
+                  }
+              }
+            if (fabSum(*bit, 0) != sum) ++status;
+          }
+      }
+    BoxTasks::setMaxTileCells(maxTileCellsSave);
+  }
+#endif
+
+#ifndef USE_MPI
+  // Test reductions (with MPI, see testMPI)
+  if (verbose) std::cout << "Testing reductions\n";
+  {
+    // Ghost cells are set to a large value that must not be seen
+    LevelData<BaseFab<Real> > lvlred(dbl, 2, 1);
+    lvlred.setVal(1000.);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        BaseFab<Real>& fab = lvlred[dit];
+        for (BoxIterator bit(dbl[dit]); bit.ok(); ++bit)
+          {
+            fab(*bit, 0) = (*bit)[0] + 1;
+            fab(*bit, 1) = -(*bit).sum();
+          }
+      }
+    const Box region(IntVect(D_DECL(1, 2, 3)), IntVect(D_DECL(5, 6, 4)));
+    Real sum0 = 0., sumRegion = 0., sumSq0 = 0., sumAbs1 = 0.;
+    Real min1 = 0., max0 = 0.;
+    for (BoxIterator bit(domain); bit.ok(); ++bit)
+      {
+        const Real val0 = (*bit)[0] + 1;
+        const Real val1 = -(*bit).sum();
+        sum0 += val0;
+        if (region.contains(*bit)) sumRegion += val0;
+        sumSq0 += val0*val0;
+        sumAbs1 += std::fabs(val1);
+        min1 = std::min(min1, val1);
+        max0 = std::max(max0, val0);
+      }
+    if (lvlred.reduce(Reduction::Op::sum, 0, 1) != sum0) ++status;
+    if (lvlred.reduce(Reduction::Op::sum, 0, 1, region) != sumRegion)
+      ++status;
+    if (lvlred.reduce(Reduction::Op::sum, 0, 2) !=
+        sum0 - sumAbs1) ++status;
+    if (lvlred.reduce(Reduction::Op::max, 0, 1) != max0) ++status;
+    if (lvlred.reduce(Reduction::Op::min, 0, 2) != min1) ++status;
+    if (lvlred.reduce(Reduction::Op::norm1, 1, 1) != sumAbs1) ++status;
+    if (lvlred.reduce(Reduction::Op::normInf, 1, 1) != -min1) ++status;
+
+    // Several quantities in one reduction
+    Reduction red;
+    const int iSum  = red.add(Reduction::Op::sum);
+    const int iMin  = red.add(Reduction::Op::min);
+    const int iNorm = red.add(Reduction::Op::norm2);
+    const int iMax  = red.add(Reduction::Op::max);
+    if (red.size() != 4) ++status;
+    lvlred.reduceLocal(red, iSum, 0, 1);
+    lvlred.reduceLocal(red, iMin, 1, 1);
+    lvlred.reduceLocal(red, iNorm, 0, 1);
+    lvlred.reduceLocal(red, iMax, 0, 1, region);
+    red.allreduce();
+    if (red.result(iSum) != sum0) ++status;
+    if (red.result(iMin) != min1) ++status;
+    if (red.result(iNorm) != std::sqrt(sumSq0)) ++status;
+    if (red.result(iMax) != region.hiVect()[0] + 1) ++status;
+
+    // Partials are reset by allreduce and can be accumulated from tiles
+    // in a sweep
+    lvlred.forEachBox([&](const BoxIndex& a_bidx, const Box& a_tile)
+      {
+        red.accumulate(iSum, Reduction::reduceBox(Reduction::Op::sum,
+                                                  lvlred[a_bidx], a_tile,
+                                                  0, 1));
+      });
+    red.allreduceBegin();
+    if (!red.pending()) ++status;
+    red.allreduceEnd();
+    if (red.result(iSum) != sum0) ++status;
+    if (red.result(iMin) != Reduction::identity(Reduction::Op::min)) ++status;
+
+    // Layouts other than planar
+    BaseFab<int> fabInter(domain, 2, BaseFab<int>::Layout::interleaved);
+    int sumInter = 0;
+    for (BoxIterator bit(domain); bit.ok(); ++bit)
+      {
+        fabInter(*bit, 0) = 1;
+        fabInter(*bit, 1) = (*bit)[1];
+        sumInter += (*bit)[1];
+      }
+    if (Reduction::reduceBox(Reduction::Op::sum, fabInter, domain, 1, 1) !=
+        sumInter) ++status;
+    if (Reduction::reduceBox(Reduction::Op::max, fabInter, domain, 1, 1) !=
+        domain.hiVect()[1]) ++status;
+  }
+#endif
+
+#ifndef USE_MPI
+  // Test in-situ products and stages (with MPI, see testMPI)
+  if (verbose) std::cout << "Testing in-situ analysis\n";
+  {
+    LevelData<BaseFab<Real> > lvlsitu(dbl, 2, 1);
+    lvlsitu.setVal(1000.);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        BaseFab<Real>& fab = lvlsitu[dit];
+        for (BoxIterator bit(dbl[dit]); bit.ok(); ++bit)
+          {
+            fab(*bit, 0) = (*bit)[0];
+            fab(*bit, 1) = (*bit)[g_SpaceDim-1];
+          }
+      }
+
+    // Coarsened field
+    std::vector<Real> prod;
+    InSitu::sample(lvlsitu, domain, 2, 0, 2, prod);
+    const Box crDomain = Box(domain).coarsen(2);
+    if ((int)prod.size() != 2*crDomain.size()) ++status;
+    {
+      int idx = 0;
+      for (BoxIterator bit(crDomain); bit.ok(); ++bit, ++idx)
+        {
+          if (prod[idx] != 2*(*bit)[0] + 0.5) ++status;
+          if (prod[crDomain.size() + idx] != 2*(*bit)[g_SpaceDim-1] + 0.5)
+            ++status;
+        }
+    }
+    // Coarse cells only partly in the region or outside the level
+    IntVect loPart = IntVect::Zero;
+    loPart[0] = 1;
+    IntVect hiPart = IntVect::Zero;
+    hiPart[0] = 9;
+    InSitu::sample(lvlsitu, Box(loPart, hiPart), 2, 0, 1, prod);
+    if (prod.size() != 5) ++status;
+    if (prod[0] != 1. || prod[1] != 2.5 || prod[3] != 6.5 || prod[4] != 0.)
+      ++status;
+    // Slice and probe
+    IntVect loSlice = domain.loVect();
+    IntVect hiSlice = domain.hiVect();
+    loSlice[0] = 5;
+    hiSlice[0] = 5;
+    InSitu::sample(lvlsitu, Box(loSlice, hiSlice), 1, 0, 1, prod);
+    if ((int)prod.size() != Box(loSlice, hiSlice).size()) ++status;
+    if (*std::min_element(prod.begin(), prod.end()) != 5. ||
+        *std::max_element(prod.begin(), prod.end()) != 5.) ++status;
+    const IntVect ivProbe(D_DECL(3, 6, 2));
+    InSitu::sample(lvlsitu, Box(ivProbe, ivProbe), 1, 1, 1, prod);
+    if (prod.size() != 1 || prod[0] != ivProbe[g_SpaceDim-1]) ++status;
+
+    // Histograms (values outside the range are in the end bins)
+    std::vector<Real> count;
+    InSitu::histogram(lvlsitu, 0, 0., 8., 8, count);
+    if (count.size() != 8) ++status;
+    for (int iBin = 0; iBin != 8; ++iBin)
+      {
+        if (count[iBin] != domain.size()/8) ++status;
+      }
+    InSitu::histogram(lvlsitu, 0, 2., 6., 2, count);
+    if (count[0] != domain.size()/2 || count[1] != domain.size()/2) ++status;
+    InSitu::histogram(lvlsitu, 0, 0., 8., 4, count, Box(loSlice, hiSlice));
+    if (count[2] != Box(loSlice, hiSlice).size() || count[0] != 0.) ++status;
+
+    // Stages run at their own intervals
+    InSitu insitu;
+    std::vector<int> iterRun;
+    const int iStage0 = insitu.add("every3", 3, [&](const int a_iter)
+      {
+        iterRun.push_back(a_iter);
+      }, 1);
+    const int iStage1 = insitu.add("every4", 4, [&](const int a_iter)
+      {
+        iterRun.push_back(-a_iter);
+      });
+    if (insitu.size() != 2 || insitu.name(iStage1) != "every4") ++status;
+    if (insitu.due(2) || !insitu.due(4) || !insitu.due(iStage0, 7)) ++status;
+    int numRun = 0;
+    for (int iter = 0; iter != 9; ++iter)
+      {
+        numRun += insitu.run(iter);
+      }
+    if (numRun != 6) ++status;
+    if (insitu.numRun(iStage0) != 3 || insitu.numRun(iStage1) != 3) ++status;
+    if (iterRun != std::vector<int>({ 0, 1, 4, -4, 7, -8 })) ++status;
+
+    // Products are written from process 0
+    if (InSitu::fileName("testInSitu", 12) != "testInSitu000012.dat")
+      ++status;
+    InSitu::sample(lvlsitu, domain, 4, 0, 2, prod);
+    if (InSitu::writeSample("testInSituSample.dat", domain, 4, 2, prod) != 0)
+      ++status;
+    if (InSitu::writeHistogram("testInSituHist.dat", 0., 8., count) != 0)
+      ++status;
+    {
+      InSitu::TimeSeries series("testInSituProbe.dat", { "u", "v" }, 2);
+      if (series.numColumn() != 2) ++status;
+      for (int iter = 0; iter != 3; ++iter)
+        {
+          if (series.record(iter, { (Real)iter, 2.*iter }) != 0) ++status;
+        }
+    }
+    if (DisjointBoxLayout::procID() == 0)
+      {
+        std::ifstream file("testInSituProbe.dat");
+        std::string line, lastLine;
+        int numLine = 0;
+        while (std::getline(file, line))
+          {
+            lastLine = line;
+            ++numLine;
+          }
+        if (numLine != 4 || lastLine != "2 2 4") ++status;
+      }
+  }
+#endif
+
+#ifndef USE_MPI
+  // Test autotuning (with MPI, see testMPI)
+  if (verbose) std::cout << "Testing autotuning\n";
+  {
+    const IntVect tileShapeSave = BoxTasks::tileShape();
+    const int maxTileCellsSave = BoxTasks::maxTileCells();
+    std::remove("testAutoTune.cache");
+    const std::vector<AutoTune::Config> configs = AutoTune::candidates(
+      { 2*IntVect::Unit, 4*IntVect::Unit, 3*IntVect::Unit },
+      { 0, 16 },
+      { IntVect(D_DECL(0, 2, 2)) },
+      { 1 });
+    if (configs.size() != 6) ++status;
+    if (configs[1].m_boxSize != 2*IntVect::Unit ||
+        configs[1].m_maxTileCells != 16) ++status;
+    AutoTune tuner("testAutoTune.cache", "test level");
+    if (tuner.key().find("test_level") == std::string::npos) ++status;
+    AutoTune::Config config = AutoTune::current(8*IntVect::Unit);
+    if (tuner.lookup(config) == 0) ++status;
+    // Box size 3 does not divide the domain and 4 with tiles of 16 cells
+    // is fastest.  Candidates are applied before each trial.
+    int numTrial = 0;
+    config = tuner.tune(configs, [&](const AutoTune::Config& a_config)
+      -> double
+      {
+        if (BoxTasks::maxTileCells() != a_config.m_maxTileCells) ++status;
+        ++numTrial;
+        if (a_config.m_boxSize[0] == 3) return -1.;
+        DisjointBoxLayout dblTrial(domain, a_config.m_boxSize);
+        return dblTrial.size()/(1. + (a_config.m_maxTileCells > 0));
+      });
+    if (numTrial != 6 || tuner.numTrial() != 6) ++status;
+    if (tuner.trialTime(4) >= 0. ||
+        tuner.trialTime(3) != 0.5*numBox) ++status;
+    if (config.m_boxSize != 4*IntVect::Unit || config.m_maxTileCells != 16)
+      ++status;
+    if (BoxTasks::maxTileCells() != 16 ||
+        BoxTasks::tileShape() != IntVect(D_DECL(0, 2, 2))) ++status;
+    // Later runs find the configuration, tuned for the machine and problem
+    AutoTune::Config found = AutoTune::current(8*IntVect::Unit);
+    if (tuner.lookup(found) != 0) ++status;
+    if (found.m_boxSize != config.m_boxSize ||
+        found.m_maxTileCells != config.m_maxTileCells ||
+        found.m_tileShape != config.m_tileShape ||
+        found.m_numThread != config.m_numThread) ++status;
+    AutoTune other("testAutoTune.cache", "other problem");
+    if (other.lookup(found) == 0) ++status;
+    // Saving replaces the line for the key and keeps others
+    config.m_boxSize = 2*IntVect::Unit;
+    if (other.save(config, 3.) != 0) ++status;
+    if (tuner.save(config, 2.) != 0) ++status;
+    if (other.lookup(found) != 0 || tuner.lookup(found) != 0) ++status;
+    if (found.m_boxSize != 2*IntVect::Unit) ++status;
+    {
+      std::ifstream file("testAutoTune.cache");
+      std::string line;
+      int numLine = 0;
+      while (std::getline(file, line)) ++numLine;
+      if (numLine != 2) ++status;
+    }
+    BoxTasks::setTileShape(tileShapeSave);
+    BoxTasks::setMaxTileCells(maxTileCellsSave);
+  }
+#endif
+
+  // Test deferred allocation
+  if (verbose) std::cout << "Testing deferred allocation\n";
+  {
+    using Allocation = LevelData<BaseFab<Real> >::Allocation;
+    LevelData<BaseFab<Real> > lvlImmediate(dbl, 2, 1);
+    if (!lvlImmediate.allocated()) ++status;
+    LevelData<BaseFab<Real> > lvlDeferred(dbl, 2, 1, Allocation::deferred);
+    if (lvlDeferred.allocated()) ++status;
+    if (lvlDeferred.size() != dbl.localSize()) ++status;
+    // The first setVal allocates
+    lvlDeferred.setVal(1, 3.);
+    if (!lvlDeferred.allocated()) ++status;
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        const BaseFab<Real>& fab = lvlDeferred[dit];
+        if (fab.box() != Box(dbl[dit]).grow(1)) ++status;
+        if (fab.ncomp() != 2) ++status;
+        for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+          {
+            if (fab(*bit, 1) != 3.) ++status;
+          }
+      }
+    // Redefining with deferred allocation releases the boxes, and
+    // forEachBox allocates
+    lvlDeferred.define(dbl, 1, 0, Allocation::deferred);
+    if (lvlDeferred.allocated()) ++status;
+    int numCell = 0;
+    lvlDeferred.forEachBox([&](const BoxIndex& a_bidx, const Box& a_tile)
+      {
+        BaseFab<Real>& fab = lvlDeferred[a_bidx];
+        MD_BOXLOOP(a_tile, i)
+          {
+            fab(IntVect(D_DECL(i0, i1, i2)), 0) = 2.;
+          }
+#pragma omp atomic
+        numCell += a_tile.size();
+      });
+    if (!lvlDeferred.allocated()) ++status;
+    int numCellValid = 0;
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        const BaseFab<Real>& fab = lvlDeferred[dit];
+        if (fab.box() != dbl[dit]) ++status;
+        numCellValid += fab.box().size();
+        for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+          {
+            if (fab(*bit, 0) != 2.) ++status;
+          }
+      }
+    if (numCell != numCellValid) ++status;
+  }
+
+#ifndef USE_MPI
+  // Test checkpoint and restart (with MPI, see testMPIExchange)
+  if (verbose) std::cout << "Testing checkpoint\n";
+  {
+    LevelData<BaseFab<int> > lvlint(dbl, 1, 0);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        lvlint[dit].setVal((*dit).globalIndex());
+      }
+    CheckpointWriter writer(dbl);
+    writer.add(lvldata);
+    writer.add(lvlint);
+    writer.setAttributes({ 7, 2 }, { 0.25 });
+    if (writer.write("testCheckpoint.chk") != 0) ++status;
+
+    CheckpointReader reader("testCheckpoint.chk");
+    if (!reader.ok()) ++status;
+    if (reader.numData() != 2) ++status;
+    if (reader.intAttributes() != std::vector<long long>({ 7, 2 })) ++status;
+    if (reader.realAttributes() != std::vector<double>({ 0.25 })) ++status;
+    DisjointBoxLayout dblRestart;
+    reader.defineLayout(dblRestart);
+    if (dblRestart.size() != dbl.size()) ++status;
+    if (!(dblRestart.problemDomain() == dbl.problemDomain())) ++status;
+    // Element types must match
+    LevelData<BaseFab<int> > lvlbad;
+    if (reader.read(0, dblRestart, lvlbad) == 0) ++status;
+    // All cells, including ghosts, are restored by copying or aliasing
+    LevelData<BaseFab<Real> > lvlcopy;
+    LevelData<BaseFab<Real> > lvlalias;
+    if (reader.read(0, dblRestart, lvlcopy) != 0) ++status;
+    if (reader.read(0, dblRestart, lvlalias,
+                    CheckpointReader::Mode::alias) != 0) ++status;
+    if (lvlcopy.ncomp() != 2 || lvlcopy.nghost() != 1) ++status;
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        const BaseFab<Real>& fab = lvldata[dit];
+        const BaseFab<Real>& fabCopy = lvlcopy[(*dit)];
+        const BaseFab<Real>& fabAlias = lvlalias[(*dit)];
+        if (!(fabCopy.box() == fab.box())) ++status;
+        for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+          {
+            if (fabCopy(*bit, 0) != fab(*bit, 0) ||
+                fabCopy(*bit, 1) != fab(*bit, 1) ||
+                fabAlias(*bit, 0) != fab(*bit, 0) ||
+                fabAlias(*bit, 1) != fab(*bit, 1)) ++status;
+          }
+      }
+    // Changes to aliased data do not change the file
+    lvlalias.setVal(-1.);
+    CheckpointReader reader2("testCheckpoint.chk");
+    if (reader2.read(0, dblRestart, lvlcopy) != 0) ++status;
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        const BaseFab<Real>& fab = lvldata[dit];
+        const BaseFab<Real>& fabCopy = lvlcopy[(*dit)];
+        for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+          {
+            if (fabCopy(*bit, 1) != fab(*bit, 1)) ++status;
+          }
+      }
+    LevelData<BaseFab<int> > lvlintRestart;
+    if (reader.read(1, dblRestart, lvlintRestart) != 0) ++status;
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        const BaseFab<int>& fab = lvlintRestart[(*dit)];
+        for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+          {
+            if (fab(*bit, 0) != (*dit).globalIndex()) ++status;
+          }
+      }
+  }
+#endif
+
 //--Output status
 
   if (verbose)
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
@@ -6,6 +9,10 @@
 #include "BaseFab.H"
 #include "DisjointBoxLayout.H"
 #include "LevelData.H"
+#include "BoxTasks.H"
+#include "Reduction.H"
+#include "InSitu.H"
+#include "AutoTune.H"
 
 int main(int argc, const char* argv[])
 {
@@ -219,6 +226,68 @@ int main(int argc, const char* argv[])
       MPI_Barrier(MPI_COMM_WORLD);
     }
 
+  // Reductions over both processes with a single collective
+  {
+    Reduction red;
+    const int iSum = red.add(Reduction::Op::sum);
+    const int iMin = red.add(Reduction::Op::min);
+    const int iMax = red.add(Reduction::Op::max);
+    const int iNorm = red.add(Reduction::Op::norm2);
+    for (const int iq : { iSum, iMin, iMax, iNorm })
+      {
+        lvldata.reduceLocal(red, iq, 0, 1);
+      }
+    red.allreduce();
+    const Real numCell = dbl.getLinear(0).box.size();
+    if (red.result(iSum) != numCell*(0.5 + 1.5)) ++status;
+    if (red.result(iMin) != 0.5) ++status;
+    if (red.result(iMax) != 1.5) ++status;
+    if (red.result(iNorm) != std::sqrt(numCell*(0.25 + 2.25))) ++status;
+    if (lvldata.reduce(Reduction::Op::max, 0, 1) != 1.5) ++status;
+  }
+
+  // In-situ products combine the cells of both processes
+  {
+    std::vector<Real> prod;
+    InSitu::sample(lvldata, domain, 4, 0, 1, prod);
+    if (prod.size() != 2 || prod[0] != 0.5 || prod[1] != 1.5) ++status;
+    InSitu::sample(lvldata, domain, 8, 0, 1, prod);
+    if (prod.size() != 1 || prod[0] != 1.) ++status;
+    std::vector<Real> count;
+    InSitu::histogram(lvldata, 0, 0., 2., 2, count);
+    const Real numCell = dbl.getLinear(0).box.size();
+    if (count[0] != numCell || count[1] != numCell) ++status;
+  }
+
+  // Autotuning selects the candidate with the smallest maximum time over
+  // the processes and all processes find it in the cache
+  {
+    if (masterProc) std::remove("testAutoTune.cache");
+    const std::vector<AutoTune::Config> configs = AutoTune::candidates(
+      { 2*IntVect::Unit, 4*IntVect::Unit, 8*IntVect::Unit },
+      { 0 },
+      { BoxTasks::tileShape() },
+      { 0 });
+    AutoTune tuner("testAutoTune.cache", "test mpi");
+    AutoTune::Config config = AutoTune::current(IntVect::Unit);
+    if (tuner.lookup(config) == 0) ++status;
+    config = tuner.tune(configs, [&](const AutoTune::Config& a_config)
+      -> double
+      {
+        const int idx = (a_config.m_boxSize[0] == 2) ? 0 :
+          ((a_config.m_boxSize[0] == 4) ? 1 : 2);
+        // The last candidate is not valid on process 1
+        const double time[2][3] = { { 1., 2., 0.5 }, { 3., 1., -1. } };
+        return time[std::min(procID, 1)][idx];
+      });
+    if (config.m_boxSize != 4*IntVect::Unit) ++status;
+    if (tuner.trialTime(0) != 3. || tuner.trialTime(2) >= 0.) ++status;
+    AutoTune::Config found = AutoTune::current(IntVect::Unit);
+    if (tuner.lookup(found) != 0 || found.m_boxSize != 4*IntVect::Unit)
+      ++status;
+    if (masterProc) std::remove("testAutoTune.cache");
+  }
+
   // Get sum of all status into master process
   int allStatus;
   MPI_Reduce(&status, &allStatus, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
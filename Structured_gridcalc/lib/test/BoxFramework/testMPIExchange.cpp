@@ -1,10 +1,17 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <vector>
 
 #include "BaseFab.H"
+#include "BaseFabMacros.H"
 #include "DisjointBoxLayout.H"
 #include "LevelData.H"
+#include "BoxTasks.H"
+#include "Checkpoint.H"
 
 int main(int argc, const char* argv[])
 {
@@ -153,6 +160,449 @@ int main(int argc, const char* argv[])
     }
 #endif
 
+#if 1
+  // Tasks for a box only start once its messages have arrived
+  {
+    const int maxTileCellsSave = BoxTasks::maxTileCells();
+    BoxTasks::setMaxTileCells(1);  // One tile per cell in outermost dir.
+    LevelData<BaseFab<Real> > lvltask(dbl, 1, 1);
+    LevelData<BaseFab<Real> > lvlghost(dbl, 1, 0);
+    lvltask.setVal(-1.);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        lvltask[dit].copy(dbl[dit], lvldata[dit]);
+      }
+    lvltask.exchangeBegin(copier);
+    lvltask.forEachBox(copier, [&](const BoxIndex& a_bidx, const Box& a_tile)
+      {
+        // Copy the ghost value next to each cell of the tile on the side
+        // facing the other process
+        const int side = 1 - 2*procID;
+        const BaseFab<Real>& fabTask = lvltask[a_bidx];
+        BaseFab<Real>& fabGhost = lvlghost[a_bidx];
+        MD_BOXLOOP(a_tile, i)
+          {
+            const IntVect iv(D_DECL(i0, i1, i2));
+            IntVect ivGhost(iv);
+            ivGhost[0] = (side == 1) ? dbl[a_bidx].hiVect(0) + 1 :
+                                       dbl[a_bidx].loVect(0) - 1;
+            fabGhost(iv, 0) = fabTask(ivGhost, 0);
+          }
+      });
+    lvltask.exchangeEnd(copier);
+    // Expect value from other processor
+    const Real val = (procID == 0) ? 1.5 : 0.5;
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        const BaseFab<Real>& fabGhost = lvlghost[dit];
+        for (BoxIterator bit(dbl[dit]); bit.ok(); ++bit)
+          {
+            if (fabGhost(*bit, 0) != val) ++status;
+          }
+      }
+    BoxTasks::setMaxTileCells(maxTileCellsSave);
+  }
+#endif
+
+#if 1
+  // Exchange with boxes distributed among processes in a non-contiguous
+  // manner (alternating global indices) and along a Hilbert curve.  Each
+  // is exchanged with a message per motion item, with messages aggregated
+  // by process, with aggregated persistent messages, and through memory
+  // shared by the processes of the node.
+  {
+    const Box domain2(IntVect::Zero, 15*IntVect::Unit);
+    std::vector<int> boxProc(64);
+    for (int i = 0; i != 64; ++i)
+      {
+        boxProc[i] = i % numProc;
+      }
+    DisjointBoxLayout dbls[2];
+    dbls[0].define(domain2, 4*IntVect::Unit, boxProc);
+    dbls[1].define(domain2, 4*IntVect::Unit,
+                   DisjointBoxLayout::Distribution::hilbert);
+    for (int iTest = 0; iTest != 8; ++iTest)
+      {
+        const DisjointBoxLayout& dbl2 = dbls[iTest/4];
+        LevelData<BaseFab<Real> > lvldata2(dbl2, 1, 1);
+        lvldata2.setVal(-1.);
+        for (DataIterator dit(dbl2); dit.ok(); ++dit)
+          {
+            BaseFab<Real>& fab = lvldata2[dit];
+            for (BoxIterator bit(dbl2[dit]); bit.ok(); ++bit)
+              {
+                fab(*bit, 0) = (*dit).globalIndex() + 1.;
+              }
+          }
+        Copier copier2;
+        copier2.defineExchangeLD(lvldata2);
+        if (iTest % 4 != 0)
+          {
+            copier2.defineAggregate();
+            // Two requests for each other process
+            if (copier2.numRequest() != 2*(numProc - 1)) ++status;
+          }
+        if (iTest % 4 >= 2)
+          {
+            copier2.definePersistent();
+          }
+        if (iTest % 4 == 3)
+          {
+            lvldata2.allocateShared();
+            if (!lvldata2.shared()) ++status;
+            copier2.defineNodeShared();
+            // Messages are only required to other nodes
+            int numOffNode = 0;
+            for (int iProc = 0; iProc != numProc; ++iProc)
+              {
+                if (DisjointBoxLayout::nodeRank(iProc) < 0) ++numOffNode;
+              }
+            if (copier2.numRequest() != 2*numOffNode) ++status;
+          }
+        for (int iReq = 0; iReq != copier2.numRequest(); iReq += 2)
+          {
+            for (int i = 0; i != copier2.numRequestItem(iReq); ++i)
+              {
+                if (copier2[copier2.motionItemIndex(iReq, i)].isLocal())
+                  {
+                    ++status;
+                  }
+              }
+          }
+        lvldata2.exchange(copier2);
+        // Every ghost cell inside the domain holds the global index of the
+        // box owning that cell
+        for (DataIterator dit(dbl2); dit.ok(); ++dit)
+          {
+            BaseFab<Real>& fab = lvldata2[dit];
+            Box ghostBox = fab.box();
+            ghostBox &= domain2;
+            for (BoxIterator bit(ghostBox); bit.ok(); ++bit)
+              {
+                const IntVect ivBox = (*bit)/(4*IntVect::Unit);
+                const int globalIdx = D_TERM(ivBox[0],
+                                             + 4*ivBox[1],
+                                             + 16*ivBox[2]);
+                if (fab(*bit, 0) != globalIdx + 1.) ++status;
+              }
+          }
+        if (iTest % 4 == 3)
+          {
+            // Again with new values in the shared boxes
+            for (DataIterator dit(dbl2); dit.ok(); ++dit)
+              {
+                BaseFab<Real>& fab = lvldata2[dit];
+                for (BoxIterator bit(dbl2[dit]); bit.ok(); ++bit)
+                  {
+                    fab(*bit, 0) = -((*dit).globalIndex() + 1.);
+                  }
+              }
+            lvldata2.exchange(copier2);
+            for (DataIterator dit(dbl2); dit.ok(); ++dit)
+              {
+                BaseFab<Real>& fab = lvldata2[dit];
+                Box ghostBox = fab.box();
+                ghostBox &= domain2;
+                for (BoxIterator bit(ghostBox); bit.ok(); ++bit)
+                  {
+                    const IntVect ivBox = (*bit)/(4*IntVect::Unit);
+                    const int globalIdx = D_TERM(ivBox[0],
+                                                 + 4*ivBox[1],
+                                                 + 16*ivBox[2]);
+                    if (fab(*bit, 0) != -(globalIdx + 1.)) ++status;
+                  }
+              }
+          }
+      }
+  }
+#endif
+
+#if 1
+  // Exchange with periodic boundaries on an irregular layout.  Some boxes
+  // have several neighbors in the same direction.  The boxes are
+  // distributed in an alternating manner and along a Hilbert curve, and
+  // exchanged with a message per motion item and aggregated by process.
+  {
+    // Slabs of different thickness in direction 0, split at different
+    // places in direction 1.  There is no box covering 4 <= i0 <= 9,
+    // i1 >= 6.
+    const Box domain2(IntVect::Zero, 15*IntVect::Unit);
+    const std::vector<Box> boxes = {
+      Box(IntVect(D_DECL( 0, 0, 0)), IntVect(D_DECL( 3,  7, 15))),
+      Box(IntVect(D_DECL( 0, 8, 0)), IntVect(D_DECL( 3, 15, 15))),
+      Box(IntVect(D_DECL( 4, 0, 0)), IntVect(D_DECL( 9,  5, 15))),
+      Box(IntVect(D_DECL(10, 0, 0)), IntVect(D_DECL(15,  7, 15))),
+      Box(IntVect(D_DECL(10, 8, 0)), IntVect(D_DECL(15, 15, 15)))
+    };
+    const int numBox2 = boxes.size();
+    const unsigned periodic = (1 << g_SpaceDim) - 1;
+    std::vector<int> boxProc(numBox2);
+    for (int i = 0; i != numBox2; ++i)
+      {
+        boxProc[i] = i % numProc;
+      }
+    DisjointBoxLayout dbls[2];
+    dbls[0].defineIrregular(domain2, boxes, boxProc);
+    dbls[1].defineIrregular(domain2, boxes,
+                            DisjointBoxLayout::Distribution::hilbert);
+    for (int iTest = 0; iTest != 4; ++iTest)
+      {
+        const DisjointBoxLayout& dbl2 = dbls[iTest/2];
+        LevelData<BaseFab<Real> > lvldata2(dbl2, 1, 2);
+        lvldata2.setVal(-1.);
+        for (DataIterator dit(dbl2); dit.ok(); ++dit)
+          {
+            BaseFab<Real>& fab = lvldata2[dit];
+            for (BoxIterator bit(dbl2[dit]); bit.ok(); ++bit)
+              {
+                fab(*bit, 0) = (*dit).globalIndex() + 1.;
+              }
+          }
+        Copier copier2;
+        copier2.defineExchangeLD(lvldata2, periodic);
+        if (iTest % 2 == 1)
+          {
+            copier2.defineAggregate();
+          }
+        lvldata2.exchange(copier2);
+        // Every ghost cell holds the global index of the box owning the
+        // periodic image of the cell or is untouched in the missing box
+        for (DataIterator dit(dbl2); dit.ok(); ++dit)
+          {
+            const BaseFab<Real>& fab = lvldata2[dit];
+            for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+              {
+                IntVect iv(*bit);
+                for (int dir = 0; dir != g_SpaceDim; ++dir)
+                  {
+                    iv[dir] = (iv[dir] + 16) % 16;
+                  }
+                Real expected = -1.;
+                for (int idx = 0; idx != numBox2; ++idx)
+                  {
+                    if (boxes[idx].contains(iv)) expected = idx + 1.;
+                  }
+                if (fab(*bit, 0) != expected) ++status;
+              }
+          }
+      }
+  }
+#endif
+
+#if 1
+  // Exchange only the components crossing each side of a box.  There is
+  // a component for each direction and a neighbor reads those along its
+  // direction from this box (as for lattice-Boltzmann streaming), so 1/3
+  // of the components cross a face, 1/9 an edge, and 1/27 a corner.
+  // Messages are per motion item, aggregated, persistent, and compressed
+  // (with data that compresses and data that does not).
+  {
+    const Box domain2(IntVect::Zero, 15*IntVect::Unit);
+    const DisjointBoxLayout dbl2(domain2, 4*IntVect::Unit);
+    const unsigned periodic = (1 << g_SpaceDim) - 1;
+    constexpr int numComp = 27;
+    const auto compDir =
+      [](const int a_comp)
+      {
+        return IntVect(D_DECL(a_comp % 3 - 1, (a_comp/3) % 3 - 1, a_comp/9 - 1));
+      };
+    const auto compFlags =
+      [&compDir]
+      (const IntVect& a_dir)
+      {
+        unsigned flags = 0u;
+        for (int ic = 0; ic != numComp; ++ic)
+          {
+            const IntVect e = compDir(ic);
+            bool along = true;
+            for (int dir = 0; dir != g_SpaceDim; ++dir)
+              {
+                if (a_dir[dir] != 0 && e[dir] != a_dir[dir]) along = false;
+              }
+            if (along) flags |= (1u << ic);
+          }
+        return flags;
+      };
+    // Values that compress well (iPass 0) and random bits that do not
+    // (iPass 1)
+    const auto value =
+      [](const int a_iPass, const IntVect& a_iv, const int a_comp)
+      {
+        const int idx = a_comp + numComp*(D_TERM(a_iv[0],
+                                                 + 16*a_iv[1],
+                                                 + 256*a_iv[2]));
+        if (a_iPass == 0) return (Real)idx;
+        std::uint64_t bits = (idx + 1)*0x9E3779B97F4A7C15ull;
+        bits ^= bits >> 31;
+        bits *= 0xBF58476D1CE4E5B9ull;
+        bits ^= bits >> 29;
+        Real x;
+        std::memcpy(&x, &bits, sizeof(Real));
+        return std::isfinite(x) ? x : (Real)idx;
+      };
+    for (int iTest = 0; iTest != 4; ++iTest)
+      {
+        LevelData<BaseFab<Real> > lvldata2(dbl2, numComp, 1);
+        Copier copier2;
+        copier2.defineExchangeLD(lvldata2, periodic);
+        if (iTest == 3)
+          {
+            // Flags after aggregation and persistence
+            copier2.defineAggregate();
+            copier2.definePersistent();
+          }
+        copier2.defineCompFlags(compFlags);
+        if (iTest == 1) copier2.defineAggregate();
+        if (iTest >= 2)
+          {
+            copier2.defineCompression(1);
+            if (!copier2.aggregate()) ++status;
+          }
+        if (iTest == 2) copier2.definePersistent();
+        int sendBytes = 0;
+        int sendBytesAll = 0;
+        for (int midx = 0; midx != copier2.numMotionItem(); ++midx)
+          {
+            const Motion2Way& motion = copier2[midx];
+            if (motion.isLocal()) continue;
+            // 3^(number of directions that are 0)
+            int numSend = 1;
+            for (int dir = 0; dir != g_SpaceDim; ++dir)
+              {
+                if (motion.sendDir()[dir] == 0) numSend *= 3;
+              }
+            // Boxes are the same size so the regions are too
+            const int numCell = motion.regionRecv().size();
+            if (motion.sendBytes() != (int)sizeof(Real)*numSend*numCell)
+              {
+                ++status;
+              }
+            sendBytes += motion.sendBytes();
+            sendBytesAll += numComp*sizeof(Real)*numCell;
+          }
+        if (3*sendBytes > sendBytesAll) ++status;
+        for (int iPass = 0; iPass != 2; ++iPass)
+          {
+            lvldata2.setVal(-1.);
+            for (DataIterator dit(dbl2); dit.ok(); ++dit)
+              {
+                BaseFab<Real>& fab = lvldata2[dit];
+                for (BoxIterator bit(dbl2[dit]); bit.ok(); ++bit)
+                  {
+                    for (int ic = 0; ic != numComp; ++ic)
+                      {
+                        fab(*bit, ic) = value(iPass, *bit, ic);
+                      }
+                  }
+              }
+            lvldata2.exchange(copier2);
+            // A ghost cell in direction o from its box holds the
+            // components along -o (those streaming into the box)
+            for (DataIterator dit(dbl2); dit.ok(); ++dit)
+              {
+                const Box box = dbl2[dit];
+                const BaseFab<Real>& fab = lvldata2[dit];
+                for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+                  {
+                    if (box.contains(*bit)) continue;
+                    IntVect o(IntVect::Zero);
+                    IntVect iv(*bit);
+                    for (int dir = 0; dir != g_SpaceDim; ++dir)
+                      {
+                        if (iv[dir] < box.loVect(dir)) o[dir] = -1;
+                        if (iv[dir] > box.hiVect(dir)) o[dir] = 1;
+                        iv[dir] = (iv[dir] + 16) % 16;
+                      }
+                    const unsigned flags = compFlags(-o);
+                    for (int ic = 0; ic != numComp; ++ic)
+                      {
+                        const Real expected = (flags & (1u << ic)) ?
+                          value(iPass, iv, ic) : -1.;
+                        if (fab(*bit, ic) != expected) ++status;
+                      }
+                  }
+              }
+          }
+      }
+
+    // Halos send some values more than once (e.g., a corner with every
+    // face) so even random bits compress.  A single face of random bits
+    // between the two boxes of dbl does not and is sent uncompressed.
+    LevelData<BaseFab<Real> > lvlraw(dbl, 1, 1);
+    lvlraw.setVal(-1.);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        BaseFab<Real>& fab = lvlraw[dit];
+        for (BoxIterator bit(dbl[dit]); bit.ok(); ++bit)
+          {
+            fab(*bit, 0) = value(1, *bit, 0);
+          }
+      }
+    Copier copierRaw;
+    copierRaw.defineExchangeLD(lvlraw);
+    copierRaw.defineCompression(1);
+    lvlraw.exchange(copierRaw);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        const BaseFab<Real>& fab = lvlraw[dit];
+        Box ghostBox = fab.box();
+        ghostBox &= domain;
+        for (BoxIterator bit(ghostBox); bit.ok(); ++bit)
+          {
+            if (fab(*bit, 0) != value(1, *bit, 0)) ++status;
+          }
+      }
+  }
+#endif
+
+#if 1
+  // Checkpoint with MPI-IO and restart on the same and on a different
+  // distribution of boxes
+  {
+    const Box domain2(IntVect::Zero, 15*IntVect::Unit);
+    const DisjointBoxLayout dbl2(domain2, 4*IntVect::Unit);
+    LevelData<BaseFab<Real> > lvldata2(dbl2, 2, 1);
+    for (DataIterator dit(dbl2); dit.ok(); ++dit)
+      {
+        BaseFab<Real>& fab = lvldata2[dit];
+        for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+          {
+            fab(*bit, 0) = (*dit).globalIndex();
+            fab(*bit, 1) = fab.index(*bit);
+          }
+      }
+    CheckpointWriter writer(dbl2);
+    writer.add(lvldata2);
+    writer.setAttributes({ 42 });
+    if (writer.write("testCheckpoint.chk") != 0) ++status;
+    CheckpointReader reader("testCheckpoint.chk");
+    if (!reader.ok()) ++status;
+    if (reader.intAttributes() != std::vector<long long>({ 42 })) ++status;
+    DisjointBoxLayout dbls[2];
+    reader.defineLayout(dbls[0]);
+    dbls[1].define(domain2, 4*IntVect::Unit,
+                   DisjointBoxLayout::Distribution::hilbert);
+    for (int i = 0; i != dbl2.size(); ++i)
+      {
+        if (dbls[0].getLinear(i).proc != dbl2.getLinear(i).proc) ++status;
+      }
+    for (const DisjointBoxLayout& dblRestart : dbls)
+      {
+        LevelData<BaseFab<Real> > lvlRestart;
+        if (reader.read(0, dblRestart, lvlRestart) != 0) ++status;
+        for (DataIterator dit(dblRestart); dit.ok(); ++dit)
+          {
+            const BaseFab<Real>& fab = lvlRestart[dit];
+            for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+              {
+                if (fab(*bit, 0) != (*dit).globalIndex() ||
+                    fab(*bit, 1) != fab.index(*bit)) ++status;
+              }
+          }
+      }
+  }
+#endif
+
   // Get sum of all status into master process
   int allStatus;
   MPI_Reduce(&status, &allStatus, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
@@ -3,8 +3,10 @@
 #include <sstream>
 
 #include "BaseFab.H"
+#include "BaseFabMacros.H"
 #include "DisjointBoxLayout.H"
 #include "LevelData.H"
+#include "BoxTasks.H"
 
 #define STUDENTSETUP
 
@@ -17,7 +19,9 @@ int main(int argc, const char* argv[])
 
 //--Initialize MPI
 
-  DisjointBoxLayout::initMPI(argc, argv);
+  // Requests MPI_THREAD_MULTIPLE to test the progress thread
+  DisjointBoxLayout::initMPI(argc, argv,
+                             DisjointBoxLayout::ThreadSupport::multiple);
   int numProc = DisjointBoxLayout::numProc();
   int procID = DisjointBoxLayout::procID();
   const bool masterProc = (procID == 0);
@@ -183,6 +187,93 @@ int main(int argc, const char* argv[])
     }
 #endif
 
+#if 1
+  // Repeat with a cached copier (persistent requests) and unpack early with
+  // exchangeTest.  Do this twice to make sure the requests can be restarted.
+  for (int iter = 0; iter != 2; ++iter)
+    {
+      lvldata.setVal(procID + 0.5);
+      Copier& cacheCopier = CopierCache::exchangeLD(lvldata);
+      if (!cacheCopier.persistent()) ++status;
+      lvldata.exchangeBegin(cacheCopier);
+      // Poll while doing some computational work
+      int numTest = 0;
+      while (!lvldata.exchangeTest(cacheCopier) && numTest < 1000000)
+        {
+          ++numTest;
+        }
+      lvldata.exchangeEnd(cacheCopier);
+      for (DataIterator dit(dbl); dit.ok(); ++dit)
+        {
+          const BaseFab<Real>& fab = lvldata[dit];
+          const Real val = (procID == 0) ? 1.5 : 0.5;
+          for (BoxIterator bit(regionRecv); bit.ok(); ++bit)
+            {
+              if (fab(*bit, 0) != val) ++status;
+            }
+        }
+    }
+  if (CopierCache::size() != 1) ++status;
+#endif
+
+#if 1
+  // Complete exchanges with the progress thread (if MPI provides
+  // MPI_THREAD_MULTIPLE) and without it.  Tasks from forEachBox for a box
+  // only start once its messages have been unpacked.
+  if ((DisjointBoxLayout::threadSupport() ==
+       DisjointBoxLayout::ThreadSupport::multiple) !=
+      ExchangeProgress::enabled()) ++status;
+  {
+    const int maxTileCellsSave = BoxTasks::maxTileCells();
+    BoxTasks::setMaxTileCells(1);  // One tile per cell in outermost dir.
+    LevelData<BaseFab<Real> > lvlghost(dbl, 1, 0);
+    for (int iter = 0; iter != 2; ++iter)
+      {
+        const bool progress = ExchangeProgress::enabled();
+        lvldata.setVal(procID + 0.5);
+        lvlghost.setVal(-1.);
+        Copier& cacheCopier = CopierCache::exchangeLD(lvldata);
+        lvldata.exchangeBegin(cacheCopier);
+        if ((bool)cacheCopier.progressJob() != progress) ++status;
+        lvldata.forEachBox(
+          cacheCopier,
+          [&](const BoxIndex& a_bidx, const Box& a_tile)
+          {
+            // Copy the ghost value next to each cell of the tile
+            const BaseFab<Real>& fab = lvldata[a_bidx];
+            BaseFab<Real>& fabGhost = lvlghost[a_bidx];
+            MD_BOXLOOP(a_tile, i)
+              {
+                const IntVect iv(D_DECL(i0, i1, i2));
+                IntVect ivGhost(iv);
+                ivGhost[0] = regionRecv.loVect(0);
+                fabGhost(iv, 0) = fab(ivGhost, 0);
+              }
+          });
+        lvldata.exchangeEnd(cacheCopier);
+        if (cacheCopier.progressJob()) ++status;
+        const Real val = (procID == 0) ? 1.5 : 0.5;
+        for (DataIterator dit(dbl); dit.ok(); ++dit)
+          {
+            const BaseFab<Real>& fab = lvldata[dit];
+            for (BoxIterator bit(regionRecv); bit.ok(); ++bit)
+              {
+                if (fab(*bit, 0) != val) ++status;
+              }
+            const BaseFab<Real>& fabGhost = lvlghost[dit];
+            for (BoxIterator bit(dbl[dit]); bit.ok(); ++bit)
+              {
+                if (fabGhost(*bit, 0) != val) ++status;
+              }
+          }
+        // Second iteration is completed by the master thread
+        ExchangeProgress::setEnabled(false);
+      }
+    ExchangeProgress::setEnabled(true);
+    BoxTasks::setMaxTileCells(maxTileCellsSave);
+  }
+#endif
+
   // Get sum of all status into master process
   int allStatus;
   MPI_Reduce(&status, &allStatus, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
@@ -195,7 +286,7 @@ int main(int argc, const char* argv[])
         {
           std::cout << "Status: " << allStatus << std::endl;
         }
-      const char* const testName = "testMPIExchange";
+      const char* const testName = "testMPISplitExchange";
       const char* const statLbl[] = {
         "failed",
         "passed"